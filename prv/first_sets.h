@@ -0,0 +1,118 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+/* Generated by tools/gen_first_sets.c. Do not edit. */
+
+#ifndef PRV_FIRST_SETS_H
+#define PRV_FIRST_SETS_H
+
+#include <prv/scanner.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FIRST_SET_WORDS	2
+
+static_assert(SCRIPT == 126 && LAST_NON_TERMINAL == 199,
+			  "Run the first_sets target");
+
+/* [type - SCRIPT] = the token types that may start it */
+static const
+uint64_t g_first_sets[74][FIRST_SET_WORDS] = {
+	{0xffffffffffffffff, 0x3fffffffffffffff},	/* 0, any */
+	{0x0412001808238e7c, 0x3ffffff3fa1bcf80},	/* 1 */
+	{0x0412001808238e7c, 0x3ffffff3fa1bcf80},	/* 2 */
+	{0x0412001808238e7c, 0x3ffffff3fa1bcf80},	/* 3 */
+	{0x0412001808238e7c, 0x3ffffff3da1b0f80},	/* 4 */
+	{0x0000000000000000, 0x000000202000c200},	/* 5 */
+	{0x0000000000000400, 0x0000000000000000},	/* 6 */
+	{0x0000000000000000, 0x0200000000000000},	/* 7 */
+	{0x0000000008000000, 0x0000000000000000},	/* 8 */
+	{0x0412001800238a7c, 0x255bbff352080780},	/* 9 */
+	{0x0000000000000000, 0x0000000080000000},	/* 10 */
+	{0x0000000000000000, 0x0804000008100000},	/* 11 */
+	{0x0000000000000000, 0x0000000000010000},	/* 12 */
+	{0x0000000000000000, 0x0000000000000800},	/* 13 */
+	{0x0000000000000000, 0x0000400000000000},	/* 14 */
+	{0x0000000000000000, 0x1000000000000000},	/* 15 */
+	{0x0000000000000000, 0x2009be7150000780},	/* 16 */
+	{0x0000000000000000, 0x0020000000000000},	/* 17 */
+	{0x0000000000000000, 0x0080000000000000},	/* 18 */
+	{0x0000000000000000, 0x0000000000020000},	/* 19 */
+	{0x0000000000000400, 0x0000000000000000},	/* 20 */
+	{0x0000000000000c00, 0x2009be7150000780},	/* 21 */
+	{0x0000000000000c00, 0x2009be7150000780},	/* 22 */
+	{0x0000000000000000, 0x2009be7150000780},	/* 23 */
+	{0x0000000000000c00, 0x0000000000000000},	/* 24 */
+	{0x0020000000000000, 0x0000000000000000},	/* 25 */
+	{0x0412001800238e7c, 0x255bbff372084780},	/* 26 */
+	{0x0400000000020e7c, 0x205bbff372004780},	/* 27 */
+	{0x0412001800238e7c, 0x255bbff372084780},	/* 28 */
+	{0x0000000000000000, 0x2000000000000000},	/* 29 */
+	{0x0000000000000200, 0x2009be7150000780},	/* 30 */
+	{0x0000000000000000, 0x0000000000000200},	/* 31 */
+	{0x0000000000000000, 0x3fffffffffffff80},	/* 32 */
+	{0x0400000000020e7c, 0x205bbff372004780},	/* 33 */
+	{0x0400000000020e7c, 0x205bbff372004780},	/* 34 */
+	{0x0400000000020e7c, 0x205bbff372004780},	/* 35 */
+	{0x0400000000020e7c, 0x205bbff372004780},	/* 36 */
+	{0x0000000000000200, 0x0000000000000000},	/* 37 */
+	{0x0412001800238e7c, 0x255bbff372084780},	/* 38 */
+	{0x0000000040000000, 0x0000000000000000},	/* 39 */
+	{0x0000000000000800, 0x0000000000000000},	/* 40 */
+	{0x0000000000000060, 0x0000000000000000},	/* 41 */
+	{0x0000000000200000, 0x0000000000000000},	/* 42 */
+	{0x0400000000020e7c, 0x205bbff372004780},	/* 43 */
+	{0x0000000000400a60, 0x0000000000000000},	/* 44 */
+	{0x0000000000400a60, 0x0000000000000000},	/* 45 */
+	{0x0000000000000000, 0x0002000000000000},	/* 46 */
+	{0x0000000000000000, 0x0000000200000000},	/* 47 */
+	{0x0000000000000000, 0x0002000000000000},	/* 48 */
+	{0x0000000000000000, 0x0000008200000000},	/* 49 */
+	{0x0400000000020e7c, 0x2059bf7172004780},	/* 50 */
+	{0x0000000000400860, 0x0000000000000000},	/* 51 */
+	{0x0000000000400000, 0x0000000000000000},	/* 52 */
+	{0x0000000000400000, 0x0000000000000000},	/* 53 */
+	{0x0000000000000000, 0x0000000200000000},	/* 54 */
+	{0x0000000000000000, 0x0000008000000000},	/* 55 */
+	{0x0000000000000008, 0x0000000000000000},	/* 56 */
+	{0x0000000000000004, 0x0000000000000000},	/* 57 */
+	{0x0000000000000800, 0x0000000000000000},	/* 58 */
+	{0x0000000000000400, 0x0000000000000000},	/* 59 */
+	{0x0000000000000000, 0x0000000020000000},	/* 60 */
+	{0x0000000000000000, 0x0000000000004000},	/* 61 */
+	{0x0000000000000000, 0x0000000020000000},	/* 62 */
+	{0x0000000000000000, 0x0000000000000200},	/* 63 */
+	{0x0000000000000000, 0x0000000000000200},	/* 64 */
+	{0x0400000000020010, 0x0000000000000000},	/* 65 */
+	{0x0000000000000200, 0x0000000000000000},	/* 66 */
+	{0x0000000000000000, 0x2009be7150000780},	/* 67 */
+	{0x0412001800238e7c, 0x255bbff372084780},	/* 68 */
+	{0x0412001800038e7c, 0x255bbff372084780},	/* 69 */
+	{0x0400001800020e7c, 0x205bbff372004780},	/* 70 */
+	{0xffffffffffffffff, 0x3fffffffffffffff},	/* 71, any */
+	{0x0000000000000c00, 0x2009be7150000780},	/* 72 */
+	{0x0000000100000000, 0x0000000000000000},	/* 73 */
+};
+
+/* Its set has TOKEN_INVALID iff it may start with any token. */
+static inline
+bool first_set_is_any(enum token_type type)
+{
+	assert(type >= SCRIPT && type <= LAST_NON_TERMINAL);
+	return g_first_sets[type - SCRIPT][0] & 1;
+}
+
+static inline
+bool first_set_has(enum token_type type,
+				   enum token_type first)
+{
+	const uint64_t *set;
+
+	assert(type >= SCRIPT && type <= LAST_NON_TERMINAL);
+	assert(first < SCRIPT);
+	set = g_first_sets[type - SCRIPT];
+	return (set[first / 64] >> (first % 64)) & 1;
+}
+#endif
@@ -0,0 +1,58 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+#ifndef PRV_MEMO_H
+#define PRV_MEMO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * The packrat memo of the parser: the result of parsing a non-terminal, with
+ * some flags, at a queue position. A result is its error (ERR_SUCCESS or
+ * ERR_NO_MATCH), the position after it, and its subtree. The subtree is
+ * shared with the parse, not copied; the memo holds a reference to it.
+ *
+ * The reach is the position after the last token that the parse read,
+ * whether it matched or not. A result depends only on the tokens before its
+ * reach; a rescan drops those results that read the rescanned token. A cut
+ * drops those that start behind it; the parser never goes back there.
+ */
+
+/* The size of the tables; the results beyond are not recorded. */
+#define MEMO_MAX_BYTES	(64 * 1024 * 1024)
+
+struct parse_node;
+
+struct memo_entry {
+	size_t				pos;
+	size_t				end_pos;
+	size_t				reach;
+	struct parse_node	*node;	/* NULL if not matched */
+	int					err;
+	uint32_t			flags;
+	uint16_t			type;
+};
+
+struct memo;
+
+int	memo_new(struct memo **out);
+int	memo_delete(struct memo *this);
+
+const struct memo_entry	*memo_find(const struct memo *this,
+								   uint16_t type,
+								   uint32_t flags,
+								   size_t pos);
+
+/* Takes over the entry's reference to its node, even on error. */
+int		memo_add(struct memo *this,
+				 const struct memo_entry *entry);
+
+/* Drops the results that start before pos. */
+void	memo_cut(struct memo *this,
+				 size_t pos);
+
+/* Drops the results that read the token at pos. */
+void	memo_rescan(struct memo *this,
+					size_t pos);
+#endif
@@ -7,6 +7,9 @@
 #include <pub/parser.h>
 
 #include <prv/scanner.h>
+#include <prv/pipeline.h>
+#include <prv/prescan.h>
+#include <prv/memo.h>
 
 #include <pub/list.h>
 
@@ -36,16 +39,26 @@
 	size_t *q_pos,			\
 	struct parse_node **out
 
+/*
+ * The atom, if any, is in the atom table of the parser's scanner.
+ *
+ * A memo shares the subtrees it records with the parse; each holds a
+ * reference, and a node is freed once neither does. A subtree that the parse
+ * changes in place, such as a cover, is marked stale, and is not recalled.
+ */
 struct parse_node {
 	struct list_entry	entry;
 	struct list_entry	nodes;
-	const char16_t		*cooked;
-	size_t				cooked_len;
-	enum token_type		type;
+	uint32_t			atom;
+	uint16_t			type;
+	uint8_t				refs;
+	bool				is_stale;
 };
 
 int	parse_node_new(enum token_type type,
 				   struct parse_node **out);
+
+/* Drops a reference; the descendants still held by the memo are kept. */
 int	parse_node_delete(struct parse_node *this);
 
 static inline
@@ -71,22 +84,58 @@ bool parse_node_is_reserved_word(const struct parse_node *this)
 static inline
 enum token_type parse_node_type(const struct parse_node *this)
 {
-	return this->type;
+	return (enum token_type)this->type;
+}
+
+/* A cover is reinterpreted in place. */
+static inline
+void parse_node_set_type(struct parse_node *this,
+						 enum token_type type)
+{
+	this->type = type;
+}
+
+static inline
+void parse_node_set_stale(struct parse_node *this)
+{
+	this->is_stale = true;
 }
 
 static inline
-void parse_node_set_cooked(struct parse_node *this,
-						   const char16_t *cooked,
-						   size_t cooked_len)
+void parse_node_set_atom(struct parse_node *this,
+						 uint32_t atom)
 {
-	this->cooked = cooked;
-	this->cooked_len = cooked_len;
+	this->atom = atom;
 }
 
+/*
+ * The queue holds the tokens at the positions [base, num_tokens), for
+ * lookahead and backtracking; tokens[0] is at base. It grows geometrically.
+ * The tokens behind a cut, which the parser never backtracks past, are
+ * released from it; the tokens themselves live in the scanner's arena.
+ *
+ * With a pipeline, or a prescan, the new tokens are popped from it instead of
+ * being scanned on demand.
+ *
+ * The reach is the position after the last token read; with a memo, it is
+ * tracked from the start of each recorded parse.
+ *
+ * A failed scan ends the parse; scan_fail_pos is the src position of the
+ * token that failed.
+ */
 struct parser {
 	struct scanner		*scanner;
+	struct pipeline		*pipeline;
+	struct prescan		*prescan;
+	struct memo			*memo;
 	const struct token	**tokens;
+	size_t				base;
 	size_t				num_tokens;
+	size_t				size;
+	size_t				reach;
+	size_t				scan_fail_pos;
+	bool				is_scan_failed;
+	bool				is_cut_list;	/* The next STATEMENT_LIST is the script's */
 	struct parse_node	*root;
 };
 #endif
@@ -0,0 +1,53 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+#ifndef PRV_PIPELINE_H
+#define PRV_PIPELINE_H
+
+#include <prv/scanner.h>
+
+#include <stddef.h>
+
+/*
+ * A scanner that runs ahead of the parser, on a thread of its own. The tokens
+ * are published into a bounded single-producer, single-consumer ring, which
+ * is lock-free; the parser pops them as it needs them.
+ *
+ * The parser picks the goal of each token, but the scanner thread can only
+ * guess it: from the previous token for a /, and from the nesting of braces
+ * and template substitutions for a }. When a guess is wrong, the parser
+ * pauses the thread, rescans the token itself, and resumes the thread from
+ * there. Only the parser's thread calls these functions.
+ *
+ * While the thread runs, it owns the scanner; the parser reads only the
+ * tokens. Anything else, such as the lazy cooks of the scanner, must wait for
+ * a pause.
+ */
+#define PIPELINE_RING_SIZE	1024	/* Tokens; a power of 2 */
+
+struct pipeline;
+
+int	pipeline_new(struct scanner *scanner,
+				 struct pipeline **out);
+
+/* Stops and joins the thread. The scanner is left to the caller. */
+int	pipeline_delete(struct pipeline *this);
+
+/*
+ * The error, including ERR_END_OF_FILE, is that of the scanner at that
+ * position. It is sticky until a resume.
+ */
+int	pipeline_get_next_token(struct pipeline *this,
+							const struct token **out);
+
+/*
+ * Once paused, the scanner is the caller's; the tokens not yet popped are
+ * dropped. The resume continues from the scanner's position. Its tokens are
+ * those popped since a point at which no braces, or templates, were open;
+ * they restore the guesses.
+ */
+void	pipeline_pause(struct pipeline *this);
+void	pipeline_resume(struct pipeline *this,
+						const struct token *const *tokens,
+						size_t num_tokens);
+#endif
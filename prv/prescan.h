@@ -0,0 +1,51 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+#ifndef PRV_PRESCAN_H
+#define PRV_PRESCAN_H
+
+#include <prv/scanner.h>
+
+#include <stddef.h>
+
+/*
+ * A resident src, tokenized up front. The src is split at line starts into
+ * segments, each scanned on a thread of its own, as if no comment, string,
+ * template or regexp were open at its start. The segments are then stitched
+ * in order: where the tokens of a segment run past the start of the next,
+ * the next is joined at the token that both read alike. If none do, its
+ * assumed start was wrong; the parser's scanner rescans from there, until it
+ * reads a token alike with a segment again.
+ *
+ * The goals of the tokens are guessed, as by the pipeline. When the parser
+ * rescans a token, the tokens after it are dropped, and the scanner goes on
+ * from the rescanned token in the same way.
+ */
+#define PRESCAN_MIN_SEGMENT_SIZE	(64 * 1024)	/* Units */
+
+struct prescan;
+
+/* The scanner must not have scanned yet. */
+int	prescan_new(struct scanner *scanner,
+				size_t num_segments,
+				struct prescan **out);
+int	prescan_delete(struct prescan *this);
+
+/*
+ * The goal is used only while the scanner reads on its own. The error,
+ * including ERR_END_OF_FILE, is that of the scanner at that position.
+ */
+int	prescan_get_next_token(struct prescan *this,
+						   enum scanner_goal goal,
+						   const struct token **out);
+
+/* The src position of the token at which prescan_get_next_token failed. */
+size_t	prescan_error_pos(const struct prescan *this);
+
+/*
+ * The tokens continue after the token just rescanned by the scanner; NULL if
+ * the rescan failed.
+ */
+void	prescan_resume(struct prescan *this,
+					   const struct token *token);
+#endif
@@ -7,17 +7,29 @@
 #include <pub/error.h>
 #include <pub/list.h>
 #include <pub/bits.h>
+#include <pub/atom.h>
+#include <pub/units.h>
+#include <pub/number.h>
 
 #include <assert.h>
 #include <uchar.h>
+#include <stdint.h>
 #include <stdbool.h>
 
 #define TF_UNC_SEQ_POS	0
 #define TF_HEX_SEQ_POS	1
 #define TF_NL_PFX_POS	2
+#define TF_OCT_SEQ_POS	3
+#define TF_BIG_INT_POS	4
+#define TF_SMALL_INT_POS	5
+#define TF_BAD_ESC_POS	6
 #define TF_UNC_SEQ_BITS	1
 #define TF_HEX_SEQ_BITS	1
 #define TF_NL_PFX_BITS	1
+#define TF_OCT_SEQ_BITS	1
+#define TF_BIG_INT_BITS	1
+#define TF_SMALL_INT_BITS	1
+#define TF_BAD_ESC_BITS	1
 
 enum token_type {
 	TOKEN_INVALID,	/* Must be 0 */
@@ -25,6 +37,13 @@ enum token_type {
 
 	TOKEN_STRING,
 	TOKEN_NUMBER,	/* Includes BigInt */
+	TOKEN_REG_EXP,
+
+	/* Template chunks. A TEMPLATE has no substitutions. */
+	TOKEN_TEMPLATE,
+	TOKEN_TEMPLATE_HEAD,
+	TOKEN_TEMPLATE_MIDDLE,
+	TOKEN_TEMPLATE_TAIL,
 
 	/* Literal Punctuations */
 	TOKEN_LEFT_PAREN,
@@ -51,6 +70,32 @@ enum token_type {
 	TOKEN_COMMA,
 	TOKEN_ARROW,
 	TOKEN_QUESTION_DOT,
+	TOKEN_DOT_DOT,	/* Internal use; a prefix of ... */
+	TOKEN_ELLIPSIS,
+	TOKEN_QUESTION,
+	TOKEN_COALESCE,
+	TOKEN_INC,
+	TOKEN_DEC,
+
+	/* Relational, Equality */
+	TOKEN_LESS_THAN,
+	TOKEN_GREATER_THAN,
+	TOKEN_LESS_EQUALS,
+	TOKEN_GREATER_EQUALS,
+	TOKEN_NOT_EQUALS,
+	TOKEN_NOT_DOUBLE_EQUALS,
+
+	/* Bitwise, Logical. SAR is >>, SHR is >>>. */
+	TOKEN_SHL,
+	TOKEN_SAR,
+	TOKEN_SHR,
+	TOKEN_BITWISE_AND,
+	TOKEN_BITWISE_OR,
+	TOKEN_BITWISE_XOR,
+	TOKEN_BITWISE_NOT,
+	TOKEN_LOGICAL_AND,
+	TOKEN_LOGICAL_OR,
+	TOKEN_LOGICAL_NOT,
 
 	/* All EQUALS */
 	TOKEN_EQUALS,
@@ -208,26 +253,52 @@ enum token_type {
 	REGEXP_LITERAL,
 	PARENTHESIZED_EXPRESSION,
 	IDENTIFIER_REFERENCE,
-};
+	BINARY_EXPRESSION,
+	UNARY_EXPRESSION,
 
-struct token_location {
-	size_t		file_row;
-	size_t		file_col;
-	size_t		scan_pos;
+	UPDATE_EXPRESSION,	/* 70 */
+	FORMAL_PARAMETERS,
+	BINDING_ELEMENT,
+	BINDING_REST_ELEMENT,
 };
 
-struct token {
-	struct token_location	locn;
-	size_t			raw_len;
-
-	const char16_t	*cooked;
-	size_t			cooked_len;
+#define LAST_NON_TERMINAL	BINDING_REST_ELEMENT
+
+/*
+ * Tokens are allocated from the scanner's arena, in slabs of
+ * TOKEN_SLAB_SIZE bytes, and are all freed by scanner_delete.
+ *
+ * A token records only its position; scanner_locate maps it to a row and a
+ * col when needed.
+ *
+ * The cooked value of an identifier or a string is interned in the atom table
+ * of the scanner. Reserved words, and the other tokens, have no atom.
+ *
+ * The value of a number is converted while it is scanned. An integer that
+ * fits in 32 bits is kept in the token itself (TF_SMALL_INT); any other value
+ * is kept in the scanner's numbers, at the index in the token. A BigInt
+ * (TF_BIG_INT) is always kept in the scanner's numbers.
+ *
+ * A regexp, or a template chunk, records only its raw extent, including the
+ * delimiters. Its parts are checked, or cooked, only when asked for; most are
+ * never used. For a stream, whose units are dropped as it is read, the raw
+ * units are interned into the atom.
+ */
+#define TOKEN_SLAB_SIZE	(64 * 1024)
 
-	size_t			flags;
-	enum token_type	type;
+struct token {
+	uint32_t	scan_pos;
+	uint32_t	raw_len;
+	uint16_t	type;
+	uint16_t	flags;
+	union {
+		uint32_t	atom;	/* TOKEN_IDENTIFIER, TOKEN_STRING; raw units */
+		uint32_t	number;	/* TOKEN_NUMBER */
+	};
 };
 
-int		token_delete(struct token *this);
+static_assert(sizeof(struct token) == 16, "struct token must be packed");
+static_assert(LAST_NON_TERMINAL <= UINT16_MAX, "enum token_type must fit in 16 bits");
 
 static inline
 bool token_type_is_reserved_word(enum token_type type)
@@ -241,27 +312,16 @@ bool token_is_reserved_word(const struct token *this)
 	return token_type_is_reserved_word(this->type);
 }
 
-static inline
-void token_set_cooked(struct token *this,
-					  const char16_t *cooked,
-					  size_t cooked_len)
-{
-	this->cooked = cooked;
-	this->cooked_len = cooked_len;
-}
-
 static inline
 enum token_type token_type(const struct token *this)
 {
-	return this->type;
+	return (enum token_type)this->type;
 }
 
 static inline
-const char16_t *token_cooked(const struct token *this,
-							 size_t *cooked_len)
+uint32_t token_atom(const struct token *this)
 {
-	*cooked_len = this->cooked_len;
-	return this->cooked;
+	return this->atom;
 }
 
 static inline
@@ -276,6 +336,32 @@ bool token_has_hex_esc(const struct token *this)
 	return bits_get(this->flags, TF_HEX_SEQ) != 0;
 }
 
+/*
+ * Legacy octal escs, \8 and \9 in strings, and legacy octal (and
+ * NonOctalDecimal) integers; these are errors in strict mode code.
+ */
+static inline
+bool token_has_oct_esc(const struct token *this)
+{
+	return bits_get(this->flags, TF_OCT_SEQ) != 0;
+}
+
+static inline
+bool token_is_big_int(const struct token *this)
+{
+	return bits_get(this->flags, TF_BIG_INT) != 0;
+}
+
+/*
+ * A NotEscapeSequence in a template chunk; its cooked value is undefined,
+ * which is an error unless the template is tagged.
+ */
+static inline
+bool token_has_bad_esc(const struct token *this)
+{
+	return bits_get(this->flags, TF_BAD_ESC) != 0;
+}
+
 static inline
 bool token_has_new_line_pfx(const struct token *this)
 {
@@ -320,19 +406,229 @@ bool token_is_reserved_literal(const struct token *this)
 	return true;
 }
 
+/*
+ * The goal symbols of the lexical grammar; the parser picks one for each
+ * token, since only it knows which is allowed. They differ only at / and }.
+ */
+enum scanner_goal {
+	SCANNER_GOAL_DIV,			/* InputElementDiv */
+	SCANNER_GOAL_REG_EXP,		/* InputElementRegExp */
+	SCANNER_GOAL_TEMPLATE_TAIL,	/* InputElementTemplateTail */
+};
+
+/* Whether the token reads the same under the goal as it did when scanned. */
+static inline
+bool token_fits_goal(const struct token *this,
+					 enum scanner_goal goal)
+{
+	switch (token_type(this)) {
+	case TOKEN_DIV:
+	case TOKEN_DIV_EQUALS:
+		return goal != SCANNER_GOAL_REG_EXP;
+	case TOKEN_REG_EXP:
+		return goal == SCANNER_GOAL_REG_EXP;
+	case TOKEN_RIGHT_BRACE:
+		return goal != SCANNER_GOAL_TEMPLATE_TAIL;
+	case TOKEN_TEMPLATE_MIDDLE:
+	case TOKEN_TEMPLATE_TAIL:
+		return goal == SCANNER_GOAL_TEMPLATE_TAIL;
+	default:
+		return true;
+	}
+}
+
+/*
+ * A guess of the goal of the next token, for scanning ahead of the parser:
+ * from the previous token for a /, and from the nesting of braces and
+ * template substitutions for a }. A template substitution sets its bit in
+ * bits; a brace clears it. A zeroed guess is that of the start of the src.
+ */
+#define GOAL_GUESS_MAX_DEPTH	64
+
+struct goal_guess {
+	enum token_type	prev_type;
+	size_t			depth;
+	uint64_t		bits;
+};
+
+enum scanner_goal	goal_guess_goal(const struct goal_guess *this);
+void				goal_guess_add(struct goal_guess *this,
+								   const struct token *token);
+
+/*
+ * The src units are either 1 byte (Latin-1) or 2 bytes (UTF-16) wide. All
+ * reads go through scanner_unit, so that the tokens are the same regardless
+ * of the width.
+ *
+ * src holds the units in the range [src_base, src_len). For a resident src,
+ * src_base is 0. For a stream, src is a window which is refilled one chunk at
+ * a time; on each refill, the units behind the token being scanned are
+ * dropped. The units of the last token that another goal reads differently
+ * are kept too, so that the parser can rescan it (pin_pos).
+ *
+ * Identifiers and escape-free strings are interned straight from the src.
+ * A string with escapes is cooked into the scratch buffer, and then interned.
+ * The lazy cooks, of the template chunks, have a buffer of their own.
+ */
+struct cooked_buf {
+	char16_t	*units;
+	size_t		len;
+	size_t		size;
+};
+
+union number {
+	double			value;
+	struct big_int	*big_int;	/* Allocated from the tokens arena */
+};
+
+struct number_buf {
+	union number	*values;
+	size_t			len;
+	size_t			size;
+};
+
 struct scanner {
-	const char16_t	*src;
+	const void		*src;
+	size_t			src_base;
 	size_t			src_len;
+	size_t			src_unit_size;
+	struct units_ops	ops;	/* For the src_unit_size */
+
+	struct atom_table	*atoms;
+	struct arena		*tokens;
+	struct cooked_buf	cooked;
+	struct cooked_buf	lazy_cooked;
+	struct number_buf	numbers;
+
+	struct stream	*stream;
+	char16_t		*window;
+	size_t			window_size;
+	bool			is_in_token;
+	bool			has_pin;
+	size_t			pin_pos;
 	enum token_type	prev_token_type;
 
-	struct token_location	curr_locn;
-	struct token_location	save_locn;
+	struct line_index	*lines;
+	size_t				curr_pos;
+	size_t				save_pos;
 };
 
-int	scanner_new(const char16_t *src,
+int	scanner_new(const void *src,
 				size_t src_len,
+				size_t src_unit_size,
 				struct scanner **out);
+int	scanner_new_stream(int fd,
+					   struct scanner **out);
 int	scanner_delete(struct scanner *this);
+
+static inline
+struct atom_table *scanner_atoms(const struct scanner *this)
+{
+	return this->atoms;
+}
+
+/*
+ * The values, and the lazy cooks below, read or write the tables that the
+ * scanner fills as it scans. While a pipeline runs the scanner on its own
+ * thread, they must wait for a pause.
+ */
+
+/* The value of a TOKEN_NUMBER that is not a BigInt. */
+static inline
+double scanner_number(const struct scanner *this,
+					  const struct token *token)
+{
+	assert(token_type(token) == TOKEN_NUMBER && !token_is_big_int(token));
+	if (bits_get(token->flags, TF_SMALL_INT))
+		return token->number;
+	return this->numbers.values[token->number].value;
+}
+
+static inline
+const struct big_int *scanner_big_int(const struct scanner *this,
+									  const struct token *token)
+{
+	assert(token_type(token) == TOKEN_NUMBER && token_is_big_int(token));
+	return this->numbers.values[token->number].big_int;
+}
+
+static inline
+char16_t scanner_unit(const struct scanner *this,
+					  size_t pos)
+{
+	pos -= this->src_base;
+	if (this->src_unit_size == 1)
+		return ((const unsigned char *)this->src)[pos];
+	return ((const char16_t *)this->src)[pos];
+}
+
 int	scanner_get_next_token(struct scanner *this,
+						   enum scanner_goal goal,
 						   const struct token **out);
+
+/* The next token, under the goal guessed; see goal_guess. */
+int	goal_guess_scan(const struct goal_guess *this,
+					struct scanner *scanner,
+					const struct token **out);
+
+/*
+ * Scans the token again, under another goal, and continues after it; the
+ * tokens scanned after it must be discarded. For a stream, only the last
+ * token that starts with a / or a } can be rescanned.
+ */
+int	scanner_rescan_token(struct scanner *this,
+						 const struct token *token,
+						 enum scanner_goal goal,
+						 const struct token **out);
+
+/*
+ * Continues the scan at pos, as if a token of the prev_type ended there;
+ * TOKEN_NEW_LINE if a line did. Only a resident src can be seeked.
+ */
+int	scanner_seek(struct scanner *this,
+				 size_t pos,
+				 enum token_type prev_type);
+
+/*
+ * Copies a token of another scanner over the same src. Its atom, or its
+ * number, is moved into the tables of this scanner. The atom_map, indexed by
+ * the atoms of the other, caches the atoms moved so far; it holds
+ * atom_table_count() + 1 entries, zeroed before the first call.
+ */
+int	scanner_adopt_token(struct scanner *this,
+						const struct scanner *other,
+						const struct token *token,
+						uint32_t *atom_map,
+						const struct token **out);
+
+/*
+ * The cooked (TV) and raw (TRV) strings of a template chunk, interned. The
+ * cooked string fails with ERR_INVALID_TOKEN if the chunk has a bad escape.
+ * Like those below, they intern into the scanner's atoms; see scanner_number.
+ */
+int	scanner_template_cooked(struct scanner *this,
+							const struct token *token,
+							uint32_t *out);
+int	scanner_template_raw(struct scanner *this,
+						 const struct token *token,
+						 uint32_t *out);
+
+/*
+ * The body and the flags of a regexp, interned. Fails with ERR_SYNTAX if the
+ * flags are invalid. The pattern is left to the regexp compiler to check.
+ */
+int	scanner_reg_exp(struct scanner *this,
+					const struct token *token,
+					uint32_t *body,
+					uint32_t *flags);
+
+/*
+ * Maps a position, such as that of a token, to a 0-based row and col. The col
+ * is counted in UTF-16 units from the start of the row. Rows end at \n, \r,
+ * \r\n, U+2028 and U+2029.
+ */
+int	scanner_locate(struct scanner *this,
+				   size_t pos,
+				   size_t *row,
+				   size_t *col);
 #endif
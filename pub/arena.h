@@ -0,0 +1,23 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+#ifndef PUB_ARENA_H
+#define PUB_ARENA_H
+
+#include <stddef.h>
+
+/*
+ * A bump allocator. Memory is carved out of slabs, and is never freed
+ * individually; arena_delete frees all of it at once. Allocations never move.
+ */
+struct arena;
+
+int		arena_new(size_t slab_size,
+				  struct arena **out);
+int		arena_delete(struct arena *this);
+
+/* align must be a power of 2. Returns NULL if out of memory. */
+void	*arena_alloc(struct arena *this,
+					 size_t size,
+					 size_t align);
+#endif
@@ -0,0 +1,41 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+#ifndef PUB_ATOM_H
+#define PUB_ATOM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * An intern pool of strings. Each distinct string is stored once, and is
+ * identified by a 32-bit id; two strings are equal iff their ids are equal.
+ *
+ * The strings are sequences of code units, given as either 1 byte (Latin-1)
+ * or 2 bytes (UTF-16) wide. The width is not a part of the identity: "ab"
+ * from a Latin-1 src and "ab" from a UTF-16 src get the same id. A string is
+ * stored in the narrowest width that holds its units.
+ */
+
+/* No atom. Never returned by atom_table_intern. */
+#define ATOM_NONE	0
+
+struct atom_table;
+
+int	atom_table_new(struct atom_table **out);
+int	atom_table_delete(struct atom_table *this);
+
+/* The units are copied if they are not yet interned. */
+int	atom_table_intern(struct atom_table *this,
+					  const void *units,
+					  size_t len,
+					  size_t unit_size,
+					  uint32_t *out);
+
+/* The units remain valid until atom_table_delete. */
+const void	*atom_table_get(const struct atom_table *this,
+							uint32_t atom,
+							size_t *len,
+							size_t *unit_size);
+size_t		atom_table_count(const struct atom_table *this);
+#endif
@@ -0,0 +1,44 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+#ifndef PUB_LINES_H
+#define PUB_LINES_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <pub/units.h>
+
+/*
+ * The offsets at which the lines of a src begin. The src is fed in one or
+ * more consecutive pieces; a \r\n split across two pieces is still a single
+ * line terminator. \n, \r, \r\n, U+2028 and U+2029 each end a line.
+ *
+ * Rows and cols are 0-based. A col is an offset in code units from the start
+ * of the row.
+ */
+struct line_index {
+	size_t				*starts;	/* starts[0] == 0 */
+	size_t				num_starts;
+	size_t				size;
+	size_t				num_units;	/* The # of units fed so far. */
+	bool				is_cr_last;	/* The last unit fed is a \r. */
+	size_t				unit_size;
+	struct units_ops	ops;
+};
+
+int	line_index_new(size_t unit_size,
+				   struct line_index **out);
+int	line_index_delete(struct line_index *this);
+
+/* The units continue the src at offset num_units. */
+int	line_index_add(struct line_index *this,
+				   const void *units,
+				   size_t len);
+
+/* pos must be <= num_units. */
+void	line_index_find(const struct line_index *this,
+						size_t pos,
+						size_t *row,
+						size_t *col);
+#endif
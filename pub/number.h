@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+#ifndef PUB_NUMBER_H
+#define PUB_NUMBER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Conversions of the digits of numeric literals into IEEE doubles, and into
+ * BigInts. All doubles are correctly rounded; i.e. to nearest, ties to even.
+ *
+ * The digits are given as ASCII, [0-9a-fA-F], without separators or
+ * prefixes.
+ */
+
+struct arena;
+
+/* The magnitude of a BigInt. */
+struct big_int {
+	uint32_t	num_limbs;
+	uint64_t	limbs[];	/* Little-endian. No leading 0 limbs; 0 has none. */
+};
+
+/*
+ * w * 10^q. The w must hold all the significant digits. Uses the Clinger fast
+ * path when w and 10^q are exact doubles, and the Eisel-Lemire algorithm
+ * otherwise.
+ */
+double	number_from_decimal(uint64_t w,
+							int64_t q);
+
+/* digits * 10^q; for when the significant digits do not fit in a w. Slow. */
+int		number_from_decimal_digits(const char *digits,
+								   size_t num_digits,
+								   int64_t q,
+								   double *out);
+
+/* The radix must be 2, 8 or 16. */
+double	number_from_digits(const char *digits,
+						   size_t num_digits,
+						   unsigned radix);
+
+/*
+ * The radix must be 2, 8, 10 or 16. The big_int is allocated from the arena,
+ * and is freed with it.
+ */
+int		big_int_new(struct arena *arena,
+					const char *digits,
+					size_t num_digits,
+					unsigned radix,
+					struct big_int **out);
+double	big_int_to_double(const struct big_int *this);
+#endif
@@ -5,13 +5,60 @@
 #define PUB_PARSER_H
 
 #include <uchar.h>
+#include <stddef.h>
 
 struct parser;
 
-int	parser_new(const char16_t *src,
+/*
+ * The src is not copied. It must remain valid until parser_delete.
+ * Its units are either 1 byte (Latin-1) or 2 bytes (UTF-16) wide.
+ */
+int	parser_new(const void *src,
 			   size_t src_len,
+			   size_t src_unit_size,
 			   struct parser **out);
+
+/*
+ * The src is a UTF-8 stream read from fd, in fixed-size chunks. The fd is
+ * neither owned nor closed by the parser.
+ */
+int	parser_new_stream(int fd,
+					  struct parser **out);
 int	parser_delete(struct parser *this);
+
+/*
+ * Scans on a thread of its own, ahead of the parser; call before parsing.
+ * Only a resident src can be pipelined. A stream keeps only the units of its
+ * last / or } token, and the scanner thread is usually past it by the time
+ * the parser asks for a rescan; it fails with ERR_UNSUPPORTED.
+ */
+int	parser_start_pipeline(struct parser *this);
+
+/*
+ * Tokenizes the src up front; call before parsing. The src is split at line
+ * starts into up to num_segments segments, which are scanned in parallel, one
+ * per thread; a segment is at least 64K units. The tokens are those that the
+ * parser would have scanned itself. Only a resident src can be prescanned,
+ * and not along with a pipeline.
+ */
+int	parser_prescan(struct parser *this,
+				   size_t num_segments);
+
+/*
+ * Records the results of the expression non-terminals by position, so that
+ * the alternatives that backtrack over an expression do not parse it again;
+ * call before parsing.
+ */
+int	parser_memoize(struct parser *this);
 int	parser_parse_script(struct parser *this);
 int	parser_parse_module(struct parser *this);
+
+/*
+ * The 1-based row and col at which the parse failed: the start of the token
+ * that could not be scanned, or else of the last token that the parser read.
+ * Call after the parse fails; the col is counted in UTF-16 units.
+ */
+int	parser_locate_error(struct parser *this,
+						size_t *row,
+						size_t *col);
 #endif
@@ -0,0 +1,28 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+#ifndef PUB_POOL_H
+#define PUB_POOL_H
+
+#include <stddef.h>
+
+typedef void fn_pool_job(void *arg);
+
+struct pool_job {
+	fn_pool_job	*fn;
+	void		*arg;
+};
+
+/*
+ * Runs the jobs on num_workers threads (the caller's included), and returns
+ * once all of them are done.
+ *
+ * The jobs are dealt round-robin, in the given order, into per-worker deques.
+ * A worker runs the jobs from the head of its own deque. Once that runs dry,
+ * it steals from the tails of the others. Hence, jobs placed earlier in the
+ * array are started earlier.
+ */
+int	pool_run(const struct pool_job *jobs,
+			 size_t num_jobs,
+			 size_t num_workers);
+#endif
@@ -0,0 +1,44 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+#ifndef PUB_SOURCE_H
+#define PUB_SOURCE_H
+
+#include <stddef.h>
+#include <uchar.h>
+
+/*
+ * A source file, mapped read-only, and presented as code units that are
+ * either 1 byte (Latin-1) or 2 bytes (UTF-16) wide.
+ *
+ * All-ASCII UTF-8 files, and UTF-16 files in the host byte-order (identified
+ * by their BOM), need no transcoding; their units point directly into the
+ * mapping. Other UTF-8 files are transcoded into a private buffer, in
+ * Latin-1 if none of their code points is above U+00FF, else in UTF-16.
+ * After that, the mapping is dropped.
+ *
+ * The units remain valid until source_delete.
+ */
+struct source {
+	void		*map;
+	size_t		map_size;
+	void		*buf;	/* NULL if units point into the map. */
+	const void	*units;
+	size_t		num_units;
+	size_t		unit_size;	/* 1 or 2 */
+};
+
+int	source_new(const char *path,
+			   struct source **out);
+int	source_delete(struct source *this);
+
+static inline
+const void *source_units(const struct source *this,
+						 size_t *num_units,
+						 size_t *unit_size)
+{
+	*num_units = this->num_units;
+	*unit_size = this->unit_size;
+	return this->units;
+}
+#endif
@@ -0,0 +1,41 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+#ifndef PUB_STREAM_H
+#define PUB_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <uchar.h>
+#include <stdbool.h>
+
+/*
+ * A UTF-8 source read from a file descriptor (a pipe, stdin, etc.), and
+ * decoded into UTF-16 one chunk at a time. A multi-byte seq. split across two
+ * reads is carried over to the next chunk.
+ */
+
+/* A chunk of n bytes never decodes into more than n units. */
+#define STREAM_CHUNK_SIZE	(64 * 1024)
+
+struct stream {
+	int		fd;
+	bool	is_eof;
+	size_t	num_bytes;
+	uint8_t	bytes[STREAM_CHUNK_SIZE];
+};
+
+/* The fd is not closed by stream_delete. */
+int	stream_new(int fd,
+			   struct stream **out);
+int	stream_delete(struct stream *this);
+
+/*
+ * Reads and decodes the next chunk into dst, which must have room for
+ * STREAM_CHUNK_SIZE units. At the end of the stream, returns
+ * ERR_END_OF_FILE.
+ */
+int	stream_read(struct stream *this,
+				char16_t *dst,
+				size_t *out_len);
+#endif
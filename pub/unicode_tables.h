@@ -0,0 +1,1039 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+/* Generated by tools/gen_unicode_tables.c. Do not edit. */
+
+#ifndef PUB_UNICODE_TABLES_H
+#define PUB_UNICODE_TABLES_H
+
+#include <stdint.h>
+
+#define ID_BLOCK_SHIFT		8
+#define ID_START_WORD		0
+#define ID_CONTINUE_WORD	8
+
+static const
+uint8_t g_id_stage1[4352] = {
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+	16, 1, 17, 18, 19, 1, 20, 21, 22, 23, 24, 25, 26, 27, 1, 28,
+	29, 30, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 32, 33, 31, 31,
+	34, 35, 31, 31, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 36, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 37, 1, 38, 39, 40, 41, 42, 43, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 44, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 1, 45, 46, 1, 47, 48, 49,
+	50, 51, 52, 53, 54, 55, 1, 56, 57, 58, 59, 60, 61, 62, 63, 64,
+	65, 66, 67, 68, 69, 70, 71, 72, 73, 74, 75, 31, 76, 77, 78, 79,
+	1, 1, 1, 80, 81, 82, 31, 31, 31, 31, 31, 31, 31, 31, 31, 83,
+	1, 1, 1, 1, 84, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 1, 1, 85, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 1, 1, 86, 87, 31, 31, 88, 89,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 90, 1, 1, 1, 1, 91, 92, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 93,
+	1, 94, 95, 31, 31, 31, 31, 31, 31, 31, 31, 31, 96, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 97,
+	31, 98, 99, 31, 100, 101, 102, 103, 31, 31, 104, 31, 31, 31, 31, 105,
+	106, 107, 108, 31, 109, 31, 31, 110, 111, 112, 31, 31, 31, 31, 113, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 114, 31, 31, 31, 31,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 115, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 116, 117, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 118, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 119, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 1, 1, 120, 31, 31, 31, 31, 31,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 121, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 122, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 123, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+	31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31, 31,
+};
+
+/* [block][0..7] = ID_Start, [block][8..15] = ID_Continue */
+static const _Alignas(64)
+uint32_t g_id_stage2[124][16] = {
+	{	/* 0 */
+		0x00000000, 0x00000000, 0x07fffffe, 0x07fffffe,
+		0x00000000, 0x04200400, 0xff7fffff, 0xff7fffff,
+		0x00000000, 0x03ff0000, 0x87fffffe, 0x07fffffe,
+		0x00000000, 0x04a00400, 0xff7fffff, 0xff7fffff,
+	},
+	{	/* 1 */
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+	},
+	{	/* 2 */
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0x0003ffc3, 0x0000501f,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0x0003ffc3, 0x0000501f,
+	},
+	{	/* 3 */
+		0x00000000, 0x00000000, 0x00000000, 0xbcdf0000,
+		0xffffd740, 0xfffffffb, 0xffffffff, 0xffbfffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xbcdfffff,
+		0xffffd7c0, 0xfffffffb, 0xffffffff, 0xffbfffff,
+	},
+	{	/* 4 */
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xfffffc03, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xfffffcfb, 0xffffffff, 0xffffffff, 0xffffffff,
+	},
+	{	/* 5 */
+		0xffffffff, 0xfffeffff, 0x027fffff, 0xffffffff,
+		0x000001ff, 0x00000000, 0xffff0000, 0x000787ff,
+		0xffffffff, 0xfffeffff, 0x027fffff, 0xffffffff,
+		0xfffe01ff, 0xbfffffff, 0xffff00b6, 0x000787ff,
+	},
+	{	/* 6 */
+		0x00000000, 0xffffffff, 0x000007ff, 0xfffec000,
+		0xffffffff, 0xffffffff, 0x002fffff, 0x9c00c060,
+		0x07ff0000, 0xffffffff, 0xffffffff, 0xffffc3ff,
+		0xffffffff, 0xffffffff, 0x9fefffff, 0x9ffffdff,
+	},
+	{	/* 7 */
+		0xfffd0000, 0x0000ffff, 0xffffe000, 0xffffffff,
+		0xffffffff, 0x0002003f, 0xfffffc00, 0x043007ff,
+		0xffff0000, 0xffffffff, 0xffffe7ff, 0xffffffff,
+		0xffffffff, 0x0003ffff, 0xffffffff, 0x243fffff,
+	},
+	{	/* 8 */
+		0x043fffff, 0x00000110, 0x01ffffff, 0xffff07ff,
+		0x00007eff, 0xffffffff, 0x000003ff, 0x00000000,
+		0xffffffff, 0x00003fff, 0x0fffffff, 0xffff07ff,
+		0xff007eff, 0xffffffff, 0xffffffff, 0xfffffffb,
+	},
+	{	/* 9 */
+		0xfffffff0, 0x23ffffff, 0xff010000, 0xfffe0003,
+		0xfff99fe1, 0x23c5fdff, 0xb0004000, 0x10030003,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xfffeffcf,
+		0xfff99fef, 0xf3c5fdff, 0xb080799f, 0x5003ffcf,
+	},
+	{	/* 10 */
+		0xfff987e0, 0x036dfdff, 0x5e000000, 0x001c0000,
+		0xfffbbfe0, 0x23edfdff, 0x00010000, 0x02000003,
+		0xfff987ee, 0xd36dfdff, 0x5e023987, 0x003fffc0,
+		0xfffbbfee, 0xf3edfdff, 0x00013bbf, 0xfe00ffcf,
+	},
+	{	/* 11 */
+		0xfff99fe0, 0x23edfdff, 0xb0000000, 0x00020003,
+		0xd63dc7e8, 0x03ffc718, 0x00010000, 0x00000000,
+		0xfff99fee, 0xf3edfdff, 0xb0e0399f, 0x0002ffcf,
+		0xd63dc7ec, 0xc3ffc718, 0x00813dc7, 0x0000ffc0,
+	},
+	{	/* 12 */
+		0xfffddfe0, 0x23fffdff, 0x27000000, 0x00000003,
+		0xfffddfe1, 0x23effdff, 0x60000000, 0x00060003,
+		0xfffddfff, 0xf3fffdff, 0x27603ddf, 0x0000ffcf,
+		0xfffddfef, 0xf3effdff, 0x60603ddf, 0x000effcf,
+	},
+	{	/* 13 */
+		0xfffddff0, 0x27ffffff, 0x80704000, 0xfc000003,
+		0xfc7fffe0, 0x2ffbffff, 0x0000007f, 0x00000000,
+		0xfffddfff, 0xffffffff, 0x80f07ddf, 0xfc00ffcf,
+		0xfc7fffee, 0x2ffbffff, 0xff5f847f, 0x000cffc0,
+	},
+	{	/* 14 */
+		0xfffffffe, 0x000dffff, 0x0000007f, 0x00000000,
+		0xfffff7d6, 0x200dffaf, 0xf000005f, 0x00000000,
+		0xfffffffe, 0x07ffffff, 0x03ff7fff, 0x00000000,
+		0xfffff7d6, 0x3fffffaf, 0xf3ff7f5f, 0x00000000,
+	},
+	{	/* 15 */
+		0x00000001, 0x00000000, 0xfffffeff, 0x00001fff,
+		0x00001f00, 0x00000000, 0x00000000, 0x00000000,
+		0x03000001, 0xc2a003ff, 0xfffffeff, 0xfffe1fff,
+		0xfeffffdf, 0x1fffffff, 0x00000040, 0x00000000,
+	},
+	{	/* 16 */
+		0xffffffff, 0x800007ff, 0x3c3f0000, 0xffe1c062,
+		0x00004003, 0xffffffff, 0xffff20bf, 0xf7ffffff,
+		0xffffffff, 0xffffffff, 0xffff03ff, 0xffffffff,
+		0x3fffffff, 0xffffffff, 0xffff20bf, 0xf7ffffff,
+	},
+	{	/* 17 */
+		0xffffffff, 0xffffffff, 0x3d7f3dff, 0xffffffff,
+		0xffff3dff, 0x7f3dffff, 0xff7fff3d, 0xffffffff,
+		0xffffffff, 0xffffffff, 0x3d7f3dff, 0xffffffff,
+		0xffff3dff, 0x7f3dffff, 0xff7fff3d, 0xffffffff,
+	},
+	{	/* 18 */
+		0xff3dffff, 0xffffffff, 0x07ffffff, 0x00000000,
+		0x0000ffff, 0xffffffff, 0xffffffff, 0x3f3fffff,
+		0xff3dffff, 0xffffffff, 0xe7ffffff, 0x0003fe00,
+		0x0000ffff, 0xffffffff, 0xffffffff, 0x3f3fffff,
+	},
+	{	/* 19 */
+		0xfffffffe, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xfffffffe, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+	},
+	{	/* 20 */
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffff9fff,
+		0x07fffffe, 0xffffffff, 0xffffffff, 0x01ffc7ff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffff9fff,
+		0x07fffffe, 0xffffffff, 0xffffffff, 0x01ffc7ff,
+	},
+	{	/* 21 */
+		0x8003ffff, 0x0003ffff, 0x0003ffff, 0x0001dfff,
+		0xffffffff, 0x000fffff, 0x10800000, 0x00000000,
+		0x803fffff, 0x001fffff, 0x000fffff, 0x000ddfff,
+		0xffffffff, 0xffffffff, 0x308fffff, 0x000003ff,
+	},
+	{	/* 22 */
+		0x00000000, 0xffffffff, 0xffffffff, 0x01ffffff,
+		0xffffffff, 0xffff05ff, 0xffffffff, 0x003fffff,
+		0x03ffb800, 0xffffffff, 0xffffffff, 0x01ffffff,
+		0xffffffff, 0xffff07ff, 0xffffffff, 0x003fffff,
+	},
+	{	/* 23 */
+		0x7fffffff, 0x00000000, 0xffff0000, 0x001f3fff,
+		0xffffffff, 0xffff0fff, 0x000003ff, 0x00000000,
+		0x7fffffff, 0x0fff0fff, 0xffffffc0, 0x001f3fff,
+		0xffffffff, 0xffff0fff, 0x07ff03ff, 0x00000000,
+	},
+	{	/* 24 */
+		0x007fffff, 0xffffffff, 0x001fffff, 0x00000000,
+		0x00000000, 0x00000080, 0x00000000, 0x00000000,
+		0x0fffffff, 0xffffffff, 0x7fffffff, 0x9fffffff,
+		0x03ff03ff, 0xbfff0080, 0x00007fff, 0x00000000,
+	},
+	{	/* 25 */
+		0xffffffe0, 0x000fffff, 0x00001fe0, 0x00000000,
+		0xfffffff8, 0xfc00c001, 0xffffffff, 0x0000003f,
+		0xffffffff, 0xffffffff, 0x03ff1fff, 0x000ff800,
+		0xffffffff, 0xffffffff, 0xffffffff, 0x000fffff,
+	},
+	{	/* 26 */
+		0xffffffff, 0x0000000f, 0xfc00e000, 0x3fffffff,
+		0xffff01ff, 0xe7ffffff, 0x00000000, 0x046fde00,
+		0xffffffff, 0x00ffffff, 0xffffe3ff, 0x3fffffff,
+		0xffff01ff, 0xe7ffffff, 0xfff70000, 0x07ffffff,
+	},
+	{	/* 27 */
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0x00000000, 0x00000000,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+	},
+	{	/* 28 */
+		0x3f3fffff, 0xffffffff, 0xaaff3f3f, 0x3fffffff,
+		0xffffffff, 0x5fdfffff, 0x0fcf1fdc, 0x1fdc1fff,
+		0x3f3fffff, 0xffffffff, 0xaaff3f3f, 0x3fffffff,
+		0xffffffff, 0x5fdfffff, 0x0fcf1fdc, 0x1fdc1fff,
+	},
+	{	/* 29 */
+		0x00000000, 0x00000000, 0x00000000, 0x80020000,
+		0x1fff0000, 0x00000000, 0x00000000, 0x00000000,
+		0x00003000, 0x80000000, 0x00100001, 0x80020000,
+		0x1fff0000, 0x00000000, 0x1fff0000, 0x0001ffe2,
+	},
+	{	/* 30 */
+		0x3f2ffc84, 0xf3fffd50, 0x000043e0, 0xffffffff,
+		0x000001ff, 0x00000000, 0x00000000, 0x00000000,
+		0x3f2ffc84, 0xf3fffd50, 0x000043e0, 0xffffffff,
+		0x000001ff, 0x00000000, 0x00000000, 0x00000000,
+	},
+	{	/* 31 */
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	},
+	{	/* 32 */
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0x000c781f,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0x000ff81f,
+	},
+	{	/* 33 */
+		0xffffffff, 0xffff20bf, 0xffffffff, 0x000080ff,
+		0x007fffff, 0x7f7f7f7f, 0x7f7f7f7f, 0x00000000,
+		0xffffffff, 0xffff20bf, 0xffffffff, 0x800080ff,
+		0x007fffff, 0x7f7f7f7f, 0x7f7f7f7f, 0xffffffff,
+	},
+	{	/* 34 */
+		0x000000e0, 0x1f3e03fe, 0xfffffffe, 0xffffffff,
+		0xf87fffff, 0xfffffffe, 0xffffffff, 0xf7ffffff,
+		0x000000e0, 0x1f3efffe, 0xfffffffe, 0xffffffff,
+		0xfe7fffff, 0xfffffffe, 0xffffffff, 0xf7ffffff,
+	},
+	{	/* 35 */
+		0xffffffe0, 0xfffeffff, 0xffffffff, 0xffffffff,
+		0x00007fff, 0xffffffff, 0x00000000, 0xffff0000,
+		0xffffffe0, 0xfffeffff, 0xffffffff, 0xffffffff,
+		0x00007fff, 0xffffffff, 0x00000000, 0xffff0000,
+	},
+	{	/* 36 */
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0x00000000, 0x00000000,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0x00000000, 0x00000000,
+	},
+	{	/* 37 */
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0x00001fff, 0x00000000, 0xffff0000, 0x3fffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0x00001fff, 0x00000000, 0xffff0000, 0x3fffffff,
+	},
+	{	/* 38 */
+		0xffff1fff, 0x00000c00, 0xffffffff, 0x80007fff,
+		0x3fffffff, 0xffffffff, 0xffffffff, 0x0000ffff,
+		0xffff1fff, 0x00000fff, 0xffffffff, 0xbff0ffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0x0003ffff,
+	},
+	{	/* 39 */
+		0xff800000, 0xfffffffc, 0xffffffff, 0xffffffff,
+		0xfffff9ff, 0xffffffff, 0x03eb07ff, 0xfffc0000,
+		0xff800000, 0xfffffffc, 0xffffffff, 0xffffffff,
+		0xfffff9ff, 0xffffffff, 0x03eb07ff, 0xfffc0000,
+	},
+	{	/* 40 */
+		0xfffff7bb, 0x00000007, 0xffffffff, 0x000fffff,
+		0xfffffffc, 0x000fffff, 0x00000000, 0x68fc0000,
+		0xffffffff, 0x000010ff, 0xffffffff, 0x000fffff,
+		0xffffffff, 0xffffffff, 0x03ff003f, 0xe8ffffff,
+	},
+	{	/* 41 */
+		0xfffffc00, 0xffff003f, 0x0000007f, 0x1fffffff,
+		0xfffffff0, 0x0007ffff, 0x00008000, 0x7c00ffdf,
+		0xffffffff, 0xffff3fff, 0x000fffff, 0x1fffffff,
+		0xffffffff, 0xffffffff, 0x03ff8001, 0x7fffffff,
+	},
+	{	/* 42 */
+		0xffffffff, 0x000001ff, 0x00000ff7, 0xc47fffff,
+		0xffffffff, 0x3e62ffff, 0x38000005, 0x001c07ff,
+		0xffffffff, 0x007fffff, 0x03ff3fff, 0xfc7fffff,
+		0xffffffff, 0xffffffff, 0x38000007, 0x007cffff,
+	},
+	{	/* 43 */
+		0x007e7e7e, 0xffff7f7f, 0xf7ffffff, 0xffff03ff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0x00000007,
+		0x007e7e7e, 0xffff7f7f, 0xf7ffffff, 0xffff03ff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0x03ff37ff,
+	},
+	{	/* 44 */
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffff000f, 0xfffff87f, 0x0fffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffff000f, 0xfffff87f, 0x0fffffff,
+	},
+	{	/* 45 */
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffff3fff,
+		0xffffffff, 0xffffffff, 0x03ffffff, 0x00000000,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffff3fff,
+		0xffffffff, 0xffffffff, 0x03ffffff, 0x00000000,
+	},
+	{	/* 46 */
+		0xa0f8007f, 0x5f7ffdff, 0xffffffdb, 0xffffffff,
+		0xffffffff, 0x0003ffff, 0xfff80000, 0xffffffff,
+		0xe0f8007f, 0x5f7ffdff, 0xffffffdb, 0xffffffff,
+		0xffffffff, 0x0003ffff, 0xfff80000, 0xffffffff,
+	},
+	{	/* 47 */
+		0xffffffff, 0x3fffffff, 0xffff0000, 0xffffffff,
+		0xfffcffff, 0xffffffff, 0x000000ff, 0x0fff0000,
+		0xffffffff, 0x3fffffff, 0xffff0000, 0xffffffff,
+		0xfffcffff, 0xffffffff, 0x000000ff, 0x0fff0000,
+	},
+	{	/* 48 */
+		0x00000000, 0x00000000, 0x00000000, 0xffdf0000,
+		0xffffffff, 0xffffffff, 0xffffffff, 0x1fffffff,
+		0x0000ffff, 0x0018ffff, 0x0000e000, 0xffdf0000,
+		0xffffffff, 0xffffffff, 0xffffffff, 0x1fffffff,
+	},
+	{	/* 49 */
+		0x00000000, 0x07fffffe, 0x07fffffe, 0xffffffc0,
+		0xffffffff, 0x7fffffff, 0x1cfcfcfc, 0x00000000,
+		0x03ff0000, 0x87fffffe, 0x07fffffe, 0xffffffc0,
+		0xffffffff, 0x7fffffff, 0x1cfcfcfc, 0x00000000,
+	},
+	{	/* 50 */
+		0xffffefff, 0xb7ffff7f, 0x3fff3fff, 0x00000000,
+		0xffffffff, 0xffffffff, 0xffffffff, 0x07ffffff,
+		0xffffefff, 0xb7ffff7f, 0x3fff3fff, 0x00000000,
+		0xffffffff, 0xffffffff, 0xffffffff, 0x07ffffff,
+	},
+	{	/* 51 */
+		0x00000000, 0x00000000, 0xffffffff, 0x001fffff,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0xffffffff, 0x001fffff,
+		0x00000000, 0x00000000, 0x00000000, 0x20000000,
+	},
+	{	/* 52 */
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x1fffffff, 0xffffffff, 0x0001ffff, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x1fffffff, 0xffffffff, 0x0001ffff, 0x00000001,
+	},
+	{	/* 53 */
+		0xffffffff, 0xffffe000, 0xffff07ff, 0x003fffff,
+		0x3fffffff, 0xffffffff, 0x003eff0f, 0x00000000,
+		0xffffffff, 0xffffe000, 0xffff07ff, 0x07ffffff,
+		0x3fffffff, 0xffffffff, 0x003eff0f, 0x00000000,
+	},
+	{	/* 54 */
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0x3fffffff, 0xffff0000, 0xff0fffff, 0x0fffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0x3fffffff, 0xffff03ff, 0xff0fffff, 0x0fffffff,
+	},
+	{	/* 55 */
+		0xffffffff, 0xffff00ff, 0xffffffff, 0xf7ff000f,
+		0xffb7f7ff, 0x1bfbfffb, 0x00000000, 0x00000000,
+		0xffffffff, 0xffff00ff, 0xffffffff, 0xf7ff000f,
+		0xffb7f7ff, 0x1bfbfffb, 0x00000000, 0x00000000,
+	},
+	{	/* 56 */
+		0xffffffff, 0x007fffff, 0x003fffff, 0x000000ff,
+		0xffffffbf, 0x07fdffff, 0x00000000, 0x00000000,
+		0xffffffff, 0x007fffff, 0x003fffff, 0x000000ff,
+		0xffffffbf, 0x07fdffff, 0x00000000, 0x00000000,
+	},
+	{	/* 57 */
+		0xfffffd3f, 0x91bfffff, 0x003fffff, 0x007fffff,
+		0x7fffffff, 0x00000000, 0x00000000, 0x0037ffff,
+		0xfffffd3f, 0x91bfffff, 0x003fffff, 0x007fffff,
+		0x7fffffff, 0x00000000, 0x00000000, 0x0037ffff,
+	},
+	{	/* 58 */
+		0x003fffff, 0x03ffffff, 0x00000000, 0x00000000,
+		0xffffffff, 0xc0ffffff, 0x00000000, 0x00000000,
+		0x003fffff, 0x03ffffff, 0x00000000, 0x00000000,
+		0xffffffff, 0xc0ffffff, 0x00000000, 0x00000000,
+	},
+	{	/* 59 */
+		0xfeef0001, 0x003fffff, 0x00000000, 0x1fffffff,
+		0x1fffffff, 0x00000000, 0xfffffeff, 0x0000001f,
+		0xfeeff06f, 0x873fffff, 0x00000000, 0x1fffffff,
+		0x1fffffff, 0x00000000, 0xfffffeff, 0x0000007f,
+	},
+	{	/* 60 */
+		0xffffffff, 0x003fffff, 0x003fffff, 0x0007ffff,
+		0x0003ffff, 0x00000000, 0x00000000, 0x00000000,
+		0xffffffff, 0x003fffff, 0x003fffff, 0x0007ffff,
+		0x0003ffff, 0x00000000, 0x00000000, 0x00000000,
+	},
+	{	/* 61 */
+		0xffffffff, 0xffffffff, 0x000001ff, 0x00000000,
+		0xffffffff, 0x0007ffff, 0xffffffff, 0x0007ffff,
+		0xffffffff, 0xffffffff, 0x000001ff, 0x00000000,
+		0xffffffff, 0x0007ffff, 0xffffffff, 0x0007ffff,
+	},
+	{	/* 62 */
+		0xffffffff, 0x0000000f, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0xffffffff, 0x03ff00ff, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	},
+	{	/* 63 */
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0xffffffff, 0x000303ff, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0xffffffff, 0x00031bff, 0x00000000, 0xe0000000,
+	},
+	{	/* 64 */
+		0x1fffffff, 0xffff0080, 0x0000003f, 0xffff0000,
+		0x00000003, 0xffff0000, 0x0000001f, 0x007fffff,
+		0x1fffffff, 0xffff0080, 0x0001ffff, 0xffff0000,
+		0x0000003f, 0xffff0000, 0x0000001f, 0x007fffff,
+	},
+	{	/* 65 */
+		0xfffffff8, 0x00ffffff, 0x00000000, 0x00260000,
+		0xfffffff8, 0x0000ffff, 0xffff0000, 0x000001ff,
+		0xffffffff, 0xffffffff, 0x0000007f, 0x803fffc0,
+		0xffffffff, 0x07ffffff, 0xffff0004, 0x03ff01ff,
+	},
+	{	/* 66 */
+		0xfffffff8, 0x0000007f, 0xffff0090, 0x0047ffff,
+		0xfffffff8, 0x0007ffff, 0x1400001e, 0x00000000,
+		0xffffffff, 0xffdfffff, 0xffff00f0, 0x004fffff,
+		0xffffffff, 0xffffffff, 0x17ffde1f, 0x00000000,
+	},
+	{	/* 67 */
+		0xfffbffff, 0x80000fff, 0x00000001, 0x00000000,
+		0xbfffbd7f, 0xffff01ff, 0x7fffffff, 0x00000000,
+		0xfffbffff, 0xc0ffffff, 0x00000003, 0x00000000,
+		0xbfffbd7f, 0xffff01ff, 0xffffffff, 0x03ff07ff,
+	},
+	{	/* 68 */
+		0xfff99fe0, 0x23edfdff, 0xe0010000, 0x00000003,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0xfff99fef, 0xfbedfdff, 0xe081399f, 0x001f1fcf,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	},
+	{	/* 69 */
+		0xffffffff, 0x001fffff, 0x80000780, 0x00000003,
+		0xffffffff, 0x0000ffff, 0x000000b0, 0x00000000,
+		0xffffffff, 0xffffffff, 0xc3ff07ff, 0x00000003,
+		0xffffffff, 0xffffffff, 0x03ff00bf, 0x00000000,
+	},
+	{	/* 70 */
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0xffffffff, 0x00007fff, 0x0f000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0xffffffff, 0xff3fffff, 0x3f000001, 0x00000000,
+	},
+	{	/* 71 */
+		0xffffffff, 0x0000ffff, 0x00000010, 0x00000000,
+		0xffffffff, 0x010007ff, 0x00000000, 0x00000000,
+		0xffffffff, 0xffffffff, 0x03ff0011, 0x00000000,
+		0xffffffff, 0x01ffffff, 0x000003ff, 0x00000000,
+	},
+	{	/* 72 */
+		0x07ffffff, 0x00000000, 0x0000007f, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0xe7ffffff, 0x03ff0fff, 0x0000007f, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	},
+	{	/* 73 */
+		0xffffffff, 0x00000fff, 0x00000000, 0x00000000,
+		0x00000000, 0xffffffff, 0xffffffff, 0x80000000,
+		0xffffffff, 0x07ffffff, 0x00000000, 0x00000000,
+		0x00000000, 0xffffffff, 0xffffffff, 0x800003ff,
+	},
+	{	/* 74 */
+		0xff6ff27f, 0x8000ffff, 0x00000002, 0x00000000,
+		0x00000000, 0xfffffcff, 0x0001ffff, 0x0000000a,
+		0xff6ff27f, 0xf9bfffff, 0x03ff000f, 0x00000000,
+		0x00000000, 0xfffffcff, 0xfcffffff, 0x0000001b,
+	},
+	{	/* 75 */
+		0xfffff801, 0x0407ffff, 0xf0010000, 0xffffffff,
+		0x200003ff, 0xffff0000, 0xffffffff, 0x01ffffff,
+		0xffffffff, 0x7fffffff, 0xffff0080, 0xffffffff,
+		0x23ffffff, 0xffff0000, 0xffffffff, 0x01ffffff,
+	},
+	{	/* 76 */
+		0xfffffdff, 0x00007fff, 0x00000001, 0xfffc0000,
+		0x0000ffff, 0x00000000, 0x00000000, 0x00000000,
+		0xfffffdff, 0xff7fffff, 0x03ff0001, 0xfffc0000,
+		0xfffcffff, 0x007ffeff, 0x00000000, 0x00000000,
+	},
+	{	/* 77 */
+		0xfffffb7f, 0x0001ffff, 0x00000040, 0xfffffdbf,
+		0x010003ff, 0x00000000, 0x00000000, 0x00000000,
+		0xfffffb7f, 0xb47fffff, 0x03ff00ff, 0xfffffdbf,
+		0x01fb7fff, 0x000003ff, 0x00000000, 0x00000000,
+	},
+	{	/* 78 */
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x0007ffff,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x007fffff,
+	},
+	{	/* 79 */
+		0xfffdfff4, 0x000fffff, 0x00000000, 0x00000000,
+		0x00000000, 0x00010000, 0x00000000, 0x00000000,
+		0xfffdffff, 0xc7ffffff, 0x03ff0007, 0x00000000,
+		0x00000000, 0x00010000, 0x00000000, 0x00000000,
+	},
+	{	/* 80 */
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0x03ffffff, 0x00000000, 0x00000000, 0x00000000,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0x03ffffff, 0x00000000, 0x00000000, 0x00000000,
+	},
+	{	/* 81 */
+		0xffffffff, 0xffffffff, 0xffffffff, 0x00007fff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0x00007fff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+	},
+	{	/* 82 */
+		0xffffffff, 0xffffffff, 0x0000000f, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0xffffffff, 0xffffffff, 0x0000000f, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	},
+	{	/* 83 */
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0xffff0000, 0xffffffff, 0xffffffff, 0x0001ffff,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0xffff0000, 0xffffffff, 0xffffffff, 0x0001ffff,
+	},
+	{	/* 84 */
+		0xffffffff, 0x0000ffff, 0x0000007e, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0xffffffff, 0x0000ffff, 0x003fffff, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	},
+	{	/* 85 */
+		0xffffffff, 0xffffffff, 0x0000007f, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0xffffffff, 0xffffffff, 0x0000007f, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	},
+	{	/* 86 */
+		0xffffffff, 0x01ffffff, 0x7fffffff, 0xffff0000,
+		0xffffffff, 0x7fffffff, 0xffff0000, 0x00003fff,
+		0xffffffff, 0x01ffffff, 0x7fffffff, 0xffff03ff,
+		0xffffffff, 0x7fffffff, 0xffff03ff, 0x001f3fff,
+	},
+	{	/* 87 */
+		0xffffffff, 0x0000ffff, 0x0000000f, 0xe0fffff8,
+		0x0000ffff, 0x00000000, 0x00000000, 0x00000000,
+		0xffffffff, 0x007fffff, 0x03ff000f, 0xe0fffff8,
+		0x0000ffff, 0x00000000, 0x00000000, 0x00000000,
+	},
+	{	/* 88 */
+		0x00000000, 0x00000000, 0xffffffff, 0xffffffff,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0xffffffff, 0xffffffff,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	},
+	{	/* 89 */
+		0xffffffff, 0xffffffff, 0x000107ff, 0x00000000,
+		0xfff80000, 0x00000000, 0x00000000, 0x0000000b,
+		0xffffffff, 0xffffffff, 0xffff87ff, 0xffffffff,
+		0xffff80ff, 0x00000000, 0x00000000, 0x0003001b,
+	},
+	{	/* 90 */
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0x00ffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0x00ffffff,
+	},
+	{	/* 91 */
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0x003fffff, 0x00000000,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0x003fffff, 0x00000000,
+	},
+	{	/* 92 */
+		0x000001ff, 0x00000000, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x000001ff, 0x00000000, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	},
+	{	/* 93 */
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x6fef0000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x6fef0000,
+	},
+	{	/* 94 */
+		0xffffffff, 0x00040007, 0x00270000, 0xffff00f0,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0x00040007, 0x00270000, 0xffff00f0,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+	},
+	{	/* 95 */
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0x0fffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0x0fffffff,
+	},
+	{	/* 96 */
+		0xffffffff, 0xffffffff, 0xffffffff, 0x1fff07ff,
+		0x03ff01ff, 0x00000000, 0x00000000, 0x00000000,
+		0xffffffff, 0xffffffff, 0xffffffff, 0x1fff07ff,
+		0x63ff01ff, 0x00000000, 0x00000000, 0x00000000,
+	},
+	{	/* 97 */
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0xffffffff, 0xffff3fff, 0x0000007f, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	},
+	{	/* 98 */
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0xf807e3e0,
+		0x00000fe7, 0x00003c00, 0x00000000, 0x00000000,
+	},
+	{	/* 99 */
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x0000001c, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	},
+	{	/* 100 */
+		0xffffffff, 0xffffffff, 0xffdfffff, 0xffffffff,
+		0xdfffffff, 0xebffde64, 0xffffffef, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffdfffff, 0xffffffff,
+		0xdfffffff, 0xebffde64, 0xffffffef, 0xffffffff,
+	},
+	{	/* 101 */
+		0xdfdfe7bf, 0x7bffffff, 0xfffdfc5f, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xdfdfe7bf, 0x7bffffff, 0xfffdfc5f, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+	},
+	{	/* 102 */
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffff3f, 0xf7fffffd, 0xf7ffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffff3f, 0xf7fffffd, 0xf7ffffff,
+	},
+	{	/* 103 */
+		0xffdfffff, 0xffdfffff, 0xffff7fff, 0xffff7fff,
+		0xfffffdff, 0xfffffdff, 0x00000ff7, 0x00000000,
+		0xffdfffff, 0xffdfffff, 0xffff7fff, 0xffff7fff,
+		0xfffffdff, 0xfffffdff, 0xffffcff7, 0xffffffff,
+	},
+	{	/* 104 */
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0xffffffff, 0xf87fffff, 0xffffffff, 0x00201fff,
+		0xf8000010, 0x0000fffe, 0x00000000, 0x00000000,
+	},
+	{	/* 105 */
+		0x7fffffff, 0x000007e0, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x7fffffff, 0x000007e0, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	},
+	{	/* 106 */
+		0x00000000, 0xffff0000, 0xffffffff, 0x00003fff,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0xf9ffff7f, 0xffff07db, 0xffffffff, 0x00003fff,
+		0x00008000, 0x00000000, 0x00000000, 0x00000000,
+	},
+	{	/* 107 */
+		0xffffffff, 0x3f801fff, 0x00004000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0xffffffff, 0x3fff1fff, 0x000043ff, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	},
+	{	/* 108 */
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0xffff0000, 0x00003fff, 0xffffffff, 0x00000fff,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0xffff0000, 0x00007fff, 0xffffffff, 0x03ffffff,
+	},
+	{	/* 109 */
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0xffff0000, 0x00000fff,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0xffff0000, 0x03ffffff,
+	},
+	{	/* 110 */
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x7fff6f7f,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x7fff6f7f,
+	},
+	{	/* 111 */
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0x0000001f, 0x00000000,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0x007f001f, 0x00000000,
+	},
+	{	/* 112 */
+		0xffffffff, 0xffffffff, 0x0000080f, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0xffffffff, 0xffffffff, 0x03ff0fff, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	},
+	{	/* 113 */
+		0xffffffef, 0x0af7fe96, 0xaa96ea84, 0x5ef7f796,
+		0x0ffffbff, 0x0ffffbee, 0x00000000, 0x00000000,
+		0xffffffef, 0x0af7fe96, 0xaa96ea84, 0x5ef7f796,
+		0x0ffffbff, 0x0ffffbee, 0x00000000, 0x00000000,
+	},
+	{	/* 114 */
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x03ff0000,
+	},
+	{	/* 115 */
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0x00000000,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0x00000000,
+	},
+	{	/* 116 */
+		0xffffffff, 0x03ffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0x03ffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+	},
+	{	/* 117 */
+		0x3fffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0x3fffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+	},
+	{	/* 118 */
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffff0003, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffff0003, 0xffffffff, 0xffffffff,
+	},
+	{	/* 119 */
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0x00000001,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0x00000001,
+	},
+	{	/* 120 */
+		0x3fffffff, 0x00000000, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x3fffffff, 0x00000000, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	},
+	{	/* 121 */
+		0xffffffff, 0xffffffff, 0xffff07ff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffff07ff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+	},
+	{	/* 122 */
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0x0000ffff, 0x00000000, 0x00000000,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0x0000ffff, 0x00000000, 0x00000000,
+	},
+	{	/* 123 */
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+		0xffffffff, 0xffffffff, 0xffffffff, 0x0000ffff,
+	},
+};
+#endif
@@ -0,0 +1,52 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+#ifndef PUB_UNITS_H
+#define PUB_UNITS_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * Search kernels over code units that are either 1 byte (Latin-1) or 2 bytes
+ * (UTF-16) wide. Each width has scalar, SSE2 and AVX2 versions; units_get_ops
+ * picks the best one the cpu supports. The ops are stateless, and are safe to
+ * call from multiple threads.
+ */
+
+/* Returns the index of the first matching unit in [0, len), or len. */
+typedef size_t fn_units_find(const void *units,
+							 size_t len);
+
+/*
+ * Returns the # of leading units in [0, len) that match. Sets
+ * *has_line_term if any of them is a line terminator; leaves it alone
+ * otherwise.
+ */
+typedef size_t fn_units_span(const void *units,
+							 size_t len,
+							 bool *has_line_term);
+
+struct units_ops {
+	/* \n, \r, U+2028 and U+2029 */
+	fn_units_find	*find_line_term;
+
+	/* '*', or a line terminator; i.e. the stops within a multi-line comment */
+	fn_units_find	*find_star_or_line_term;
+
+	/* ', ", \\, \n or \r; i.e. the stops within a string literal */
+	fn_units_find	*find_string_stop;
+
+	/* `, $ or \\; i.e. the stops within a template */
+	fn_units_find	*find_template_stop;
+
+	/*
+	 * ASCII white space: ' ', \t, \v, \f, \n and \r. The rest of the
+	 * WhiteSpace and LineTerminator code points are left to the caller.
+	 */
+	fn_units_span	*span_white_space;
+};
+
+void	units_get_ops(size_t unit_size,
+					  struct units_ops *ops);
+#endif
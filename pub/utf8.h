@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+#ifndef PUB_UTF8_H
+#define PUB_UTF8_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <uchar.h>
+
+/*
+ * The transcoder does not depend on the locale, and keeps no state between
+ * calls. It is safe to call it from multiple threads.
+ *
+ * Embedded nul chars are decoded as U+0000.
+ */
+
+/*
+ * Validates src, and returns the exact # of UTF-16 units it decodes into,
+ * along with the largest code point it contains. All-ASCII src reports 0x7f,
+ * and an empty one reports 0.
+ */
+int	utf8_to_utf16_length(const char *src,
+						 size_t src_len,
+						 size_t *out_len,
+						 char32_t *out_max);
+
+/*
+ * Decodes src into dst, which must have room for the # of units returned by
+ * utf8_to_utf16_length. Returns the # of units written.
+ */
+size_t	utf8_to_utf16(const char *src,
+					  size_t src_len,
+					  char16_t *dst);
+
+/*
+ * Decodes src, whose code points must all be <= U+00FF, into one byte per
+ * code point. Returns the # of bytes written.
+ */
+size_t	utf8_to_latin1(const char *src,
+					   size_t src_len,
+					   uint8_t *dst);
+#endif
@@ -0,0 +1,100 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+#include <pub/arena.h>
+#include <pub/error.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stddef.h>
+
+struct arena_slab {
+	struct arena_slab	*next;
+	_Alignas(max_align_t) unsigned char	data[];
+};
+
+/*
+ * Only the head slab is bumped; [curr, end) is what remains of it. end is 0
+ * until the first regular slab.
+ */
+struct arena {
+	struct arena_slab	*slabs;
+	size_t				slab_size;
+	uintptr_t			curr;
+	uintptr_t			end;
+};
+/*******************************************************************/
+int arena_new(size_t slab_size,
+			  struct arena **out)
+{
+	struct arena *arena;
+
+	arena = calloc(1, sizeof(*arena));
+	if (arena == NULL)
+		return ERR_NO_MEMORY;
+	arena->slab_size = slab_size;
+	*out = arena;
+	return ERR_SUCCESS;
+}
+
+int arena_delete(struct arena *this)
+{
+	struct arena_slab *slab, *next;
+
+	for (slab = this->slabs; slab; slab = next) {
+		next = slab->next;
+		free(slab);
+	}
+	free(this);
+	return ERR_SUCCESS;
+}
+
+static inline
+uintptr_t arena_align(uintptr_t p,
+					  size_t align)
+{
+	return (p + align - 1) & ~(uintptr_t)(align - 1);
+}
+
+void *arena_alloc(struct arena *this,
+				  size_t size,
+				  size_t align)
+{
+	uintptr_t p;
+	struct arena_slab *slab;
+
+	p = arena_align(this->curr, align);
+	if (this->end && p <= this->end && this->end - p >= size) {
+		this->curr = p + size;
+		return (void *)p;
+	}
+
+	/*
+	 * A large allocation gets a slab of its own, placed behind the head, so
+	 * that the rest of the head slab is not wasted.
+	 */
+	if (size + align > this->slab_size) {
+		slab = malloc(sizeof(*slab) + size + align);
+		if (slab == NULL)
+			return NULL;
+		if (this->slabs) {
+			slab->next = this->slabs->next;
+			this->slabs->next = slab;
+		} else {
+			slab->next = NULL;
+			this->slabs = slab;
+		}
+		return (void *)arena_align((uintptr_t)slab->data, align);
+	}
+
+	slab = malloc(sizeof(*slab) + this->slab_size);
+	if (slab == NULL)
+		return NULL;
+	slab->next = this->slabs;
+	this->slabs = slab;
+
+	p = arena_align((uintptr_t)slab->data, align);
+	this->curr = p + size;
+	this->end = (uintptr_t)slab->data + this->slab_size;
+	return (void *)p;
+}
@@ -0,0 +1,259 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+#include <pub/atom.h>
+#include <pub/arena.h>
+#include <pub/error.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <uchar.h>
+
+#define ATOM_SLAB_SIZE		(64 * 1024)
+#define ATOM_MIN_SLOTS		256
+
+struct atom {
+	const void	*units;
+	size_t		len;
+	uint32_t	hash;
+	uint32_t	unit_size;
+};
+
+/*
+ * An open-addressed (linear probing) table of atom ids, kept at most half
+ * full. The atom with id n is at atoms[n - 1]. The units of the atoms are
+ * allocated from the arena, and never move.
+ */
+struct atom_table {
+	uint32_t		*slots;
+	size_t			num_slots;
+	struct atom		*atoms;
+	size_t			num_atoms;
+	size_t			atoms_size;
+	struct arena	*arena;
+};
+/*******************************************************************/
+static inline
+char16_t atom_unit(const void *units,
+				   size_t unit_size,
+				   size_t i)
+{
+	if (unit_size == 1)
+		return ((const unsigned char *)units)[i];
+	return ((const char16_t *)units)[i];
+}
+
+/*
+ * FNV-1a over the values of the units; the width does not matter. Also
+ * returns the OR of the units, which is > 0xff iff any of them is.
+ */
+static
+uint32_t atom_hash(const void *units,
+				   size_t len,
+				   size_t unit_size,
+				   char16_t *out_bits)
+{
+	size_t i;
+	uint32_t hash;
+	char16_t cu, bits;
+
+	hash = 0x811c9dc5;
+	bits = 0;
+	for (i = 0; i < len; ++i) {
+		cu = atom_unit(units, unit_size, i);
+		bits |= cu;
+		hash = (hash ^ cu) * 0x01000193;
+	}
+	*out_bits = bits;
+	return hash;
+}
+
+static
+bool atom_equals(const struct atom *this,
+				 const void *units,
+				 size_t len,
+				 size_t unit_size)
+{
+	size_t i;
+
+	if (this->len != len)
+		return false;
+	if (this->unit_size == unit_size)
+		return !memcmp(this->units, units, len * unit_size);
+	for (i = 0; i < len; ++i)
+		if (atom_unit(this->units, this->unit_size, i) !=
+			atom_unit(units, unit_size, i))
+			return false;
+	return true;
+}
+/*******************************************************************/
+static inline
+void *atom_table_alloc(struct atom_table *this,
+					   size_t size)
+{
+	return arena_alloc(this->arena, size, _Alignof(char16_t));
+}
+
+static
+int atom_table_grow(struct atom_table *this)
+{
+	size_t i, j, mask, num_slots;
+	uint32_t *slots;
+
+	num_slots = this->num_slots ? this->num_slots << 1 : ATOM_MIN_SLOTS;
+	slots = calloc(num_slots, sizeof(*slots));
+	if (slots == NULL)
+		return ERR_NO_MEMORY;
+
+	mask = num_slots - 1;
+	for (i = 0; i < this->num_atoms; ++i) {
+		for (j = this->atoms[i].hash & mask; slots[j]; j = (j + 1) & mask)
+			;
+		slots[j] = i + 1;
+	}
+	free(this->slots);
+	this->slots = slots;
+	this->num_slots = num_slots;
+	return ERR_SUCCESS;
+}
+
+static
+int atom_table_add(struct atom_table *this,
+				   const void *units,
+				   size_t len,
+				   size_t unit_size,
+				   uint32_t hash,
+				   char16_t bits)
+{
+	size_t i, size;
+	struct atom *atom;
+	unsigned char *bytes;
+	char16_t *wide;
+
+	if (this->num_atoms == UINT32_MAX)
+		return ERR_NO_MEMORY;
+
+	if (this->num_atoms == this->atoms_size) {
+		size = this->atoms_size ? this->atoms_size << 1 : ATOM_MIN_SLOTS;
+		atom = realloc(this->atoms, size * sizeof(*atom));
+		if (atom == NULL)
+			return ERR_NO_MEMORY;
+		this->atoms = atom;
+		this->atoms_size = size;
+	}
+
+	atom = &this->atoms[this->num_atoms];
+	atom->len = len;
+	atom->hash = hash;
+	atom->unit_size = bits > 0xff ? sizeof(char16_t) : 1;
+
+	/* Store in the narrowest width. */
+	if (atom->unit_size == unit_size) {
+		bytes = atom_table_alloc(this, len * unit_size);
+		if (bytes == NULL)
+			return ERR_NO_MEMORY;
+		memcpy(bytes, units, len * unit_size);
+		atom->units = bytes;
+	} else if (atom->unit_size == 1) {
+		bytes = atom_table_alloc(this, len);
+		if (bytes == NULL)
+			return ERR_NO_MEMORY;
+		for (i = 0; i < len; ++i)
+			bytes[i] = ((const char16_t *)units)[i];
+		atom->units = bytes;
+	} else {
+		wide = atom_table_alloc(this, len * sizeof(char16_t));
+		if (wide == NULL)
+			return ERR_NO_MEMORY;
+		for (i = 0; i < len; ++i)
+			wide[i] = ((const unsigned char *)units)[i];
+		atom->units = wide;
+	}
+	++this->num_atoms;
+	return ERR_SUCCESS;
+}
+/*******************************************************************/
+int atom_table_new(struct atom_table **out)
+{
+	struct atom_table *table;
+
+	table = calloc(1, sizeof(*table));
+	if (table == NULL)
+		return ERR_NO_MEMORY;
+	if (arena_new(ATOM_SLAB_SIZE, &table->arena)) {
+		free(table);
+		return ERR_NO_MEMORY;
+	}
+	*out = table;
+	return ERR_SUCCESS;
+}
+
+int atom_table_delete(struct atom_table *this)
+{
+	arena_delete(this->arena);
+	free(this->atoms);
+	free(this->slots);
+	free(this);
+	return ERR_SUCCESS;
+}
+
+int atom_table_intern(struct atom_table *this,
+					  const void *units,
+					  size_t len,
+					  size_t unit_size,
+					  uint32_t *out)
+{
+	int err;
+	size_t i, mask;
+	uint32_t hash, id;
+	char16_t bits;
+	const struct atom *atom;
+
+	if (unit_size != 1 && unit_size != sizeof(char16_t))
+		return ERR_INVALID_PARAMETER;
+
+	if (2 * (this->num_atoms + 1) > this->num_slots) {
+		err = atom_table_grow(this);
+		if (err)
+			return err;
+	}
+
+	hash = atom_hash(units, len, unit_size, &bits);
+	mask = this->num_slots - 1;
+	for (i = hash & mask; (id = this->slots[i]); i = (i + 1) & mask) {
+		atom = &this->atoms[id - 1];
+		if (atom->hash == hash && atom_equals(atom, units, len, unit_size)) {
+			*out = id;
+			return ERR_SUCCESS;
+		}
+	}
+
+	err = atom_table_add(this, units, len, unit_size, hash, bits);
+	if (err)
+		return err;
+	id = this->num_atoms;
+	this->slots[i] = id;
+	*out = id;
+	return ERR_SUCCESS;
+}
+
+const void *atom_table_get(const struct atom_table *this,
+						   uint32_t atom,
+						   size_t *len,
+						   size_t *unit_size)
+{
+	const struct atom *a;
+
+	if (atom == ATOM_NONE || atom > this->num_atoms)
+		return NULL;
+	a = &this->atoms[atom - 1];
+	*len = a->len;
+	*unit_size = a->unit_size;
+	return a->units;
+}
+
+size_t atom_table_count(const struct atom_table *this)
+{
+	return this->num_atoms;
+}
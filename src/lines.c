@@ -0,0 +1,122 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+#include <pub/lines.h>
+#include <pub/error.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <uchar.h>
+
+static inline
+char16_t line_index_unit(const struct line_index *this,
+						 const void *units,
+						 size_t i)
+{
+	if (this->unit_size == 1)
+		return ((const unsigned char *)units)[i];
+	return ((const char16_t *)units)[i];
+}
+
+static
+int line_index_push(struct line_index *this,
+					size_t start)
+{
+	size_t size;
+	size_t *starts;
+
+	if (this->num_starts == this->size) {
+		size = this->size << 1;
+		starts = realloc(this->starts, size * sizeof(*starts));
+		if (starts == NULL)
+			return ERR_NO_MEMORY;
+		this->starts = starts;
+		this->size = size;
+	}
+	this->starts[this->num_starts++] = start;
+	return ERR_SUCCESS;
+}
+/*******************************************************************/
+int line_index_new(size_t unit_size,
+				   struct line_index **out)
+{
+	struct line_index *index;
+
+	index = calloc(1, sizeof(*index));
+	if (index == NULL)
+		return ERR_NO_MEMORY;
+
+	index->size = 64;
+	index->starts = malloc(index->size * sizeof(*index->starts));
+	if (index->starts == NULL) {
+		free(index);
+		return ERR_NO_MEMORY;
+	}
+	index->starts[index->num_starts++] = 0;
+	index->unit_size = unit_size;
+	units_get_ops(unit_size, &index->ops);
+	*out = index;
+	return ERR_SUCCESS;
+}
+
+int line_index_delete(struct line_index *this)
+{
+	free(this->starts);
+	free(this);
+	return ERR_SUCCESS;
+}
+
+int line_index_add(struct line_index *this,
+				   const void *units,
+				   size_t len)
+{
+	int err;
+	size_t i;
+	char16_t cu;
+	const char *p;
+
+	p = units;
+	for (i = 0; ; ++i) {
+		i += this->ops.find_line_term(p + i * this->unit_size, len - i);
+		if (i == len)
+			break;
+
+		/* The \n of a \r\n moves the start pushed for the \r. */
+		cu = line_index_unit(this, units, i);
+		if (cu == '\n' && (i ? line_index_unit(this, units, i - 1) == '\r' :
+						   this->is_cr_last)) {
+			this->starts[this->num_starts - 1] = this->num_units + i + 1;
+			continue;
+		}
+		err = line_index_push(this, this->num_units + i + 1);
+		if (err)
+			return err;
+	}
+
+	if (len)
+		this->is_cr_last = line_index_unit(this, units, len - 1) == '\r';
+	this->num_units += len;
+	return ERR_SUCCESS;
+}
+
+/* Binary search for the last line that starts at or before pos. */
+void line_index_find(const struct line_index *this,
+					 size_t pos,
+					 size_t *row,
+					 size_t *col)
+{
+	size_t lo, hi, mid;
+
+	assert(pos <= this->num_units);
+	lo = 0;
+	hi = this->num_starts;
+	while (hi - lo > 1) {
+		mid = lo + (hi - lo) / 2;
+		if (this->starts[mid] <= pos)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	*row = lo;
+	*col = pos - this->starts[lo];
+}
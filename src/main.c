@@ -4,92 +4,192 @@
 #include <pub/error.h>
 #include <pub/system.h>
 #include <pub/parser.h>
+#include <pub/source.h>
+#include <pub/pool.h>
 
 #include <assert.h>
 #include <stdio.h>
-#include <locale.h>
 #include <string.h>
 #include <stdlib.h>
 #include <uchar.h>
 #include <stdbool.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
-/* Assuming no embedded nul chars in the source stream */
+/* A failure that has no position, e.g. of a setup, leaves the row at 0. */
 static
-int mbr_to_c16(const char *src, const char16_t **out, size_t *out_size)
+int parse_script(struct parser *parser,
+				 bool is_memoized,
+				 size_t *row,
+				 size_t *col)
 {
-	int count, err;
-	size_t src_size, dst_size;
-	mbstate_t state;
-	char16_t cu, *dst;
-	const char *locale;
+	int err;
 
-	src_size = *out_size;
-	dst_size = 0;
+	err = ERR_SUCCESS;
+	if (is_memoized)
+		err = parser_memoize(parser);
+	if (err)
+		return err;
 
-	err = ERR_NO_MEMORY;
-	dst = malloc(2 * src_size * sizeof(char16_t));
-	if (dst == NULL)
-		goto err0;
+	err = parser_parse_script(parser);
+	if (err && parser_locate_error(parser, row, col))
+		*row = 0;
+	return err;
+}
 
-	locale = setlocale(LC_ALL, NULL);
-	setlocale(LC_ALL, "en_US.utf8");
-	memset(&state, 0, sizeof(state));
+static
+int parse_stream(int fd,
+				 bool is_memoized,
+				 size_t *row,
+				 size_t *col)
+{
+	int err;
+	struct parser *parser;
 
-	while (src_size) {
-		count = mbrtoc16(&cu, src, src_size, &state);
-		if (count == -3)	/* Low Surr. */
-			count = 0;
-		else if (count == -2 || count == -1)
-			break;
-		else if (count == 0)	/* NUL char */
-			count = 1;
+	err = parser_new_stream(fd, &parser);
+	if (err)
+		return err;
+	err = parse_script(parser, is_memoized, row, col);
+	parser_delete(parser);
+	return err;
+}
 
-		dst[dst_size++] = cu;
-		src += count;
-		src_size -= count;
-	}
-	setlocale(LC_ALL, locale);
+/*
+ * Regular files are mapped. Pipes, FIFOs, etc. are streamed. The path "-"
+ * streams the stdin. Only the mapped files can have their scanners
+ * pipelined, or be prescanned (num_segments > 0).
+ */
+static
+int parse_path(const char *path,
+			   bool is_pipelined,
+			   size_t num_segments,
+			   bool is_memoized,
+			   size_t *row,
+			   size_t *col)
+{
+	int fd, err;
+	size_t num_units, unit_size;
+	const void *units;
+	struct stat st;
+	struct source *source;
+	struct parser *parser;
 
-	err = ERR_BAD_FILE;
-	if (src_size)
-		goto err1;
+	if (!strcmp(path, "-"))
+		return parse_stream(STDIN_FILENO, is_memoized, row, col);
 
-	err = ERR_NO_MEMORY;
-	dst = realloc(dst, dst_size * sizeof(char16_t));
-	if (dst == NULL)
-		goto err1;
+	if (stat(path, &st))
+		return ERR_OPEN_FILE;
 
-	*out_size = dst_size;
-	*out = dst;
-	return ERR_SUCCESS;
-err1:
-	free(dst);
-err0:
+	if (!S_ISREG(st.st_mode)) {
+		fd = open(path, O_RDONLY);
+		if (fd < 0)
+			return ERR_OPEN_FILE;
+		err = parse_stream(fd, is_memoized, row, col);
+		close(fd);
+		return err;
+	}
+
+	err = source_new(path, &source);
+	if (err)
+		return err;
+
+	/* The parser reads the units in place; source must outlive it. */
+	units = source_units(source, &num_units, &unit_size);
+	err = parser_new(units, num_units, unit_size, &parser);
+	if (!err) {
+		if (is_pipelined)
+			err = parser_start_pipeline(parser);
+		else if (num_segments)
+			err = parser_prescan(parser, num_segments);
+		if (!err)
+			err = parse_script(parser, is_memoized, row, col);
+		parser_delete(parser);
+	}
+	source_delete(source);
 	return err;
 }
 
-int main(int argc, char **argv)
+/*******************************************************************/
+struct batch_job {
+	char	*path;
+	size_t	index;	/* In the paths.file */
+	off_t	size;
+	int		err;
+	bool	is_pipelined;
+	bool	is_memoized;
+	size_t	num_segments;
+};
+
+static const
+char *g_err_names[] = {
+	"success",
+	"no match",
+	"bad file",
+	"unsupported",
+	"invalid parameter",
+	"not found",
+	"no memory",
+	"open file",
+	"end of file",
+	"unexpected end of file",
+	"invalid code point",
+	"invalid token",
+	"syntax",
+};
+
+static
+const char *error_name(int err)
 {
-	int i, len, err;
-	FILE *files, *file;
-	size_t size;
-	char *src;
-	const char16_t *dst;
-	struct parser *parser;
-	static char path[1024];
+	if (err < 0 || (size_t)err >= ARRAY_SIZE(g_err_names))
+		return "unknown";
+	return g_err_names[err];
+}
 
-	if (argc != 2) {
-		fprintf(stderr, "%s: Usage: %s paths.file\n", __func__, argv[0]);
-		return ERR_INVALID_PARAMETER;
-	}
+static
+void batch_job_run(void *arg)
+{
+	size_t row, col;
+	struct batch_job *this = arg;
 
-	files = fopen(argv[1], "r");
-	if (files == NULL) {
-		fprintf(stderr, "%s: Error: Opening %s\n", __func__, argv[1]);
-		return ERR_OPEN_FILE;
-	}
+	row = col = 0;
+	this->err = parse_path(this->path, this->is_pipelined,
+						   this->num_segments, this->is_memoized, &row, &col);
+	if (row)
+		printf("%s: %s:%zu:%zu: %s\n", __func__, this->path, row, col,
+			   error_name(this->err));
+	else
+		printf("%s: %s: %s\n", __func__, this->path, error_name(this->err));
+}
+
+/* Largest first. Ties, and streams (size 0), in the paths.file order. */
+static
+int batch_job_cmp(const void *a,
+				  const void *b)
+{
+	const struct batch_job *ja = a;
+	const struct batch_job *jb = b;
+
+	if (ja->size != jb->size)
+		return ja->size < jb->size ? 1 : -1;
+	return ja->index < jb->index ? -1 : ja->index > jb->index;
+}
+
+static
+int batch_load(FILE *files,
+			   struct batch_job **out,
+			   size_t *out_num_jobs)
+{
+	int i, len, err;
+	size_t num_jobs, size;
+	struct stat st;
+	struct batch_job *jobs, *job;
+	static char path[1024];
 
 	err = ERR_SUCCESS;
+	jobs = NULL;
+	num_jobs = size = 0;
 	while (fgets(path, 1024, files)) {
 		len = strlen(path);
 
@@ -105,40 +205,164 @@ int main(int argc, char **argv)
 		if (i < 0)
 			continue;
 
-		printf("%s: Opening %s\n", __func__, path);
-		file = fopen(path, "rb");
-		if (file == NULL) {
-			fprintf(stderr, "%s: Error: Opening %s\n", __func__, path);
-			continue;
+		if (num_jobs == size) {
+			size = size ? 2 * size : 64;
+			job = realloc(jobs, size * sizeof(*jobs));
+			err = ERR_NO_MEMORY;
+			if (job == NULL)
+				break;
+			jobs = job;
 		}
 
+		job = &jobs[num_jobs];
+		job->path = strdup(path);
 		err = ERR_NO_MEMORY;
-		fseek(file, 0, SEEK_END);
-		size = ftell(file);
-		src = malloc(size + 1);
-		if (src == NULL) {
-			fprintf(stderr, "%s: Error: malloc(%ld)\n", __func__, size);
-			fclose(file);
+		if (job->path == NULL)
 			break;
-		}
+		job->index = num_jobs++;
+		job->err = ERR_SUCCESS;
+		job->size = 0;
+		if (strcmp(path, "-") && !stat(path, &st) && S_ISREG(st.st_mode))
+			job->size = st.st_size;
+		err = ERR_SUCCESS;
+	}
 
-		src[size] = 0;
-		fseek(file, 0, SEEK_SET);	/* non-portable */
-		fread(src, size, 1, file);
-		fclose(file);
+	if (err) {
+		for (size = 0; size < num_jobs; ++size)
+			free(jobs[size].path);
+		free(jobs);
+		return err;
+	}
+	*out = jobs;
+	*out_num_jobs = num_jobs;
+	return ERR_SUCCESS;
+}
 
-		err = mbr_to_c16(src, &dst, &size);
-		free(src);
-		if (err)
-			break;
+static
+double elapsed(const struct timespec *start)
+{
+	struct timespec now;
 
-		/* ownership of dst passed */
-		err = parser_new(dst, size, &parser);
-		if (!err)
-			err = parser_parse_script(parser);
-		parser_delete(parser);
-		break;
+	timespec_get(&now, TIME_UTC);
+	return (now.tv_sec - start->tv_sec) +
+		(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static
+void usage(const char *name)
+{
+	fprintf(stderr, "%s: Usage: %s [-j num_workers] [-p | -s num_segments] "
+			"[-m] paths.file\n",
+			__func__, name);
+}
+
+/*
+ * Every file listed in paths.file is parsed. The files are spread over
+ * num_workers threads (by default, one per online cpu), largest first. With
+ * -p, each file is scanned on a thread of its own, ahead of its parser. With
+ * -s, each file is tokenized before it is parsed, in up to num_segments
+ * segments scanned in parallel; for very large files. With -m, the parser
+ * memoizes its expressions.
+ */
+int main(int argc, char **argv)
+{
+	int opt, err;
+	bool is_pipelined, is_memoized;
+	long num_workers, num_segments;
+	size_t i, first, num_jobs, num_failed;
+	off_t total_size;
+	FILE *files;
+	struct timespec start;
+	struct batch_job *jobs;
+	struct pool_job *pool_jobs;
+
+	num_workers = sysconf(_SC_NPROCESSORS_ONLN);
+	is_pipelined = is_memoized = false;
+	num_segments = 0;
+	while ((opt = getopt(argc, argv, "j:mps:")) != -1) {
+		if (opt == 'p') {
+			is_pipelined = true;
+			continue;
+		}
+		if (opt == 'm') {
+			is_memoized = true;
+			continue;
+		}
+		if (opt == 's') {
+			num_segments = strtol(optarg, NULL, 0);
+			if (num_segments <= 0) {
+				usage(argv[0]);
+				return ERR_INVALID_PARAMETER;
+			}
+			continue;
+		}
+		if (opt != 'j') {
+			usage(argv[0]);
+			return ERR_INVALID_PARAMETER;
+		}
+		num_workers = strtol(optarg, NULL, 0);
+		if (num_workers <= 0) {
+			usage(argv[0]);
+			return ERR_INVALID_PARAMETER;
+		}
+	}
+	num_workers = num_workers > 0 ? num_workers : 1;
+
+	if (optind != argc - 1 || (is_pipelined && num_segments)) {
+		usage(argv[0]);
+		return ERR_INVALID_PARAMETER;
 	}
+
+	files = fopen(argv[optind], "r");
+	if (files == NULL) {
+		fprintf(stderr, "%s: Error: Opening %s\n", __func__, argv[optind]);
+		return ERR_OPEN_FILE;
+	}
+
+	err = batch_load(files, &jobs, &num_jobs);
 	fclose(files);
+	if (err)
+		return err;
+
+	qsort(jobs, num_jobs, sizeof(*jobs), batch_job_cmp);
+
+	err = ERR_NO_MEMORY;
+	pool_jobs = malloc((num_jobs ? num_jobs : 1) * sizeof(*pool_jobs));
+	if (pool_jobs == NULL)
+		goto err0;
+
+	total_size = 0;
+	for (i = 0; i < num_jobs; ++i) {
+		pool_jobs[i].fn = batch_job_run;
+		pool_jobs[i].arg = &jobs[i];
+		jobs[i].is_pipelined = is_pipelined;
+		jobs[i].num_segments = num_segments;
+		jobs[i].is_memoized = is_memoized;
+		total_size += jobs[i].size;
+	}
+
+	timespec_get(&start, TIME_UTC);
+	err = pool_run(pool_jobs, num_jobs, num_workers);
+	free(pool_jobs);
+	if (err)
+		goto err0;
+
+	/* Report the error of the earliest failed file in the paths.file. */
+	num_failed = first = 0;
+	for (i = 0; i < num_jobs; ++i) {
+		if (jobs[i].err == ERR_SUCCESS)
+			continue;
+		if (num_failed++ == 0 || jobs[i].index < jobs[first].index)
+			first = i;
+	}
+	err = num_failed ? jobs[first].err : ERR_SUCCESS;
+
+	printf("%s: %zu files, %zu ok, %zu failed, %lld bytes, %ld workers, "
+		   "%.3f s\n", __func__, num_jobs, num_jobs - num_failed,
+		   num_failed, (long long)total_size, num_workers, elapsed(&start));
+err0:
+	for (i = 0; i < num_jobs; ++i)
+		free(jobs[i].path);
+	free(jobs);
 	return err;
 }
@@ -0,0 +1,236 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+#include <prv/memo.h>
+#include <prv/parser.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MEMO_MIN_SLOTS		64
+#define MEMO_MIN_ENTRIES	64
+
+/*
+ * A slot is in use iff its gen is that of the memo. Dropping results bumps
+ * the gen, which empties all slots at once; the results that are kept are
+ * then linked again.
+ */
+struct memo_slot {
+	uint32_t	gen;
+	uint32_t	index;	/* Into entries */
+};
+
+/* An open-addressed (linear probing) table, kept at most half full. */
+struct memo {
+	struct memo_entry	*entries;
+	size_t				num_entries;
+	size_t				entries_size;
+	struct memo_slot	*slots;
+	size_t				num_slots;
+	uint32_t			gen;
+};
+/*******************************************************************/
+static
+size_t memo_hash(uint16_t type,
+				 uint32_t flags,
+				 size_t pos)
+{
+	uint64_t hash;
+
+	hash = (uint64_t)pos * 0x9e3779b97f4a7c15ull;
+	hash ^= (uint64_t)type << 32 | flags;
+	hash ^= hash >> 29;
+	hash *= 0xbf58476d1ce4e5b9ull;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+static
+void memo_link(struct memo *this,
+			   uint32_t index)
+{
+	size_t i, mask;
+	const struct memo_entry *entry;
+
+	entry = &this->entries[index];
+	mask = this->num_slots - 1;
+	i = memo_hash(entry->type, entry->flags, entry->pos) & mask;
+	while (this->slots[i].gen == this->gen)
+		i = (i + 1) & mask;
+	this->slots[i].gen = this->gen;
+	this->slots[i].index = index;
+}
+
+static
+void memo_relink(struct memo *this)
+{
+	size_t i;
+
+	if (++this->gen == 0) {
+		memset(this->slots, 0, this->num_slots * sizeof(*this->slots));
+		this->gen = 1;
+	}
+	for (i = 0; i < this->num_entries; ++i)
+		memo_link(this, i);
+}
+
+/* Whether the tables would outgrow MEMO_MAX_BYTES to take another entry. */
+static
+bool memo_is_full(const struct memo *this)
+{
+	size_t num_entries, num_slots;
+
+	num_entries = this->entries_size;
+	if (this->num_entries == num_entries)
+		num_entries <<= 1;
+	num_slots = this->num_slots;
+	if ((this->num_entries + 1) * 2 > num_slots)
+		num_slots <<= 1;
+	return num_entries * sizeof(*this->entries) +
+		num_slots * sizeof(*this->slots) > MEMO_MAX_BYTES;
+}
+
+static
+int memo_reserve(struct memo *this)
+{
+	size_t size;
+	struct memo_entry *entries;
+	struct memo_slot *slots;
+
+	if (this->num_entries == this->entries_size) {
+		size = this->entries_size << 1;
+		entries = realloc(this->entries, size * sizeof(*entries));
+		if (entries == NULL)
+			return ERR_NO_MEMORY;
+		this->entries = entries;
+		this->entries_size = size;
+	}
+
+	if ((this->num_entries + 1) * 2 <= this->num_slots)
+		return ERR_SUCCESS;
+
+	size = this->num_slots << 1;
+	slots = calloc(size, sizeof(*slots));
+	if (slots == NULL)
+		return ERR_NO_MEMORY;
+	free(this->slots);
+	this->slots = slots;
+	this->num_slots = size;
+	this->gen = 0;	/* Bumped to 1 */
+	memo_relink(this);
+	return ERR_SUCCESS;
+}
+
+/* Keeps the results that start at or after lo, and read only before hi. */
+static
+void memo_filter(struct memo *this,
+				 size_t lo,
+				 size_t hi)
+{
+	size_t i, n;
+	struct memo_entry *entry;
+
+	for (i = n = 0; i < this->num_entries; ++i) {
+		entry = &this->entries[i];
+		if (entry->pos >= lo && entry->reach <= hi)
+			this->entries[n++] = *entry;
+		else
+			parse_node_delete(entry->node);
+	}
+	if (n == this->num_entries)
+		return;
+	this->num_entries = n;
+	memo_relink(this);
+}
+/*******************************************************************/
+int memo_new(struct memo **out)
+{
+	struct memo *memo;
+
+	memo = calloc(1, sizeof(*memo));
+	if (memo == NULL)
+		goto err0;
+
+	memo->entries = malloc(MEMO_MIN_ENTRIES * sizeof(*memo->entries));
+	if (memo->entries == NULL)
+		goto err1;
+
+	memo->slots = calloc(MEMO_MIN_SLOTS, sizeof(*memo->slots));
+	if (memo->slots == NULL)
+		goto err2;
+
+	memo->entries_size = MEMO_MIN_ENTRIES;
+	memo->num_slots = MEMO_MIN_SLOTS;
+	memo->gen = 1;
+	*out = memo;
+	return ERR_SUCCESS;
+err2:
+	free(memo->entries);
+err1:
+	free(memo);
+err0:
+	return ERR_NO_MEMORY;
+}
+
+int memo_delete(struct memo *this)
+{
+	size_t i;
+
+	for (i = 0; i < this->num_entries; ++i)
+		parse_node_delete(this->entries[i].node);
+	free(this->entries);
+	free(this->slots);
+	free(this);
+	return ERR_SUCCESS;
+}
+
+const struct memo_entry *memo_find(const struct memo *this,
+								   uint16_t type,
+								   uint32_t flags,
+								   size_t pos)
+{
+	size_t i, mask;
+	const struct memo_entry *entry;
+
+	mask = this->num_slots - 1;
+	i = memo_hash(type, flags, pos) & mask;
+	for (; this->slots[i].gen == this->gen; i = (i + 1) & mask) {
+		entry = &this->entries[this->slots[i].index];
+		if (entry->pos == pos && entry->type == type && entry->flags == flags)
+			return entry;
+	}
+	return NULL;
+}
+
+int memo_add(struct memo *this,
+			 const struct memo_entry *entry)
+{
+	int err;
+
+	if (memo_is_full(this)) {
+		parse_node_delete(entry->node);
+		return ERR_SUCCESS;
+	}
+
+	err = memo_reserve(this);
+	if (err) {
+		parse_node_delete(entry->node);
+		return err;
+	}
+	this->entries[this->num_entries] = *entry;
+	memo_link(this, this->num_entries++);
+	return ERR_SUCCESS;
+}
+
+void memo_cut(struct memo *this,
+			  size_t pos)
+{
+	memo_filter(this, pos, SIZE_MAX);
+}
+
+void memo_rescan(struct memo *this,
+				 size_t pos)
+{
+	memo_filter(this, 0, pos);
+}
@@ -0,0 +1,355 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+#include <pub/number.h>
+#include <pub/number_tables.h>
+#include <pub/arena.h>
+#include <pub/error.h>
+#include <pub/unicode.h>
+
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+/* binary64 */
+#define MANTISSA_BITS		52
+#define EXPONENT_BIAS		1023
+#define INFINITE_POWER		0x7ff
+#define MANTISSA_MASK		((1ull << MANTISSA_BITS) - 1)
+
+/* The # of decimal digits that always fit in a uint64_t. */
+#define MAX_W_DIGITS		19
+
+__extension__ typedef unsigned __int128 uint128_t;
+
+static const
+double g_pow10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+static const
+uint64_t g_pow10_u64[] = {
+	1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull,
+	10000000ull, 100000000ull, 1000000000ull, 10000000000ull,
+	100000000000ull, 1000000000000ull, 10000000000000ull,
+	100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+	100000000000000000ull, 1000000000000000000ull,
+	10000000000000000000ull,
+};
+/*******************************************************************/
+static inline
+double number_from_bits(uint64_t bits)
+{
+	double value;
+
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+static inline
+double number_infinity(void)
+{
+	return number_from_bits((uint64_t)INFINITE_POWER << MANTISSA_BITS);
+}
+
+/*
+ * top * 2^exp, where top has its bit 63 set. sticky is set if any non-zero
+ * bits were dropped below top. The value is an integer; i.e. never
+ * subnormal.
+ */
+static
+double number_from_top_bits(uint64_t top,
+							int64_t exp,
+							bool sticky)
+{
+	uint64_t mantissa, rest, half;
+	int64_t power2;
+
+	mantissa = top >> (63 - MANTISSA_BITS);
+	rest = top & ((1ull << (63 - MANTISSA_BITS)) - 1);
+	half = 1ull << (62 - MANTISSA_BITS);
+	if (rest > half || (rest == half && (sticky || (mantissa & 1))))
+		++mantissa;
+
+	power2 = exp + 63 + EXPONENT_BIAS;
+	if (mantissa >> (MANTISSA_BITS + 1)) {
+		mantissa >>= 1;
+		++power2;
+	}
+	if (power2 >= INFINITE_POWER)
+		return number_infinity();
+	return number_from_bits((uint64_t)power2 << MANTISSA_BITS |
+							(mantissa & MANTISSA_MASK));
+}
+/*******************************************************************/
+/*
+ * Eisel-Lemire. w is non-zero, and q is within the table. w is normalized,
+ * and multiplied with the truncated 128-bit 5^q. The 2nd half of 5^q is
+ * needed only if the bits below those kept in the 1st product are all 1s,
+ * and a carry can reach the kept bits. The 2 products always suffice (see
+ * Mushtak and Lemire, "Fast Number Parsing Without Fallback").
+ */
+static
+double number_eisel_lemire(uint64_t w,
+						   int q)
+{
+	int lz, upper_bit, shift;
+	int64_t power2;
+	uint64_t hi, lo, mantissa, precision_mask;
+	uint128_t product;
+	const uint64_t *pow5;
+
+	lz = __builtin_clzll(w);
+	w <<= lz;
+
+	pow5 = g_pow5_128[q - POW5_SMALLEST];
+	product = (uint128_t)w * pow5[0];
+	hi = product >> 64;
+	lo = product;
+
+	/* Keep 1 + 52 + 1 (round) bits, + 1 for the upper bit that may be 0. */
+	precision_mask = UINT64_MAX >> (MANTISSA_BITS + 3);
+	if ((hi & precision_mask) == precision_mask) {
+		product = (uint128_t)w * pow5[1];
+		lo += (uint64_t)(product >> 64);
+		if (lo < (uint64_t)(product >> 64))
+			++hi;
+	}
+
+	upper_bit = hi >> 63;
+	shift = upper_bit + 64 - MANTISSA_BITS - 3;
+	mantissa = hi >> shift;
+
+	/* floor(log2(10^q)) + 63, for |q| < 350. */
+	power2 = (((152170 + 65536) * q) >> 16) + 63;
+	power2 += upper_bit - lz + EXPONENT_BIAS;
+
+	/* Subnormal */
+	if (power2 <= 0) {
+		if (-power2 + 1 >= 64)
+			return 0;
+		mantissa >>= -power2 + 1;
+		mantissa += mantissa & 1;
+		mantissa >>= 1;
+		/* Rounding up may produce the smallest normal. */
+		power2 = mantissa < (1ull << MANTISSA_BITS) ? 0 : 1;
+		return number_from_bits((uint64_t)power2 << MANTISSA_BITS | mantissa);
+	}
+
+	/*
+	 * A tie; the product is exact, and halfway between two doubles. Only
+	 * possible for small |q|. Round to even, instead of up.
+	 */
+	if (lo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 &&
+		(mantissa << shift) == hi)
+		mantissa &= ~1ull;
+
+	mantissa += mantissa & 1;
+	mantissa >>= 1;
+	if (mantissa >= (2ull << MANTISSA_BITS)) {
+		mantissa = 1ull << MANTISSA_BITS;
+		++power2;
+	}
+	mantissa &= MANTISSA_MASK;
+	if (power2 >= INFINITE_POWER)
+		return number_infinity();
+	return number_from_bits((uint64_t)power2 << MANTISSA_BITS | mantissa);
+}
+
+double number_from_decimal(uint64_t w,
+						   int64_t q)
+{
+	if (w == 0 || q < POW5_SMALLEST)
+		return 0;
+	if (q > POW5_LARGEST)
+		return number_infinity();
+
+#if FLT_EVAL_METHOD == 0
+	/* Clinger; w and 10^|q| are exact, and so is the one rounding. */
+	if (q >= -22 && q <= 22 && w <= 1ull << 53) {
+		if (q < 0)
+			return (double)w / g_pow10[-q];
+		return (double)w * g_pow10[q];
+	}
+#endif
+	return number_eisel_lemire(w, q);
+}
+
+/*
+ * The slow path; defers to strtod, which is correctly rounded. The text has no
+ * decimal point, and so does not depend on the locale.
+ */
+int number_from_decimal_digits(const char *digits,
+							   size_t num_digits,
+							   int64_t q,
+							   double *out)
+{
+	size_t size;
+	char *text;
+
+	size = num_digits + 32;
+	text = malloc(size);
+	if (text == NULL)
+		return ERR_NO_MEMORY;
+	memcpy(text, digits, num_digits);
+	snprintf(&text[num_digits], size - num_digits, "e%lld", (long long)q);
+	*out = strtod(text, NULL);
+	free(text);
+	return ERR_SUCCESS;
+}
+
+/* Only the top 64 significant bits are kept; the rest go into sticky. */
+double number_from_digits(const char *digits,
+						  size_t num_digits,
+						  unsigned radix)
+{
+	int b, bits_per_digit;
+	size_t i, num_bits;
+	int64_t exp;
+	uint64_t top, bit;
+	bool sticky;
+
+	bits_per_digit = __builtin_ctz(radix);
+	top = num_bits = exp = 0;
+	sticky = false;
+	for (i = 0; i < num_digits; ++i) {
+		for (b = bits_per_digit - 1; b >= 0; --b) {
+			bit = (hex_digit_value(digits[i]) >> b) & 1;
+			if (num_bits == 0 && bit == 0)
+				continue;
+			if (num_bits < 64) {
+				top = top << 1 | bit;
+				++num_bits;
+			} else {
+				++exp;
+				sticky |= bit;
+			}
+		}
+	}
+
+	if (num_bits == 0)
+		return 0;
+	exp -= 64 - num_bits;
+	top <<= 64 - num_bits;
+	return number_from_top_bits(top, exp, sticky);
+}
+/*******************************************************************/
+/* limbs *= mul; limbs += add. */
+static
+void big_int_mul_add(struct big_int *this,
+					 uint64_t mul,
+					 uint64_t add)
+{
+	uint32_t i;
+	uint64_t carry;
+	uint128_t product;
+
+	carry = add;
+	for (i = 0; i < this->num_limbs; ++i) {
+		product = (uint128_t)this->limbs[i] * mul + carry;
+		this->limbs[i] = product;
+		carry = product >> 64;
+	}
+	if (carry)
+		this->limbs[this->num_limbs++] = carry;
+}
+
+/* In chunks of up to 19 digits; i.e. one mul-add over the limbs per chunk. */
+static
+void big_int_from_decimal(struct big_int *this,
+						  const char *digits,
+						  size_t num_digits)
+{
+	size_t i, n;
+	uint64_t chunk;
+
+	for (; num_digits; digits += n, num_digits -= n) {
+		n = num_digits < MAX_W_DIGITS ? num_digits : MAX_W_DIGITS;
+		chunk = 0;
+		for (i = 0; i < n; ++i)
+			chunk = chunk * 10 + (digits[i] - '0');
+		big_int_mul_add(this, g_pow10_u64[n], chunk);
+	}
+}
+
+/* From the least significant digit up; a digit may straddle two limbs. */
+static
+void big_int_from_pow2(struct big_int *this,
+					   const char *digits,
+					   size_t num_digits,
+					   size_t max_limbs,
+					   unsigned radix)
+{
+	size_t i, pos, bits_per_digit;
+	uint64_t value;
+
+	bits_per_digit = __builtin_ctz(radix);
+	pos = 0;
+	for (i = num_digits; i-- > 0; pos += bits_per_digit) {
+		value = hex_digit_value(digits[i]);
+		this->limbs[pos / 64] |= value << (pos % 64);
+		if (pos % 64 + bits_per_digit > 64)
+			this->limbs[pos / 64 + 1] |= value >> (64 - pos % 64);
+	}
+
+	this->num_limbs = max_limbs;
+	while (this->num_limbs && this->limbs[this->num_limbs - 1] == 0)
+		--this->num_limbs;
+}
+
+/* A digit is at most 4 bits; that bounds the # of limbs. */
+int big_int_new(struct arena *arena,
+				const char *digits,
+				size_t num_digits,
+				unsigned radix,
+				struct big_int **out)
+{
+	size_t max_limbs;
+	struct big_int *big_int;
+
+	if (radix != 2 && radix != 8 && radix != 10 && radix != 16)
+		return ERR_INVALID_PARAMETER;
+
+	max_limbs = (num_digits * 4 + 63) / 64;
+	if (max_limbs > UINT32_MAX)
+		return ERR_UNSUPPORTED;
+
+	big_int = arena_alloc(arena, sizeof(*big_int) + max_limbs * sizeof(uint64_t),
+						  _Alignof(struct big_int));
+	if (big_int == NULL)
+		return ERR_NO_MEMORY;
+	memset(big_int->limbs, 0, max_limbs * sizeof(uint64_t));
+
+	big_int->num_limbs = 0;
+	if (radix == 10)
+		big_int_from_decimal(big_int, digits, num_digits);
+	else
+		big_int_from_pow2(big_int, digits, num_digits, max_limbs, radix);
+	*out = big_int;
+	return ERR_SUCCESS;
+}
+
+double big_int_to_double(const struct big_int *this)
+{
+	int lz;
+	uint32_t i, n;
+	uint64_t top, next;
+	bool sticky;
+
+	n = this->num_limbs;
+	if (n == 0)
+		return 0;
+
+	lz = __builtin_clzll(this->limbs[n - 1]);
+	top = this->limbs[n - 1] << lz;
+	next = n > 1 ? this->limbs[n - 2] : 0;
+	if (lz)
+		top |= next >> (64 - lz);
+	sticky = lz ? (next << lz) != 0 : next != 0;
+	for (i = 0; i + 2 < n && !sticky; ++i)
+		sticky = this->limbs[i] != 0;
+	return number_from_top_bits(top, (int64_t)(n - 1) * 64 - lz, sticky);
+}
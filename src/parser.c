@@ -2,12 +2,14 @@
 /* Copyright (c) 2023 Amol Surati */
 
 #include <prv/parser.h>
+#include <prv/first_sets.h>
 
 #include <pub/system.h>
 
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 static const
 enum token_type g_assign_expr_ops[] = {
@@ -28,6 +30,54 @@ enum token_type g_assign_expr_ops[] = {
 	TOKEN_BITWISE_OR_EQUALS,
 	TOKEN_COALESCE_EQUALS,
 };
+
+/*
+ * The binding powers of the binary operators, from ShortCircuitExpression
+ * down to ExponentiationExpression; the other tokens bind none.
+ */
+enum binary_prec {
+	PREC_NONE,
+	PREC_SHORT_CIRCUIT,	/* || ?? */
+	PREC_LOGICAL_AND,
+	PREC_BITWISE_OR,
+	PREC_BITWISE_XOR,
+	PREC_BITWISE_AND,
+	PREC_EQUALITY,
+	PREC_RELATIONAL,
+	PREC_SHIFT,
+	PREC_ADDITIVE,
+	PREC_MULTIPLICATIVE,
+	PREC_EXPONENTIATION,	/* Right-associative */
+};
+
+static const
+uint8_t g_binary_precs[SCRIPT] = {
+	[TOKEN_LOGICAL_OR]			= PREC_SHORT_CIRCUIT,
+	[TOKEN_COALESCE]			= PREC_SHORT_CIRCUIT,
+	[TOKEN_LOGICAL_AND]			= PREC_LOGICAL_AND,
+	[TOKEN_BITWISE_OR]			= PREC_BITWISE_OR,
+	[TOKEN_BITWISE_XOR]			= PREC_BITWISE_XOR,
+	[TOKEN_BITWISE_AND]			= PREC_BITWISE_AND,
+	[TOKEN_DOUBLE_EQUALS]		= PREC_EQUALITY,
+	[TOKEN_NOT_EQUALS]			= PREC_EQUALITY,
+	[TOKEN_TRIPLE_EQUALS]		= PREC_EQUALITY,
+	[TOKEN_NOT_DOUBLE_EQUALS]	= PREC_EQUALITY,
+	[TOKEN_LESS_THAN]			= PREC_RELATIONAL,
+	[TOKEN_GREATER_THAN]		= PREC_RELATIONAL,
+	[TOKEN_LESS_EQUALS]			= PREC_RELATIONAL,
+	[TOKEN_GREATER_EQUALS]		= PREC_RELATIONAL,
+	[TOKEN_INSTANCEOF]			= PREC_RELATIONAL,
+	[TOKEN_IN]					= PREC_RELATIONAL,	/* Only with GP_IN */
+	[TOKEN_SHL]					= PREC_SHIFT,
+	[TOKEN_SAR]					= PREC_SHIFT,
+	[TOKEN_SHR]					= PREC_SHIFT,
+	[TOKEN_PLUS]				= PREC_ADDITIVE,
+	[TOKEN_MINUS]				= PREC_ADDITIVE,
+	[TOKEN_MUL]					= PREC_MULTIPLICATIVE,
+	[TOKEN_DIV]					= PREC_MULTIPLICATIVE,
+	[TOKEN_MOD]					= PREC_MULTIPLICATIVE,
+	[TOKEN_EXP]					= PREC_EXPONENTIATION,
+};
 /*******************************************************************/
 int parse_node_new(enum token_type type,
 				   struct parse_node **out)
@@ -43,99 +93,1225 @@ int parse_node_new(enum token_type type,
 
 	list_init(&node->nodes);
 	node->type = type;
+	node->refs = 1;
 	*out = node;
 	err = ERR_SUCCESS;
 err0:
 	return err;
 }
 
-int parse_node_delete(struct parse_node *this)
+/*
+ * The descendants yet to be freed are queued on this node's own list, through
+ * their entries; a deep tree, e.g. of a long chain of binary operators, takes
+ * no stack. A descendant that is still referenced leaves the queue whole.
+ */
+int parse_node_delete(struct parse_node *this)
+{
+	struct list_entry *e, *c;
+	struct parse_node *node;
+
+	if (this == NULL || --this->refs)
+		return ERR_SUCCESS;
+
+	list_for_each_del(e, &this->nodes) {
+		node = list_entry(e, struct parse_node, entry);
+		if (--node->refs)
+			continue;
+		list_for_each_del(c, &node->nodes)
+			list_add_tail(&this->nodes, c);
+		free(node);
+	}
+	free(this);
+	return ERR_SUCCESS;
+}
+/*******************************************************************/
+/* Takes ownership of the scanner. */
+static
+int parser_new_with_scanner(struct scanner *scanner,
+							struct parser **out)
+{
+	struct parser *parser;
+
+	parser = calloc(1, sizeof(*parser));
+	if (parser == NULL) {
+		scanner_delete(scanner);
+		return ERR_NO_MEMORY;
+	}
+
+	parser->scanner = scanner;
+	*out = parser;
+	return ERR_SUCCESS;
+}
+
+int parser_new(const void *src,
+			   size_t src_len,
+			   size_t src_unit_size,
+			   struct parser **out)
+{
+	int err;
+	struct scanner *scanner;
+
+	err = scanner_new(src, src_len, src_unit_size, &scanner);
+	if (err)
+		return err;
+	return parser_new_with_scanner(scanner, out);
+}
+
+int parser_new_stream(int fd,
+					  struct parser **out)
+{
+	int err;
+	struct scanner *scanner;
+
+	err = scanner_new_stream(fd, &scanner);
+	if (err)
+		return err;
+	return parser_new_with_scanner(scanner, out);
+}
+
+int parser_start_pipeline(struct parser *this)
+{
+	if (this->pipeline || this->prescan)
+		return ERR_INVALID_PARAMETER;
+	if (this->scanner->stream)
+		return ERR_UNSUPPORTED;
+	return pipeline_new(this->scanner, &this->pipeline);
+}
+
+int parser_prescan(struct parser *this,
+				   size_t num_segments)
+{
+	if (this->pipeline || this->prescan || this->num_tokens)
+		return ERR_INVALID_PARAMETER;
+	if (this->scanner->stream)
+		return ERR_UNSUPPORTED;
+	return prescan_new(this->scanner, num_segments, &this->prescan);
+}
+
+int parser_memoize(struct parser *this)
+{
+	if (this->memo || this->num_tokens)
+		return ERR_INVALID_PARAMETER;
+	return memo_new(&this->memo);
+}
+
+/* The tokens are freed along with the scanner. */
+int parser_delete(struct parser *this)
+{
+	if (this->pipeline)
+		pipeline_delete(this->pipeline);
+	if (this->prescan)
+		prescan_delete(this->prescan);
+	if (this->memo)
+		memo_delete(this->memo);
+	free(this->tokens);
+	parse_node_delete(this->root);
+	scanner_delete(this->scanner);
+	free(this);
+	return ERR_SUCCESS;
+}
+/*******************************************************************/
+static
+int parser_queue_token(struct parser *this,
+					   const struct token *token)
+{
+	size_t len, size;
+	const struct token **tokens;
+
+	len = this->num_tokens - this->base;
+	if (len == this->size) {
+		size = this->size ? this->size << 1 : 64;
+		tokens = realloc(this->tokens, size * sizeof(*tokens));
+		if (tokens == NULL)
+			return ERR_NO_MEMORY;
+		this->tokens = tokens;
+		this->size = size;
+	}
+	this->tokens[len] = token;
+	++this->num_tokens;
+	return ERR_SUCCESS;
+}
+
+/*
+ * The parser never backtracks to before pos; release the tokens there. Only
+ * the lookahead past pos is moved, which is a token or two at a cut.
+ */
+static
+void parser_cut(struct parser *this,
+				size_t pos)
+{
+	assert(pos >= this->base && pos <= this->num_tokens);
+	memmove(this->tokens, &this->tokens[pos - this->base],
+			(this->num_tokens - pos) * sizeof(*this->tokens));
+	this->base = pos;
+	if (this->memo)
+		memo_cut(this->memo, pos);
+}
+
+/* The first failed scan ends the parse; the ones after are of backtracks. */
+static
+void parser_scan_failed(struct parser *this,
+						size_t pos)
+{
+	if (this->is_scan_failed)
+		return;
+	this->is_scan_failed = true;
+	this->scan_fail_pos = pos;
+}
+
+/*
+ * The tokens after it followed the other reading, and are dropped. The
+ * pipeline, or the prescan, resumes after the token, whether or not it could
+ * be rescanned.
+ */
+static
+int parser_rescan_token(struct parser *this,
+						size_t index,
+						enum scanner_goal goal)
+{
+	int err;
+	const struct token *token;
+
+	if (this->pipeline)
+		pipeline_pause(this->pipeline);
+
+	this->num_tokens = this->base + index;
+	if (this->memo)
+		memo_rescan(this->memo, this->num_tokens);
+	err = scanner_rescan_token(this->scanner, this->tokens[index], goal,
+							   &token);
+	if (!err)
+		err = parser_queue_token(this, token);
+	else
+		parser_scan_failed(this, this->tokens[index]->scan_pos);
+
+	if (this->pipeline)
+		pipeline_resume(this->pipeline, this->tokens,
+						this->num_tokens - this->base);
+	if (this->prescan)
+		prescan_resume(this->prescan, err ? NULL : token);
+	return err;
+}
+
+/*
+ * Queues the token at pos, if it isn't yet. Once the pipeline fails, its
+ * scanner thread is done, and the scanner can be read.
+ */
+static
+int parser_fetch_token(struct parser *this,
+					   enum scanner_goal goal,
+					   size_t pos)
+{
+	int err;
+	const struct token *token;
+
+	if (pos < this->base || pos > this->num_tokens)
+		return ERR_INVALID_PARAMETER;
+	if (pos < this->num_tokens)
+		return ERR_SUCCESS;
+
+	if (this->pipeline)
+		err = pipeline_get_next_token(this->pipeline, &token);
+	else if (this->prescan)
+		err = prescan_get_next_token(this->prescan, goal, &token);
+	else
+		err = scanner_get_next_token(this->scanner, goal, &token);
+	if (!err)
+		return parser_queue_token(this, token);
+
+	if (err != ERR_END_OF_FILE)
+		parser_scan_failed(this, this->prescan ?
+						   prescan_error_pos(this->prescan) :
+						   this->scanner->save_pos);
+	return err;
+}
+
+/*
+ * A token from the pipeline, or the prescan, was scanned under a guessed goal;
+ * it, like any queued token, is rescanned if it reads differently under the
+ * goal.
+ */
+static
+int parser_get_token(struct parser *this,
+					 enum scanner_goal goal,
+					 size_t *q_pos,
+					 const struct token **out)
+{
+	int err;
+	size_t pos, index;
+
+	pos = *q_pos;
+	err = parser_fetch_token(this, goal, pos);
+	if (err)
+		return err;
+
+	index = pos - this->base;
+	if (!token_fits_goal(this->tokens[index], goal)) {
+		err = parser_rescan_token(this, index, goal);
+		if (err)
+			return err;
+	}
+	*out = this->tokens[index];
+	*q_pos = pos + 1;
+	if (this->reach < pos + 1)
+		this->reach = pos + 1;
+	return ERR_SUCCESS;
+}
+
+/*
+ * The lazy reads of the scanner, such as of the parts of a regexp, share its
+ * tables with a pipeline's thread, which is paused for them. The thread then
+ * resumes after the last token queued; those it had scanned ahead are dropped.
+ */
+static
+void parser_pause_scanner(struct parser *this)
+{
+	if (this->pipeline)
+		pipeline_pause(this->pipeline);
+}
+
+static
+int parser_resume_scanner(struct parser *this)
+{
+	int err;
+	const struct token *last;
+
+	if (this->pipeline == NULL)
+		return ERR_SUCCESS;
+
+	last = this->tokens[this->num_tokens - 1 - this->base];
+	err = scanner_seek(this->scanner, last->scan_pos + last->raw_len,
+					   token_type(last));
+	pipeline_resume(this->pipeline, this->tokens,
+					this->num_tokens - this->base);
+	return err;
+}
+
+/* A regexp's body is the atom of its node. Fails if its flags are invalid. */
+static
+int parser_reg_exp(struct parser *this,
+				   const struct token *token,
+				   struct parse_node *node)
+{
+	int err, resume_err;
+	uint32_t body, flags;
+
+	parser_pause_scanner(this);
+	err = scanner_reg_exp(this->scanner, token, &body, &flags);
+	if (!err)
+		parse_node_set_atom(node, body);
+	resume_err = parser_resume_scanner(this);
+	return err ? err : resume_err;
+}
+
+/*
+ * The token at pos, as it is queued; a new one is read under the DIV goal. It
+ * is never rescanned, and may thus be of either type that a / or a } reads
+ * as.
+ */
+static
+int parser_peek_token(struct parser *this,
+					  size_t pos,
+					  const struct token **out)
+{
+	int err;
+
+	err = parser_fetch_token(this, SCANNER_GOAL_DIV, pos);
+	if (err)
+		return err;
+	*out = this->tokens[pos - this->base];
+	if (this->reach < pos + 1)
+		this->reach = pos + 1;
+	return ERR_SUCCESS;
+}
+
+/*
+ * A non-terminal that can't start with the token at pos is not parsed; it
+ * fails as it would have, but without a node, or a trip through its
+ * alternatives. The FIRST sets hold all the types that a token may have
+ * under any goal.
+ */
+static
+int parser_predict(struct parser *this,
+				   enum token_type type,
+				   size_t pos)
+{
+	int err;
+	const struct token *token;
+
+	if (type < SCRIPT || first_set_is_any(type))
+		return ERR_SUCCESS;
+
+	err = parser_peek_token(this, pos, &token);
+	if (err)
+		return err;
+	return first_set_has(type, token_type(token)) ? ERR_SUCCESS :
+		ERR_NO_MATCH;
+}
+
+/*
+ * Matches the terminal at *q_pos, and steps over it, without a node; the
+ * terminals that are only consumed need none. A key word must be written
+ * without escapes. TOKEN_NEW_LINE matches a line terminator before the token,
+ * which remains in the queue. On error, *q_pos does not move.
+ */
+static
+int parser_match(struct parser *this,
+				 enum token_type type,
+				 size_t *q_pos)
+{
+	int err;
+	size_t pos;
+	const struct token *token;
+
+	pos = *q_pos;
+	err = parser_get_token(this, SCANNER_GOAL_DIV, &pos, &token);
+	if (err)
+		return err;
+
+	if (type == TOKEN_NEW_LINE)
+		return token_has_new_line_pfx(token) ? ERR_SUCCESS : ERR_NO_MATCH;
+	if (token_type(token) != type)
+		return ERR_NO_MATCH;
+	if (token_type_is_reserved_word(type) && !token_is_reserved_literal(token))
+		return ERR_NO_MATCH;
+	*q_pos = pos;
+	return ERR_SUCCESS;
+}
+/*******************************************************************/
+/*
+ * The non-terminals that start several alternatives; without a memo, each
+ * alternative that backtracks over one parses it again.
+ */
+static
+bool parser_is_memoized(enum token_type type)
+{
+	switch (type) {
+	case ASSIGNMENT_EXPRESSION:
+	case CONDITIONAL_EXPRESSION:
+	case LHS_EXPRESSION:
+	case MEMBER_EXPRESSION:
+	case PRIMARY_EXPRESSION:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/*
+ * The memo hands out a recorded subtree only while the parse holds none of it,
+ * i.e. after the alternative that made it failed. A subtree still in use, or
+ * changed since, is parsed again instead.
+ */
+static
+bool parser_can_recall(const struct memo_entry *entry)
+{
+	return entry->node == NULL ||
+		(entry->node->refs == 1 && !entry->node->is_stale);
+}
+
+static
+int parser_recall(struct parser *this,
+				  const struct memo_entry *entry,
+				  size_t *q_pos,
+				  struct parse_node **out)
+{
+	if (this->reach < entry->reach)
+		this->reach = entry->reach;
+	if (entry->err)
+		return entry->err;
+
+	if (entry->node)
+		++entry->node->refs;
+	*out = entry->node;
+	*q_pos = entry->end_pos;
+	return ERR_SUCCESS;
+}
+
+/*
+ * Only a match, or a mismatch, is recorded; any other error ends the parse.
+ * The memo takes a reference to the subtree, which it shares with the parse.
+ */
+static
+void parser_record(struct parser *this,
+				   struct memo_entry *entry,
+				   struct parse_node *node)
+{
+	if (entry->err != ERR_SUCCESS && entry->err != ERR_NO_MATCH)
+		return;
+
+	entry->node = node;
+	if (node)
+		++node->refs;
+	memo_add(this->memo, entry);
+}
+/*******************************************************************/
+static
+int parser_parse(struct parser *this,
+				 enum token_type type,
+				 size_t flags,
+				 size_t *q_pos,
+				 struct parse_node **out);
+
+/* A key word is an operator only if it is written without escapes. */
+static
+enum binary_prec parser_binary_prec(const struct token *token,
+									size_t flags)
+{
+	enum token_type type;
+
+	type = token_type(token);
+	if (token_is_reserved_word(token) && !token_is_reserved_literal(token))
+		return PREC_NONE;
+	if (type == TOKEN_IN && !bits_get(flags, GP_IN))
+		return PREC_NONE;
+	return g_binary_precs[type];
+}
+
+/* The node that a prefix operator starts; TOKEN_INVALID if none. */
+static
+enum token_type parser_prefix_type(const struct token *token,
+								   size_t flags)
+{
+	if (token_is_reserved_word(token) && !token_is_reserved_literal(token))
+		return TOKEN_INVALID;
+
+	switch (token_type(token)) {
+	case TOKEN_INC:
+	case TOKEN_DEC:
+		return UPDATE_EXPRESSION;
+	case TOKEN_AWAIT:
+		return bits_get(flags, GP_AWAIT) ? UNARY_EXPRESSION : TOKEN_INVALID;
+	case TOKEN_DELETE:
+	case TOKEN_VOID:
+	case TOKEN_TYPEOF:
+	case TOKEN_PLUS:
+	case TOKEN_MINUS:
+	case TOKEN_BITWISE_NOT:
+	case TOKEN_LOGICAL_NOT:
+		return UNARY_EXPRESSION;
+	default:
+		return TOKEN_INVALID;
+	}
+}
+
+/* node(type) -> op -> operand; the operand is added later. */
+static
+int parser_new_op_node(enum token_type type,
+					   const struct token *token,
+					   struct parse_node **out)
+{
+	int err;
+	struct parse_node *node, *op;
+
+	err = parse_node_new(type, &node);
+	if (err)
+		return err;
+
+	err = parse_node_new(token_type(token), &op);
+	if (err) {
+		parse_node_delete(node);
+		*out = NULL;
+		return err;
+	}
+	parse_node_add_child(node, op);
+	*out = node;
+	return ERR_SUCCESS;
+}
+
+/*
+ * UnaryExpression. The prefix operators are read in a loop, each node a
+ * child of the one before it; the LHS_EXPRESSION, with its postfix ++ or --
+ * if any, is the child of the last.
+ */
+static
+int parser_parse_unary(struct parser *this,
+					   size_t flags,
+					   size_t *q_pos,
+					   struct parse_node **out)
+{
+	int err;
+	size_t pos;
+	enum token_type type;
+	const struct token *token;
+	struct parse_node *root, *tail, *node, *child;
+
+	*out = root = tail = NULL;
+	while (true) {
+		pos = *q_pos;
+		err = parser_get_token(this, SCANNER_GOAL_DIV, &pos, &token);
+		if (err)
+			goto err0;
+
+		type = parser_prefix_type(token, flags);
+		if (type == TOKEN_INVALID)
+			break;
+
+		err = parser_new_op_node(type, token, &node);
+		if (err)
+			goto err0;
+		if (tail)
+			parse_node_add_child(tail, node);
+		else
+			root = node;
+		tail = node;
+		*q_pos = pos;
+	}
+
+	err = parser_parse(this, LHS_EXPRESSION, flags, q_pos, &child);
+	if (err)
+		goto err0;
+
+	/* A postfix ++ or -- must be on the line of its operand. */
+	pos = *q_pos;
+	err = parser_get_token(this, SCANNER_GOAL_DIV, &pos, &token);
+	if (!err && !token_has_new_line_pfx(token) &&
+		(token_type(token) == TOKEN_INC || token_type(token) == TOKEN_DEC)) {
+		err = parse_node_new(UPDATE_EXPRESSION, &node);
+		if (err)
+			goto err1;
+		parse_node_add_child(node, child);
+		child = node;
+
+		err = parse_node_new(token_type(token), &node);
+		if (err)
+			goto err1;
+		parse_node_add_child(child, node);
+		*q_pos = pos;
+	} else if (err && err != ERR_END_OF_FILE) {
+		goto err1;
+	}
+
+	if (tail)
+		parse_node_add_child(tail, child);
+	else
+		root = child;
+	*out = root;
+	return ERR_SUCCESS;
+err1:
+	parse_node_delete(child);
+err0:
+	parse_node_delete(root);
+	return err;
+}
+
+/*
+ * The binary operators, by precedence climbing: the loop folds the operators
+ * that bind at least min_prec into the left operand; the right operand of
+ * each is parsed with a higher min_prec, or the same for the right-associative
+ * **. A chain of the operators of a tier thus takes one frame, however long;
+ * the recursion is only as deep as the tiers.
+ *
+ * Each fold is a BINARY_EXPRESSION: left operand, operator, right operand.
+ * Where the grammar has no derivation, the loop stops before the operator,
+ * and leaves it to the caller:
+ *	?? mixed with || or && without parentheses,
+ *	** after a UnaryExpression, or after another operator, and
+ *	#x not followed by in; #x in y is a RelationalExpression.
+ */
+static
+int parser_parse_binary(struct parser *this,
+						enum binary_prec min_prec,
+						size_t flags,
+						size_t *q_pos,
+						struct parse_node **out)
+{
+	int err;
+	size_t pos;
+	bool is_private;
+	enum binary_prec prec, next_prec;
+	enum token_type op, last_op;
+	const struct token *token;
+	struct parse_node *lhs, *rhs, *node;
+
+	*out = lhs = NULL;
+	is_private = false;
+	if (min_prec <= PREC_RELATIONAL && bits_get(flags, GP_IN)) {
+		err = parser_parse(this, PRIVATE_IDENTIFIER, 0, q_pos, &lhs);
+		if (err && err != ERR_NO_MATCH)
+			return err;
+		is_private = err == ERR_SUCCESS;
+	}
+	if (!is_private) {
+		err = parser_parse_unary(this, flags, q_pos, &lhs);
+		if (err)
+			return err;
+	}
+
+	last_op = TOKEN_INVALID;
+	while (true) {
+		pos = *q_pos;
+		err = parser_get_token(this, SCANNER_GOAL_DIV, &pos, &token);
+		if (err == ERR_END_OF_FILE)
+			break;
+		if (err)
+			goto err0;
+
+		op = token_type(token);
+		prec = parser_binary_prec(token, flags);
+		if (prec == PREC_NONE || prec < min_prec)
+			break;
+		if (is_private && op != TOKEN_IN)
+			break;
+		if (op == TOKEN_COALESCE &&
+			(last_op == TOKEN_LOGICAL_OR || last_op == TOKEN_LOGICAL_AND))
+			break;
+		if ((op == TOKEN_LOGICAL_OR || op == TOKEN_LOGICAL_AND) &&
+			last_op == TOKEN_COALESCE)
+			break;
+		if (op == TOKEN_EXP && (last_op != TOKEN_INVALID ||
+								parse_node_type(lhs) == UNARY_EXPRESSION))
+			break;
+		*q_pos = pos;
+
+		/* The operands of ?? are BitwiseORExpressions. */
+		if (op == TOKEN_EXP)
+			next_prec = prec;
+		else if (op == TOKEN_COALESCE)
+			next_prec = PREC_BITWISE_OR;
+		else
+			next_prec = prec + 1;
+		err = parser_parse_binary(this, next_prec, flags, q_pos, &rhs);
+		if (err)
+			goto err0;
+
+		err = parser_new_op_node(BINARY_EXPRESSION, token, &node);
+		if (err) {
+			parse_node_delete(rhs);
+			goto err0;
+		}
+		list_add_head(&node->nodes, &lhs->entry);	/* Before the operator */
+		parse_node_add_child(node, rhs);
+		lhs = node;
+		last_op = op;
+		is_private = false;
+	}
+
+	err = ERR_NO_MATCH;
+	if (is_private)
+		goto err0;
+	*out = lhs;
+	return ERR_SUCCESS;
+err0:
+	parse_node_delete(lhs);
+	return err;
+}
+/*******************************************************************/
+/*
+ * The covers. An expression is parsed once; the token after it tells what it
+ * stands for, and it is then reinterpreted in place, without a reparse.
+ */
+static
+bool parser_is_assign_op(enum token_type type)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(g_assign_expr_ops); ++i) {
+		if (g_assign_expr_ops[i] == type)
+			return true;
+	}
+	return false;
+}
+
+/* The only child of the node, if it is of the type. */
+static
+struct parse_node *parse_node_only_child(struct parse_node *this,
+										 enum token_type type)
+{
+	struct parse_node *child;
+
+	if (!parse_node_has_children(this) ||
+		!list_is_only(&this->nodes, list_peek_head(&this->nodes)))
+		return NULL;
+	child = list_entry(list_peek_head(&this->nodes), struct parse_node, entry);
+	return parse_node_type(child) == type ? child : NULL;
+}
+
+/* The PrimaryExpression of the type, if the LHS_EXPRESSION is just that. */
+static
+struct parse_node *parser_bare_primary(struct parse_node *lhs,
+									   enum token_type type)
+{
+	struct parse_node *node;
+
+	node = parse_node_only_child(lhs, NEW_EXPRESSION);
+	if (node)
+		node = parse_node_only_child(node, MEMBER_EXPRESSION);
+	if (node)
+		node = parse_node_only_child(node, PRIMARY_EXPRESSION);
+	if (node)
+		node = parse_node_only_child(node, type);
+	return node;
+}
+
+/* The last of the node's children, e.g. of the tails of a MemberExpression. */
+static
+struct parse_node *parse_node_last_child(struct parse_node *this)
+{
+	return list_entry(list_peek_tail(&this->nodes), struct parse_node, entry);
+}
+
+/* Whether the tails end in a property access; a tagged template is not one. */
+static
+bool parser_is_property_post(struct parse_node *post)
+{
+	enum token_type type;
+
+	type = parse_node_type(parse_node_last_child(post));
+	return type == ARRAY_EXPRESSION || type == DOT_IDENTIFIER_NAME ||
+		type == DOT_PRIVATE_IDENTIFIER;
+}
+
+/*
+ * Whether the LHS_EXPRESSION is a simple assignment target: an
+ * IdentifierReference, or a property access, within any parentheses. A
+ * literal, this, a template, a new, a call or an OptionalChain is not.
+ */
+static
+bool parser_is_simple_target(struct parse_node *lhs)
+{
+	struct parse_node *node, *last;
+
+	while (true) {
+		node = parse_node_only_child(lhs, CALL_EXPRESSION);
+		if (node) {
+			last = parse_node_last_child(node);
+			return parse_node_type(last) == CALL_EXPRESSION_POST &&
+				parser_is_property_post(last);
+		}
+
+		node = parse_node_only_child(lhs, NEW_EXPRESSION);
+		if (node)
+			node = parse_node_only_child(node, MEMBER_EXPRESSION);
+		if (node == NULL)
+			return false;
+
+		last = parse_node_last_child(node);
+		if (parse_node_type(last) == MEMBER_EXPRESSION_POST)
+			return parser_is_property_post(last);
+		if (parse_node_type(last) == SUPER_PROPERTY)
+			return true;
+		if (parser_bare_primary(lhs, IDENTIFIER_REFERENCE))
+			return true;
+
+		node = parser_bare_primary(lhs, PARENTHESIZED_EXPRESSION);
+		if (node)
+			node = parse_node_only_child(node, EXPRESSION);
+		if (node)
+			node = parse_node_only_child(node, ASSIGNMENT_EXPRESSION);
+		if (node)
+			node = parse_node_only_child(node, CONDITIONAL_EXPRESSION);
+		if (node)
+			lhs = parse_node_only_child(node, LHS_EXPRESSION);
+		if (node == NULL || lhs == NULL)
+			return false;
+	}
+}
+
+/*
+ * The IdentifierReference that an item of the cover names, if the item is
+ * one, or one = an AssignmentExpression; i.e. a SingleNameBinding.
+ */
+static
+struct parse_node *parser_cover_param(struct parse_node *item)
+{
+	struct parse_node *lhs, *op;
+
+	lhs = list_entry(list_peek_head(&item->nodes), struct parse_node, entry);
+	if (parse_node_type(lhs) == CONDITIONAL_EXPRESSION) {
+		lhs = parse_node_only_child(lhs, LHS_EXPRESSION);
+	} else if (parse_node_type(lhs) == LHS_EXPRESSION) {
+		op = list_entry(lhs->entry.next, struct parse_node, entry);
+		if (parse_node_type(op) != TOKEN_EQUALS)
+			lhs = NULL;
+	} else {
+		lhs = NULL;
+	}
+	return lhs ? parser_bare_primary(lhs, IDENTIFIER_REFERENCE) : NULL;
+}
+
+/*
+ * Whether the ConditionalExpression, before =>, covers ArrowParameters: an
+ * IdentifierReference, or a parenthesized list of SingleNameBindings, with a
+ * rest element at the end, if any.
+ */
+static
+bool parser_is_arrow_cover(struct parse_node *cond)
 {
-	struct list_entry *e;
-	struct parse_node *node;
+	struct list_entry *e, *i;
+	struct parse_node *lhs, *cover, *expr;
+
+	lhs = parse_node_only_child(cond, LHS_EXPRESSION);
+	if (lhs == NULL)
+		return false;
+	if (parser_bare_primary(lhs, IDENTIFIER_REFERENCE))
+		return true;
+
+	cover = parser_bare_primary(lhs, PARENTHESIZED_EXPRESSION);
+	if (cover == NULL)
+		return false;
+	list_for_each(e, &cover->nodes) {
+		expr = list_entry(e, struct parse_node, entry);
+		if (parse_node_type(expr) == BINDING_REST_ELEMENT)
+			continue;
+		list_for_each(i, &expr->nodes) {
+			if (!parser_cover_param(list_entry(i, struct parse_node, entry)))
+				return false;
+		}
+	}
+	return true;
+}
 
-	if (this == NULL)
-		return ERR_SUCCESS;
+/*
+ * The node, and its chain of only children, are about to be changed in place;
+ * the memo must not hand them out again.
+ */
+static
+void parser_unshare_chain(struct parse_node *node)
+{
+	while (node) {
+		parse_node_set_stale(node);
+		if (!parse_node_has_children(node) ||
+			!list_is_only(&node->nodes, list_peek_head(&node->nodes)))
+			break;
+		node = list_entry(list_peek_head(&node->nodes), struct parse_node,
+						  entry);
+	}
+}
 
-	list_for_each_del(e, &this->nodes) {
-		node = list_entry(e, struct parse_node, entry);
-		parse_node_delete(node);
+/*
+ * An item, checked by parser_cover_param, as a BINDING_ELEMENT: the
+ * IdentifierReference is the BindingIdentifier, and the = the Initializer.
+ */
+static
+void parser_to_binding_element(struct parse_node *item)
+{
+	struct parse_node *name, *lhs, *op, *rhs;
+
+	parse_node_set_stale(item);
+	parser_unshare_chain(list_entry(list_peek_head(&item->nodes),
+									struct parse_node, entry));
+	name = parser_cover_param(item);
+	list_del_entry(&name->entry);
+	parse_node_set_type(name, BINDING_IDENTIFIER);
+
+	lhs = list_entry(list_del_head(&item->nodes), struct parse_node, entry);
+	parse_node_delete(lhs);
+	if (parse_node_has_children(item)) {
+		op = list_entry(list_peek_head(&item->nodes), struct parse_node,
+						entry);
+		rhs = list_entry(list_del_tail(&item->nodes), struct parse_node,
+						 entry);
+		parse_node_set_type(op, INITIALIZER);
+		parse_node_add_child(op, rhs);
 	}
-	free((void *)this->cooked);
-	return ERR_SUCCESS;
+	list_add_head(&item->nodes, &name->entry);
+	parse_node_set_type(item, BINDING_ELEMENT);
 }
-/*******************************************************************/
-int parser_new(const char16_t *src,
-			   size_t src_len,
-			   struct parser **out)
+
+/*
+ * The cover, checked by parser_is_arrow_cover, as FORMAL_PARAMETERS. It is
+ * taken over, even on error.
+ */
+static
+int parser_to_formal_params(struct parse_node *cond,
+							struct parse_node **out)
 {
 	int err;
-	struct parser *parser;
-	struct scanner *scanner;
+	struct list_entry *e, *i;
+	struct parse_node *params, *name, *lhs, *cover, *expr, *item;
 
-	err = scanner_new(src, src_len, &scanner);
+	err = parse_node_new(FORMAL_PARAMETERS, &params);
 	if (err)
 		goto err0;
 
-	err = ERR_NO_MEMORY;
-	parser = calloc(1, sizeof(*parser));
-	if (parser == NULL)
-		goto err1;
+	parser_unshare_chain(cond);
+	lhs = parse_node_only_child(cond, LHS_EXPRESSION);
+	cover = parser_bare_primary(lhs, PARENTHESIZED_EXPRESSION);
+	if (cover == NULL) {
+		err = parse_node_new(BINDING_ELEMENT, &item);
+		if (err)
+			goto err1;
+		name = parser_bare_primary(lhs, IDENTIFIER_REFERENCE);
+		list_del_entry(&name->entry);
+		parse_node_set_type(name, BINDING_IDENTIFIER);
+		parse_node_add_child(item, name);
+		parse_node_add_child(params, item);
+		goto done;
+	}
 
-	parser->scanner = scanner;
-	*out = parser;
+	list_for_each_del(e, &cover->nodes) {
+		expr = list_entry(e, struct parse_node, entry);
+		if (parse_node_type(expr) == BINDING_REST_ELEMENT) {
+			parse_node_add_child(params, expr);
+			continue;
+		}
+		parse_node_set_stale(expr);
+		list_for_each_del(i, &expr->nodes) {
+			item = list_entry(i, struct parse_node, entry);
+			parser_to_binding_element(item);
+			parse_node_add_child(params, item);
+		}
+		parse_node_delete(expr);
+	}
+done:
+	parse_node_delete(cond);
+	*out = params;
 	return ERR_SUCCESS;
 err1:
-	scanner_delete(scanner);
+	parse_node_delete(params);
 err0:
+	parse_node_delete(cond);
+	*out = NULL;
 	return err;
 }
 
-int parser_delete(struct parser *this)
+/*
+ * ArrowFunction, after the =>: FORMAL_PARAMETERS, then the ConciseBody,
+ * either the BLOCK of the FunctionBody or an AssignmentExpression. The cover
+ * is taken over, even on error.
+ */
+static
+int parser_parse_arrow(struct parser *this,
+					   struct parse_node *cover,
+					   size_t flags,
+					   size_t *q_pos,
+					   struct parse_node **out)
 {
-	size_t i;
+	int err;
+	size_t pos;
+	enum token_type type;
+	const struct token *token;
+	struct parse_node *node, *child;
 
-	for (i = 0; i < this->num_tokens; ++i)
-		token_delete((struct token *)this->tokens[i]);
-	free(this->tokens);
-	parse_node_delete(this->root);
-	scanner_delete(this->scanner);
-	free(this);
+	*out = NULL;
+	err = parse_node_new(ARROW_FUNCTION, &node);
+	if (err) {
+		parse_node_delete(cover);
+		return err;
+	}
+
+	err = parser_to_formal_params(cover, &child);
+	if (err)
+		goto err0;
+	parse_node_add_child(node, child);
+
+	pos = *q_pos;
+	err = parser_get_token(this, SCANNER_GOAL_DIV, &pos, &token);
+	if (err)
+		goto err0;
+
+	type = ASSIGNMENT_EXPRESSION;
+	flags &= bits_off(GP_YIELD);
+	flags &= bits_off(GP_AWAIT);
+	if (token_type(token) == TOKEN_LEFT_BRACE) {
+		type = BLOCK;
+		flags |= bits_on(GP_RETURN);
+	}
+	err = parser_parse(this, type, flags, q_pos, &child);
+	if (err)
+		goto err0;
+	parse_node_add_child(node, child);
+	*out = node;
 	return ERR_SUCCESS;
+err0:
+	parse_node_delete(node);
+	return err;
 }
 /*******************************************************************/
+/*
+ * A node is created with its first child; an alternative that fails before
+ * one matches allocates none. The child is taken over, even on error.
+ */
 static
-int parser_get_token(struct parser *this,
+int parser_add_child(struct parse_node **node,
+					 enum token_type type,
+					 struct parse_node **child)
+{
+	int err;
+
+	if (*node == NULL) {
+		err = parse_node_new(type, node);
+		if (err) {
+			parse_node_delete(*child);
+			*child = NULL;
+			return err;
+		}
+	}
+	parse_node_add_child(*node, *child);
+	*child = NULL;
+	return ERR_SUCCESS;
+}
+
+/* The node, in place, as the only child of a new node of the type. */
+static
+int parser_wrap(enum token_type type,
+				struct parse_node **node)
+{
+	struct parse_node *child;
+
+	child = *node;
+	*node = NULL;
+	return parser_add_child(node, type, &child);
+}
+
+/*
+ * LeftHandSideExpression. Each of its forms starts with a MemberExpression,
+ * or with a super or import call, after any news. That start is parsed once,
+ * and the tokens after it tell the form:
+ *	Arguments	after a new, make it a MemberExpression, innermost first; a new
+ *				without them, and those before it, nest NewExpressions.
+ *	Arguments	after the start, make it a CallExpression, with its tails.
+ *	?.			after either, make it an OptionalExpression.
+ * Trying the forms in turn parsed the start once for each, and so a nested
+ * start, as in ((a)), a number of times exponential in the depth.
+ */
+static
+int parser_parse_lhs(struct parser *this,
+					 size_t flags,
 					 size_t *q_pos,
-					 const struct token **out)
+					 struct parse_node **out)
 {
 	int err;
-	size_t num_tokens, pos;
-	const struct token *token, **tokens;
+	size_t pos, dot_pos, num_news;
+	enum token_type type;
+	struct parse_node *head, *node, *child;
 
-	pos = *q_pos;
-	num_tokens = this->num_tokens;
-	tokens = this->tokens;
+	/* new.target is a MetaProperty. */
+	*out = child = NULL;
+	for (num_news = 0; ; ++num_news) {
+		pos = *q_pos;
+		if (parser_match(this, TOKEN_NEW, &pos))
+			break;
+		dot_pos = pos;
+		if (!parser_match(this, TOKEN_DOT, &dot_pos))
+			break;
+		*q_pos = pos;
+	}
 
-	if (pos > num_tokens)
-		return ERR_INVALID_PARAMETER;
+	err = ERR_NO_MATCH;
+	if (num_news == 0) {
+		type = SUPER_CALL;
+		err = parser_parse(this, type, flags, q_pos, &head);
+		if (err == ERR_NO_MATCH) {
+			type = IMPORT_CALL;
+			err = parser_parse(this, type, flags, q_pos, &head);
+		}
+	}
+	if (err == ERR_NO_MATCH) {
+		type = MEMBER_EXPRESSION;
+		err = parser_parse(this, type, flags, q_pos, &head);
+	}
+	if (err)
+		return err;
 
-	if (pos == num_tokens) {
-		err = scanner_get_next_token(this->scanner, &token);
+	/* new MemberExpression Arguments, with its tails */
+	for (; num_news; --num_news) {
+		err = parser_parse(this, ARGUMENTS, flags, q_pos, &child);
 		if (err)
-			return err;
-		tokens = realloc(tokens, (num_tokens + 1) * sizeof(*tokens));
-		if (tokens == NULL)
-			return ERR_NO_MEMORY;
-		tokens[num_tokens++] = token;
-		this->num_tokens = num_tokens;
-		this->tokens = tokens;
+			break;
+
+		err = parse_node_new(MEMBER_EXPRESSION, &node);
+		if (err)
+			goto err1;
+		parse_node_add_child(node, head);
+		head = node;
+
+		err = parse_node_new(TOKEN_NEW, &node);
+		if (err)
+			goto err1;
+		list_add_head(&head->nodes, &node->entry);
+		parse_node_add_child(head, child);
+
+		err = parser_parse(this, MEMBER_EXPRESSION_POST, flags, q_pos, &child);
+		if (!err)
+			parse_node_add_child(head, child);
+		else if (err != ERR_NO_MATCH && err != ERR_END_OF_FILE)
+			goto err0;
+		child = NULL;
 	}
-	*out = this->tokens[pos++];
-	*q_pos = pos;
+	if (err && err != ERR_NO_MATCH && err != ERR_END_OF_FILE)
+		goto err0;
+
+	/* new NewExpression */
+	if (num_news) {
+		err = parser_wrap(NEW_EXPRESSION, &head);
+		for (; !err && num_news; --num_news) {
+			err = parse_node_new(TOKEN_NEW, &node);
+			if (!err)
+				err = parser_wrap(NEW_EXPRESSION, &head);
+			if (err) {
+				parse_node_delete(node);
+				break;
+			}
+			list_add_head(&head->nodes, &node->entry);
+		}
+		if (err)
+			goto err0;
+		*out = head;
+		return ERR_SUCCESS;
+	}
+
+	/* CallExpression */
+	if (type == MEMBER_EXPRESSION) {
+		err = parser_parse(this, ARGUMENTS, flags, q_pos, &child);
+		if (!err) {
+			type = CALL_MEMBER_EXPRESSION;
+			err = parser_wrap(type, &head);
+			if (err)
+				goto err1;
+			parse_node_add_child(head, child);
+			child = NULL;
+		} else if (err != ERR_NO_MATCH && err != ERR_END_OF_FILE) {
+			goto err0;
+		}
+	}
+	if (type != MEMBER_EXPRESSION) {
+		err = parser_wrap(CALL_EXPRESSION, &head);
+		if (err)
+			goto err0;
+
+		err = parser_parse(this, CALL_EXPRESSION_POST, flags, q_pos, &child);
+		if (!err)
+			parse_node_add_child(head, child);
+		else if (err != ERR_NO_MATCH && err != ERR_END_OF_FILE)
+			goto err0;
+		child = NULL;
+	}
+
+	/* OptionalExpression */
+	node = NULL;
+	while (true) {
+		err = parser_parse(this, OPTIONAL_CHAIN, flags, q_pos, &child);
+		if (err)
+			break;
+		if (node == NULL) {
+			err = parser_wrap(OPTIONAL_EXPRESSION, &head);
+			if (err)
+				goto err1;
+			node = head;
+		}
+		parse_node_add_child(node, child);
+		child = NULL;
+	}
+	if (err != ERR_NO_MATCH && err != ERR_END_OF_FILE)
+		goto err0;
+
+	/* Else, a NewExpression, if not a CallExpression */
+	err = ERR_SUCCESS;
+	if (node == NULL && type == MEMBER_EXPRESSION)
+		err = parser_wrap(NEW_EXPRESSION, &head);
+	if (err)
+		goto err0;
+	*out = head;
 	return ERR_SUCCESS;
+err1:
+	parse_node_delete(child);
+err0:
+	parse_node_delete(head);
+	return err;
 }
-/*******************************************************************/
+
 /*
  * If it returns an error, *out is guaranteed to be NULL.
  * Explicit node deletion is needed when the success status is ignored.
@@ -150,35 +1326,40 @@ int parser_parse(struct parser *this,
 				 struct parse_node **out)
 {
 	int err;
-	bool is_ident, has_opt_chain;
-	size_t i, pos, cooked_len;
-	struct parse_node *node, *child;
+	bool is_ident, is_cover, is_cut_list, is_memoized;
+	size_t pos, outer_reach;
+	struct parse_node *node, *child, *cover;
 	const struct token *token;
-	const char16_t *cooked;
+	const struct memo_entry *found;
+	struct memo_entry entry;
 	const size_t in_pos = *q_pos;
 	const int in_flags = flags;
 	const enum token_type in_type = type;
 
 	*out = child = NULL;
 
-	err = parse_node_new(type, &node);
+	err = parser_predict(this, type, in_pos);
 	if (err)
 		return err;
 
+	outer_reach = 0;
+	is_memoized = this->memo && parser_is_memoized(type);
+	if (is_memoized) {
+		found = memo_find(this->memo, type, flags, in_pos);
+		if (found && parser_can_recall(found))
+			return parser_recall(this, found, q_pos, out);
+		is_memoized = found == NULL;	/* Else, parsed again, not recorded */
+	}
+	if (is_memoized) {
+		outer_reach = this->reach;
+		this->reach = in_pos;
+	}
+
+	node = NULL;
 	switch (type) {
 		/* Syntactical Grammar Terminals */
 		/*******************************************************************/
-	case TOKEN_NEW_LINE:
-		/* Find a line-terminator before a token. */
-		pos = *q_pos;
-		err = parser_get_token(this, q_pos, &token);
-		if (err)
-			break;
-		else if (token_has_new_line_pfx(token))
-			*q_pos = pos;	/* Restore since the token must remain in q */
-		else
-			err = ERR_NO_MATCH;
-		break;
+	case TOKEN_NEW_LINE:	/* Before a token; the token remains in q */
 	case TOKEN_VAR:
 	case TOKEN_SUPER:
 	case TOKEN_IMPORT:
@@ -187,12 +1368,9 @@ int parser_parse(struct parser *this,
 	case TOKEN_NULL:
 	case TOKEN_TRUE:
 	case TOKEN_FALSE:
+	case TOKEN_META:
+	case TOKEN_TARGET:
 		/* These are all reserved literals. */
-		err = parser_get_token(this, q_pos, &token);
-		if (!err &&
-			(token_type(token) != type || !token_is_reserved_literal(token)))
-			err = ERR_NO_MATCH;
-		break;
 	case TOKEN_NUMBER:
 	case TOKEN_STRING:
 		/* fall-through */
@@ -201,30 +1379,79 @@ int parser_parse(struct parser *this,
 	case TOKEN_LEFT_BRACKET:
 	case TOKEN_RIGHT_BRACKET:
 	case TOKEN_SEMI_COLON:
+	case TOKEN_LEFT_PAREN:
+	case TOKEN_RIGHT_PAREN:
 	case TOKEN_COMMA:
+	case TOKEN_ELLIPSIS:
 	case TOKEN_EQUALS:
+	case TOKEN_QUESTION:
+	case TOKEN_COLON:
+		/* Punctuations, etc. Always literals. */
+		err = parser_match(this, type, q_pos);
+		break;
+		/* Syntactical Grammar Non-Terminals */
+		/*******************************************************************/
+	case REGEXP_LITERAL:
 		/*
-		 * Punctuations, etc. Always literals.
-		 * If the token doesn't match, the q_pos is reset at the end, becoz
-		 * we throw ERR_NO_MATCH.
+		 * The flags are checked here; the body, which is the atom of the
+		 * node, when the regexp is compiled.
 		 */
-		err = parser_get_token(this, q_pos, &token);
-		if (!err && token_type(token) != type)
+		err = parser_get_token(this, SCANNER_GOAL_REG_EXP, q_pos, &token);
+		if (!err && token_type(token) != TOKEN_REG_EXP)
 			err = ERR_NO_MATCH;
+		if (!err)
+			err = parse_node_new(in_type, &node);
+		if (err)
+			break;
+
+		err = parser_reg_exp(this, token, node);
+		break;
+	case TEMPLATE_LITERAL:
+		/*
+		 * A NoSubstitutionTemplate, or a TemplateHead followed by the
+		 * Expressions, each closed by a TemplateMiddle or a TemplateTail.
+		 * The chunks are cooked when used; but, unless tagged, a chunk must
+		 * not have a NotEscapeSequence.
+		 */
+		err = parser_get_token(this, SCANNER_GOAL_DIV, q_pos, &token);
+		if (!err && token_type(token) != TOKEN_TEMPLATE &&
+			token_type(token) != TOKEN_TEMPLATE_HEAD)
+			err = ERR_NO_MATCH;
+
+		while (!err) {
+			if (!bits_get(in_flags, GP_TAGGED) && token_has_bad_esc(token)) {
+				err = ERR_SYNTAX;
+				break;
+			}
+			if (token_type(token) == TOKEN_TEMPLATE ||
+				token_type(token) == TOKEN_TEMPLATE_TAIL)
+				break;
+
+			type = EXPRESSION;
+			flags = (in_flags | bits_on(GP_IN)) & bits_off(GP_TAGGED);
+			err = parser_parse(this, type, flags, q_pos, &child);
+			if (err)
+				break;
+			err = parser_add_child(&node, in_type, &child);
+			if (err)
+				break;
+
+			err = parser_get_token(this, SCANNER_GOAL_TEMPLATE_TAIL, q_pos,
+								   &token);
+			if (!err && token_type(token) != TOKEN_TEMPLATE_MIDDLE &&
+				token_type(token) != TOKEN_TEMPLATE_TAIL)
+				err = ERR_NO_MATCH;
+		}
 		break;
-		/* Syntactical Grammar Non-Terminals */
-		/*******************************************************************/
 	case PRIVATE_IDENTIFIER:
-		type = TOKEN_NUMBER_SIGN;
-		err = parser_parse(this, type, 0, q_pos, &child);
+		err = parser_match(this, TOKEN_NUMBER_SIGN, q_pos);
 		if (err)
 			break;
-		parse_node_delete(child);	/* Consume # */
 		type = IDENTIFIER_NAME;
 		err = parser_parse(this, type, 0, q_pos, &child);
 		break;
 	case IDENTIFIER_NAME:
-		err = parser_get_token(this, q_pos, &token);
+		err = parser_get_token(this, SCANNER_GOAL_DIV, q_pos, &token);
 		if (err)
 			break;
 
@@ -234,13 +1461,12 @@ int parser_parse(struct parser *this,
 
 		/* If possible, use non-cooked */
 		if (token_is_reserved_word(token)) {
-			parse_node_delete(node);
 			err = parse_node_new(token_type(token), &node);
 		} else {
-			cooked = token_cooked(token, &cooked_len);
-			assert(cooked);
-			parse_node_set_cooked(node, cooked, cooked_len);
-			err = ERR_SUCCESS;
+			assert(token_atom(token) != ATOM_NONE);
+			err = parse_node_new(type, &node);
+			if (!err)
+				parse_node_set_atom(node, token_atom(token));
 		}
 		break;
 		/*******************************************************************/
@@ -250,6 +1476,7 @@ int parser_parse(struct parser *this,
 		break;
 	case SCRIPT_BODY:
 		type = STATEMENT_LIST;
+		this->is_cut_list = true;
 		flags &= bits_off(GP_YIELD),
 			flags &= bits_off(GP_AWAIT),
 			flags &= bits_off(GP_RETURN),
@@ -257,12 +1484,23 @@ int parser_parse(struct parser *this,
 		break;
 		/*******************************************************************/
 	case STATEMENT_LIST:	/* left-associative */
+		/*
+		 * The items of the script's list are never backtracked over; a
+		 * failure there fails the script. Cut the queue after each.
+		 */
+		is_cut_list = this->is_cut_list;
+		this->is_cut_list = false;
+
 		type = STATEMENT_LIST_ITEM;
 		while (true) {
 			err = parser_parse(this, type, flags, q_pos, &child);
 			if (err)
 				break;
-			parse_node_add_child(node, child);
+			err = parser_add_child(&node, in_type, &child);
+			if (err)
+				break;
+			if (is_cut_list)
+				parser_cut(this, *q_pos);
 		}
 		break;
 	case STATEMENT_LIST_ITEM:
@@ -275,25 +1513,74 @@ int parser_parse(struct parser *this,
 		}
 		break;
 		/*******************************************************************/
-	case ARRAY_EXPRESSION:
-		type = TOKEN_LEFT_BRACKET;
-		err = parser_parse(this, type, 0, q_pos, &child);
+	case ARRAY_EXPRESSION:	/* [ Expression[+In] ] */
+		err = parser_match(this, TOKEN_LEFT_BRACKET, q_pos);
 		if (err)
 			break;
-		parse_node_delete(child);
 
 		type = EXPRESSION;
-		err = parser_parse(this, type, 0, q_pos, &child);
+		flags = (in_flags | bits_on(GP_IN)) & bits_off(GP_TAGGED);
+		err = parser_parse(this, type, flags, q_pos, &child);
+		if (err)
+			break;
+		err = parser_add_child(&node, in_type, &child);
 		if (err)
 			break;
-		parse_node_add_child(node, child);
 
-		type = TOKEN_RIGHT_BRACKET;
-		err = parser_parse(this, type, 0, q_pos, &child);
+		err = parser_match(this, TOKEN_RIGHT_BRACKET, q_pos);
+		break;
+	case PARENTHESIZED_EXPRESSION:
+		/*
+		 * CoverParenthesizedExpressionAndArrowParameterList:
+		 *	( Expression )
+		 *	( Expression , )
+		 *	( )
+		 *	( ... Binding )
+		 *	( Expression , ... Binding )
+		 * Only the first is a ParenthesizedExpression; the others are the
+		 * arrow parameters alone, and must be followed by =>. The node keeps
+		 * the EXPRESSION and the BINDING_REST_ELEMENT, for the user of the
+		 * cover to reinterpret.
+		 */
+		err = parser_match(this, TOKEN_LEFT_PAREN, q_pos);
 		if (err)
 			break;
-		parse_node_delete(child);
-		child = NULL;
+
+		is_cover = true;
+		type = EXPRESSION;
+		flags |= bits_on(GP_IN);
+		err = parser_parse(this, type, flags, q_pos, &child);
+		if (!err)
+			err = parser_add_child(&node, in_type, &child);
+		if (!err) {
+			err = parser_match(this, TOKEN_COMMA, q_pos);
+			if (err == ERR_NO_MATCH)
+				is_cover = false;
+		}
+		if (err == ERR_NO_MATCH)
+			err = ERR_SUCCESS;
+
+		if (!err && is_cover) {
+			type = BINDING_REST_ELEMENT;
+			err = parser_parse(this, type, flags, q_pos, &child);
+			if (!err)
+				err = parser_add_child(&node, in_type, &child);
+			else if (err == ERR_NO_MATCH)
+				err = ERR_SUCCESS;
+		}
+		if (err)
+			break;
+
+		err = parser_match(this, TOKEN_RIGHT_PAREN, q_pos);
+		if (err || !is_cover)
+			break;
+
+		pos = *q_pos;
+		err = parser_get_token(this, SCANNER_GOAL_DIV, &pos, &token);
+		if (err == ERR_END_OF_FILE || (!err &&
+									   (token_type(token) != TOKEN_ARROW ||
+										token_has_new_line_pfx(token))))
+			err = ERR_NO_MATCH;
 		break;
 		/*******************************************************************/
 	case PRIMARY_EXPRESSION:
@@ -352,7 +1639,7 @@ int parser_parse(struct parser *this,
 			err = parser_parse(this, type, 0, q_pos, &child);
 		}
 		if (err == ERR_NO_MATCH) {
-			type = PARENTHESIZED_EXPRESSION;	/* restrictive grammar */
+			type = PARENTHESIZED_EXPRESSION;	/* Or the arrow parameters */
 			err = parser_parse(this, type, flags, q_pos, &child);
 		}
 		if (err == ERR_NO_MATCH) {
@@ -367,13 +1654,9 @@ int parser_parse(struct parser *this,
 		break;
 		/*******************************************************************/
 	case IMPORT_META:
-		type = TOKEN_IMPORT;
-		err = parser_parse(this, type, 0, q_pos, &child);
-		if (err)
-			break;
-
-		type = TOKEN_DOT;
-		err = parser_parse(this, type, 0, q_pos, &child);
+		err = parser_match(this, TOKEN_IMPORT, q_pos);
+		if (!err)
+			err = parser_match(this, TOKEN_DOT, q_pos);
 		if (err)
 			break;
 
@@ -381,13 +1664,9 @@ int parser_parse(struct parser *this,
 		err = parser_parse(this, type, 0, q_pos, &child);
 		break;
 	case NEW_TARGET:
-		type = TOKEN_NEW;
-		err = parser_parse(this, type, 0, q_pos, &child);
-		if (err)
-			break;
-
-		type = TOKEN_DOT;
-		err = parser_parse(this, type, 0, q_pos, &child);
+		err = parser_match(this, TOKEN_NEW, q_pos);
+		if (!err)
+			err = parser_match(this, TOKEN_DOT, q_pos);
 		if (err)
 			break;
 
@@ -403,11 +1682,9 @@ int parser_parse(struct parser *this,
 		}
 		break;
 	case SUPER_PROPERTY:
-		type = TOKEN_SUPER;
-		err = parser_parse(this, type, 0, q_pos, &child);
+		err = parser_match(this, TOKEN_SUPER, q_pos);
 		if (err)
 			break;
-		parse_node_delete(child);	/* Consume 'super' */
 
 		type = ARRAY_EXPRESSION;
 		flags |= bits_on(GP_IN);
@@ -417,6 +1694,22 @@ int parser_parse(struct parser *this,
 			err = parser_parse(this, type, 0, q_pos, &child);
 		}
 		break;
+	case DOT_IDENTIFIER_NAME:
+		err = parser_match(this, TOKEN_DOT, q_pos);
+		if (err)
+			break;
+
+		type = IDENTIFIER_NAME;
+		err = parser_parse(this, type, 0, q_pos, &child);
+		break;
+	case DOT_PRIVATE_IDENTIFIER:
+		err = parser_match(this, TOKEN_DOT, q_pos);
+		if (err)
+			break;
+
+		type = PRIVATE_IDENTIFIER;
+		err = parser_parse(this, type, 0, q_pos, &child);
+		break;
 	case MEMBER_EXPRESSION:	/* left-associative */
 		type = SUPER_PROPERTY;
 		err = parser_parse(this, type, flags, q_pos, &child);
@@ -424,142 +1717,90 @@ int parser_parse(struct parser *this,
 			type = META_PROPERTY;
 			err = parser_parse(this, type, 0, q_pos, &child);
 		}
-		if (err == ERR_NO_MATCH) {
-			type = TOKEN_NEW;
-			err = parser_parse(this, type, flags, q_pos, &child);
-		}
 		if (err == ERR_NO_MATCH) {
 			type = PRIMARY_EXPRESSION;
 			err = parser_parse(this, type, flags, q_pos, &child);
 		}
 
+		/* new MemberExpression Arguments is built by parser_parse_lhs. */
+		if (!err)
+			err = parser_add_child(&node, in_type, &child);
 		if (err)
 			break;
 
-		if (type == TOKEN_NEW) {
-			type = MEMBER_EXPRESSION;
-			err = parser_parse(this, type, flags, q_pos, &child);
-			if (err)
-				break;
-			type = ARGUMENTS;
-			err = parser_parse(this, type, flags, q_pos, &child);
-			if (err)
-				break;
-		}
-
 		/*
 		 * Now we must check in a loop for:
 		 *	Array Expr (i.e. [ Expr ])
 		 *	. IdentifierName
 		 *	. PrivateIdentifier
 		 *	TemplateLiteral
+		 * None may follow.
 		 */
 		type = MEMBER_EXPRESSION_POST;
 		err = parser_parse(this, type, flags, q_pos, &child);
+		if (err == ERR_NO_MATCH || err == ERR_END_OF_FILE)
+			err = ERR_SUCCESS;
 		break;
 		/*******************************************************************/
-	case NEW_EXPRESSION:	/* right-associative */
-		/* NewExpr has starting with 'new':
-		 * 	new NewExpr
-		 * 	new MemberExpr Arguments
-		 * Check the longest first (MemberExpr)
-		 */
-		type = MEMBER_EXPRESSION;
-		err = parser_parse(this, type, flags, q_pos, &child);
-		if (err == ERR_NO_MATCH) {
-			type = TOKEN_NEW;
-			err = parser_parse(this, type, flags, q_pos, &child);
-		}
-
+	case ARGUMENTS:
+		err = parser_match(this, TOKEN_LEFT_PAREN, q_pos);
 		if (err)
 			break;
 
-		parse_node_add_child(node, child);
-		if (type == MEMBER_EXPRESSION)
-			break;
+		/* A spread argument keeps its '...'; a trailing ',' is allowed. */
+		flags |= bits_on(GP_IN);
+		while (true) {
+			err = parser_match(this, TOKEN_RIGHT_PAREN, q_pos);
+			if (err != ERR_NO_MATCH)
+				break;
 
-		type = NEW_EXPRESSION;
-		err = parser_parse(this, type, flags, q_pos, &child);
-		break;
-		/*******************************************************************/
-	case CALL_MEMBER_EXPRESSION:
-		type = MEMBER_EXPRESSION;
-		err = parser_parse(this, type, flags, q_pos, &child);
-		if (err)
-			break;
-		parse_node_add_child(node, child);
+			type = TOKEN_ELLIPSIS;
+			err = parser_parse(this, type, 0, q_pos, &child);
+			if (!err)
+				err = parser_add_child(&node, in_type, &child);
+			if (err && err != ERR_NO_MATCH)
+				break;
 
-		type = ARGUMENTS;
-		err = parser_parse(this, type, flags, q_pos, &child);
+			type = ASSIGNMENT_EXPRESSION;
+			err = parser_parse(this, type, flags, q_pos, &child);
+			if (!err)
+				err = parser_add_child(&node, in_type, &child);
+			if (err)
+				break;
+
+			/* Without a ',', the list must end. */
+			err = parser_match(this, TOKEN_COMMA, q_pos);
+			if (err == ERR_NO_MATCH) {
+				err = parser_match(this, TOKEN_RIGHT_PAREN, q_pos);
+				break;
+			}
+			if (err)
+				break;
+		}
 		break;
 	case IMPORT_CALL:
-		type = TOKEN_IMPORT;
-		err = parser_parse(this, type, 0, q_pos, &child);
-		if (err)
-			break;
-		parse_node_delete(child);	/* Consume 'import' */
-
-		type = TOKEN_LEFT_PAREN;
-		err = parser_parse(this, type, 0, q_pos, &child);
+		err = parser_match(this, TOKEN_IMPORT, q_pos);
+		if (!err)
+			err = parser_match(this, TOKEN_LEFT_PAREN, q_pos);
 		if (err)
 			break;
-		parse_node_delete(child);	/* Consume ( */
 
 		type = ASSIGNMENT_EXPRESSION;
 		flags |= bits_on(GP_IN);
 		err = parser_parse(this, type, flags, q_pos, &child);
-		if (err)
-			break;
-
-		type = TOKEN_RIGHT_PAREN;
-		err = parser_parse(this, type, 0, q_pos, &child);
-		if (err)
-			break;
-		parse_node_delete(child);	/* Consume ) */
+		if (!err)
+			err = parser_add_child(&node, in_type, &child);
+		if (!err)
+			err = parser_match(this, TOKEN_RIGHT_PAREN, q_pos);
 		break;
 	case SUPER_CALL:
-		type = TOKEN_SUPER;
-		err = parser_parse(this, type, 0, q_pos, &child);
+		err = parser_match(this, TOKEN_SUPER, q_pos);
 		if (err)
 			break;
-		parse_node_delete(child);	/* Consume 'super' */
 
 		type = ARGUMENTS;
 		err = parser_parse(this, type, flags, q_pos, &child);
 		break;
-	case CALL_EXPRESSION:	/* left-associative */
-		type = SUPER_CALL;
-		err = parser_parse(this, type, flags, q_pos, &child);
-		if (err == ERR_NO_MATCH) {
-			type = IMPORT_CALL;
-			err = parser_parse(this, type, flags, q_pos, &child);
-		}
-		if (err == ERR_NO_MATCH) {
-			type = CALL_MEMBER_EXPRESSION;	/* restrictive grammar */
-			err = parser_parse(this, type, flags, q_pos, &child);
-		}
-		if (err)
-			break;
-		parse_node_add_child(node, child);
-
-		/*
-		 * Now we must check for these to follow, in a loop. If none-follow,
-		 * done. Ignore error.
-		 * 	Arguments
-		 *	Array Expr. [ Expr ]
-		 *	. IdentifierName
-		 *	TemplateLiteral
-		 * 	. PrivateIdentifier
-		 * 	TemplateLiteral
-		 * 	IdentifierName
-		 * 	PrivateIdentifier
-		 */
-		type = CALL_EXPRESSION_POST;
-		flags = in_flags;
-		err = parser_parse(this, type, flags, q_pos, &child);
-		if (err)
-			err = ERR_SUCCESS;
-		break;
 		/*******************************************************************/
 	case OPTIONAL_CHAIN_POST:
 	case CALL_EXPRESSION_POST:
@@ -590,7 +1831,8 @@ int parser_parse(struct parser *this,
 				flags |= bits_on(GP_IN);
 				err = parser_parse(this, type, flags, q_pos, &child);
 			}
-			if (err == ERR_NO_MATCH) {
+			/* A template can't tag an optional chain; an early error. */
+			if (err == ERR_NO_MATCH && in_type != OPTIONAL_CHAIN_POST) {
 				type = TEMPLATE_LITERAL;
 				flags = in_flags | bits_on(GP_TAGGED);
 				err = parser_parse(this, type, flags, q_pos, &child);
@@ -603,14 +1845,19 @@ int parser_parse(struct parser *this,
 				type = DOT_PRIVATE_IDENTIFIER;
 				err = parser_parse(this, type, 0, q_pos, &child);
 			}
+			if (!err)
+				err = parser_add_child(&node, in_type, &child);
 			if (err)
 				break;
-			parse_node_add_child(node, child);
 		}
+
+		/* The loop ends at the first token that follows none. */
+		if (node &&
+			(err == ERR_NO_MATCH || err == ERR_END_OF_FILE))
+			err = ERR_SUCCESS;
 		break;
 	case OPTIONAL_CHAIN:	/* left-associative */
-		type = TOKEN_QUESTION_DOT;
-		err = parser_parse(this, type, 0, q_pos, &child);
+		err = parser_match(this, TOKEN_QUESTION_DOT, q_pos);
 		if (err)
 			break;
 
@@ -618,35 +1865,30 @@ int parser_parse(struct parser *this,
 		 * Now we must check for these first, to follow ?. :
 		 * 	Arguments
 		 * 	[ Expr ] (also called ArrayExpr; != ArrayLiteral)
-		 * 	TemplateLiteral
 		 * 	IdentifierName
 		 * 	PrivateIdentifier
+		 * A TemplateLiteral after ?. is an early error.
 		 */
 		type = ARGUMENTS;
 		err = parser_parse(this, type, flags, q_pos, &child);
 		if (err == ERR_NO_MATCH) {
 			type = ARRAY_EXPRESSION;	/* [ Expression ] */
-			flags |= bits_on(GP_IN);
-			err = parser_parse(this, type, 0, q_pos, &child);
+			err = parser_parse(this, type, flags, q_pos, &child);
 		}
 		if (err == ERR_NO_MATCH) {
 			type = IDENTIFIER_NAME;
 			err = parser_parse(this, type, 0, q_pos, &child);
 		}
-		if (err == ERR_NO_MATCH) {
-			type = TEMPLATE_LITERAL;
-			flags = in_flags | bits_on(GP_TAGGED);
-			err = parser_parse(this, type, flags, q_pos, &child);
-		}
 		if (err == ERR_NO_MATCH) {
 			type = PRIVATE_IDENTIFIER;
 			err = parser_parse(this, type, 0, q_pos, &child);
 		}
 
 		/* We matched ?., but could not match its followers. Syntax Err. */
+		if (!err)
+			err = parser_add_child(&node, in_type, &child);
 		if (err)
 			break;
-		parse_node_add_child(node, child);
 
 		/*
 		 * Now we must check for these to follow, in a loop. If none-follow,
@@ -654,11 +1896,8 @@ int parser_parse(struct parser *this,
 		 * 	Arguments
 		 *	Array Expr. [ Expr ]
 		 *	. IdentifierName
-		 *	TemplateLiteral
 		 * 	. PrivateIdentifier
-		 * 	TemplateLiteral
-		 * 	IdentifierName
-		 * 	PrivateIdentifier
+		 * Nor can a TemplateLiteral follow; see OPTIONAL_CHAIN_POST.
 		 */
 		type = OPTIONAL_CHAIN_POST;
 		flags = in_flags;
@@ -666,117 +1905,141 @@ int parser_parse(struct parser *this,
 		if (err)
 			err = ERR_SUCCESS;
 		break;
-	case OPTIONAL_EXPRESSION:	/* left-associative */
-		/* In decr. order of length */
-		type = CALL_EXPRESSION;
+		/*******************************************************************/
+	case LHS_EXPRESSION:
+		err = parser_parse_lhs(this, flags, q_pos, &child);
+		break;
+	case ASSIGNMENT_EXPRESSION:	/* right-associative */
+		/*
+		 * The ConditionalExpression is parsed once; the token after it tells
+		 * what it covers. Before an assignment operator, a bare
+		 * LHS_EXPRESSION that is a simple target is the target; there is no
+		 * AssignmentPattern yet. Before =>, on the same line, a bare
+		 * IdentifierReference or parenthesized cover is the arrow parameters.
+		 */
+		type = ASYNC_ARROW_FUNCTION;
 		err = parser_parse(this, type, flags, q_pos, &child);
+		if (err == ERR_NO_MATCH && bits_get(in_flags, GP_YIELD)) {
+			type = YIELD_EXPRESSION;
+			flags &= bits_off(GP_YIELD);
+			err = parser_parse(this, type, flags, q_pos, &child);
+		}
 		if (err == ERR_NO_MATCH) {
-			type = MEMBER_EXPRESSION;
+			type = CONDITIONAL_EXPRESSION;
+			flags = in_flags;
 			err = parser_parse(this, type, flags, q_pos, &child);
 		}
-
-		if (err)
+		if (err || type != CONDITIONAL_EXPRESSION)
 			break;
 
-		/* Add call/memexpr into the node */
-		parse_node_add_child(node, child);
-
-		/* There must be OPTIONAL_CHAINs */
-		has_opt_chain = false;
-		type = OPTIONAL_CHAIN;
-		while (true) {
-			err = parser_parse(this, type, flags, q_pos, &child);
-			if (err) {
-				err = has_opt_chain ? ERR_SUCCESS : err;
+		pos = *q_pos;
+		err = parser_get_token(this, SCANNER_GOAL_DIV, &pos, &token);
+		if (err) {
+			if (err == ERR_END_OF_FILE) {
+				err = ERR_SUCCESS;
 				break;
 			}
-			parse_node_add_child(node, child);
-		}
-		break;
-		/*******************************************************************/
-	case LHS_EXPRESSION:
-		/* In decr. order of length. */
-		type = OPTIONAL_EXPRESSION;
-		err = parser_parse(this, type, flags, q_pos, &child);
-		if (err == ERR_NO_MATCH) {
-			type = CALL_EXPRESSION;
-			err = parser_parse(this, type, flags, q_pos, &child);
+			parse_node_delete(child);
+			child = NULL;
+			break;
 		}
-		if (err == ERR_NO_MATCH) {
-			type = NEW_EXPRESSION;
-			err = parser_parse(this, type, flags, q_pos, &child);
+
+		if (token_type(token) == TOKEN_ARROW &&
+			!token_has_new_line_pfx(token) && parser_is_arrow_cover(child)) {
+			*q_pos = pos;
+			cover = child;
+			err = parser_parse_arrow(this, cover, flags, q_pos, &child);
+			break;
 		}
-		break;
-	case ASSIGNMENT_EXPRESSION:	/* right-associative */
-		/*
-		 * LHS_Expr occurs both as a child and grand(n)-child. Hence, check
-		 * LHS_Expr first
-		 */
-		type = LHS_EXPRESSION;
-		flags &= bits_off(GP_IN);
-		err = parser_parse(this, type, flags, q_pos, &child);
-		if (!err) {
-			/* If LHS_EXPR was parsed, check for operators next */
-			parse_node_add_child(node, child);	/* Add LHS_EXPRESSION */
 
-			for (i = 0; i < ARRAY_SIZE(g_assign_expr_ops); ++i) {
-				type = g_assign_expr_ops[i];
-				err = parser_parse(this, type, 0, q_pos, &child);
-				/* if no match continue, else break */
-				if (err != ERR_NO_MATCH)
-					break;
-			}
+		if (!parser_is_assign_op(token_type(token)))
+			break;
+		cover = parse_node_only_child(child, LHS_EXPRESSION);
+		if (cover == NULL || !parser_is_simple_target(cover))
+			break;	/* Not a target; the caller fails on the operator. */
 
-			/* If there was an error, reparse. Else, continue. */
-			if (err) {
-				/* Reparse */
-				*q_pos = in_pos;
-			} else {
-				parse_node_add_child(node, child);	/* Add the operator */
+		parse_node_set_stale(child);
+		list_del_entry(&cover->entry);
+		parse_node_delete(child);
+		err = parser_add_child(&node, in_type, &cover);	/* LHS_EXPRESSION */
+		if (err)
+			break;
+		*q_pos = pos;
 
-				type = ASSIGNMENT_EXPRESSION;
-				flags = in_flags;
-				err = parser_parse(this, type, flags, q_pos, &child);
-				/*
-				 * The end-of-func will deal with the child depending on the
-				 * error.
-				 */
-				break;
-			}
+		err = parse_node_new(token_type(token), &child);
+		if (!err)
+			err = parser_add_child(&node, in_type, &child);	/* The operator */
+		if (err)
+			break;
+
+		type = ASSIGNMENT_EXPRESSION;
+		err = parser_parse(this, type, flags, q_pos, &child);
+		/* The end-of-func will deal with the child depending on the error. */
+		break;
+	case CONDITIONAL_EXPRESSION:	/* right-associative */
+		err = parser_parse_binary(this, PREC_SHORT_CIRCUIT, flags, q_pos,
+								  &child);
+		if (!err)
+			err = parser_add_child(&node, in_type, &child);
+		if (err)
+			break;
+
+		/* The ? : is optional. */
+		err = parser_match(this, TOKEN_QUESTION, q_pos);
+		if (err) {
+			if (err == ERR_NO_MATCH || err == ERR_END_OF_FILE)
+				err = ERR_SUCCESS;
+			break;
 		}
 
-		/* Reparse */
-		type = ASYNC_ARROW_FUNCTION;
+		type = ASSIGNMENT_EXPRESSION;
+		flags |= bits_on(GP_IN);
+		err = parser_parse(this, type, flags, q_pos, &child);
+		if (!err)
+			err = parser_add_child(&node, in_type, &child);
+		if (!err)
+			err = parser_match(this, TOKEN_COLON, q_pos);
+		if (err)
+			break;
+
+		type = ASSIGNMENT_EXPRESSION;
 		flags = in_flags;
 		err = parser_parse(this, type, flags, q_pos, &child);
-		if (err == ERR_NO_MATCH && bits_get(in_flags, GP_YIELD)) {
-			type = YIELD_EXPRESSION;
-			flags &= bits_off(GP_YIELD);
-			err = parser_parse(this, type, flags, q_pos, &child);
-		}
-		if (err == ERR_NO_MATCH) {
-			type = ARROW_FUNCTION;
-			flags = in_flags;
+		break;
+	case EXPRESSION:	/* left-associative */
+		pos = *q_pos;
+		while (true) {
+			type = ASSIGNMENT_EXPRESSION;
 			err = parser_parse(this, type, flags, q_pos, &child);
+			if (!err)
+				err = parser_add_child(&node, in_type, &child);
+			if (err)
+				break;
+
+			/* A comma that no item follows is left, e.g. for the cover. */
+			pos = *q_pos;
+			err = parser_match(this, TOKEN_COMMA, q_pos);
+			if (err)
+				break;
 		}
-		if (err == ERR_NO_MATCH) {
-			type = CONDITIONAL_EXPRESSION;
-			err = parser_parse(this, type, flags, q_pos, &child);
+
+		if (node &&
+			(err == ERR_NO_MATCH || err == ERR_END_OF_FILE)) {
+			*q_pos = pos;
+			err = ERR_SUCCESS;
 		}
-		/* func-end will take care of child. */
 		break;
 		/*******************************************************************/
 	case INITIALIZER:
-		type = TOKEN_EQUALS;
-		err = parser_parse(this, type, 0, q_pos, &child);
+		err = parser_match(this, TOKEN_EQUALS, q_pos);
 		if (err)
 			break;
 
-		parse_node_delete(child);	/* Consume = */
 		type = ASSIGNMENT_EXPRESSION;
 		err = parser_parse(this, type, flags, q_pos, &child);
 		break;
 		/*******************************************************************/
+	case IDENTIFIER_REFERENCE:
 	case BINDING_IDENTIFIER:
 		type = IDENTIFIER_NAME;
 		err = parser_parse(this, type, 0, q_pos, &child);
@@ -790,6 +2053,19 @@ int parser_parse(struct parser *this,
 			err = ERR_NO_MATCH;
 		}
 		break;
+	case BINDING_REST_ELEMENT:
+		err = parser_match(this, TOKEN_ELLIPSIS, q_pos);
+		if (err)
+			break;
+
+		type = BINDING_IDENTIFIER;
+		flags &= bits_off(GP_IN);
+		err = parser_parse(this, type, flags, q_pos, &child);
+		if (err == ERR_NO_MATCH) {
+			type = BINDING_PATTERN;
+			err = parser_parse(this, type, flags, q_pos, &child);
+		}
+		break;
 		/*******************************************************************/
 	case VARIABLE_DECLARATION:
 		type = BINDING_IDENTIFIER;
@@ -800,10 +2076,10 @@ int parser_parse(struct parser *this,
 			err = parser_parse(this, type, flags, q_pos, &child);
 		}
 
+		if (!err)
+			err = parser_add_child(&node, in_type, &child);
 		if (err)
 			break;
-
-		parse_node_add_child(node, child);
 		is_ident = type == BINDING_IDENTIFIER;
 
 		/* Initializer is optional for Identifier */
@@ -820,41 +2096,35 @@ int parser_parse(struct parser *this,
 			err = parser_parse(this, type, flags, q_pos, &child);
 			if (err) {
 				/* If we have a valid list, ignore the error. */
-				if (parse_node_has_children(node))
+				if (node)
 					err = ERR_SUCCESS;	/* Error handling later. */
 				break;
 			}
-			parse_node_add_child(node, child);
+			err = parser_add_child(&node, in_type, &child);
+			if (err)
+				break;
 
 			/* Check for comma. If exists, continue, else break. */
-			type = TOKEN_COMMA;
-			err = parser_parse(this, type, 0, q_pos, &child);
+			err = parser_match(this, TOKEN_COMMA, q_pos);
 			if (err) {
 				/* We have at least a proper var decl list */
 				err = ERR_SUCCESS;
 				break;
 			}
-
-			/*
-			 * Delete the COMMA node. The child ptr will be set to null by the
-			 * call to parser_parse in this loop.
-			 */
-			parse_node_delete(child);
 		}
 		break;
 	case VARIABLE_STATEMENT:
-		type = TOKEN_VAR;
-		err = parser_parse(this, type, 0, q_pos, &child);
+		err = parser_match(this, TOKEN_VAR, q_pos);
 		if (err)
 			break;
-		parse_node_delete(child);	/* Delete the VAR node */
 
 		type = VARIABLE_DECLARATION_LIST;
 		flags |= bits_on(GP_IN);
 		err = parser_parse(this, type, flags, q_pos, &child);
+		if (!err)
+			err = parser_add_child(&node, in_type, &child);
 		if (err)
 			break;
-		parse_node_add_child(node, child);
 
 		/*
 		 * SEMI_COLON, EOF and NL end the Var_Stmt.
@@ -865,17 +2135,11 @@ int parser_parse(struct parser *this,
 		 * stmt.
 		 */
 
-		type = TOKEN_NEW_LINE;
-		err = parser_parse(this, type, 0, q_pos, &child);
-		if (err == ERR_NO_MATCH) {
-			type = TOKEN_SEMI_COLON;
-			err = parser_parse(this, type, 0, q_pos, &child);
-		}
+		err = parser_match(this, TOKEN_NEW_LINE, q_pos);
+		if (err == ERR_NO_MATCH)
+			err = parser_match(this, TOKEN_SEMI_COLON, q_pos);
 
-		if (!err) {
-			parse_node_delete(child);	/* Consume the nl/; */
-			child = NULL;
-		} else if (err == ERR_END_OF_FILE) {
+		if (err == ERR_END_OF_FILE) {
 			err = ERR_SUCCESS;
 		} else if (err == ERR_NO_MATCH) {
 			/*
@@ -886,37 +2150,25 @@ int parser_parse(struct parser *this,
 		break;
 		/*******************************************************************/
 	case BLOCK:
-		type = TOKEN_LEFT_BRACE;
-		err = parser_parse(this, type, 0, q_pos, &child);
+		err = parser_match(this, TOKEN_LEFT_BRACE, q_pos);
 		if (err)
 			break;
-		parse_node_delete(child);
 
 		/* STATEMENT_LIST is optional for BLOCK */
-		type = TOKEN_RIGHT_BRACE;
-		err = parser_parse(this, type, 0, q_pos, &child);
-		if (!err) {
-			/* Empty Block */
-			parse_node_delete(child);
-			child = NULL;
-			break;
-		}
+		err = parser_match(this, TOKEN_RIGHT_BRACE, q_pos);
+		if (!err)
+			break;	/* Empty Block */
 
 		/* Non-Empty Block. */
 		type = STATEMENT_LIST;
 		err = parser_parse(this, type, flags, q_pos, &child);
+		if (!err)
+			err = parser_add_child(&node, in_type, &child);
 		if (err)
 			break;
 
-		parse_node_add_child(node, child);
-
 		/* There must be a }, after the STATEMENT_LIST */
-		type = TOKEN_RIGHT_BRACE;
-		err = parser_parse(this, type, 0, q_pos, &child);
-		if (err)
-			break;
-		parse_node_delete(child);
-		child = NULL;
+		err = parser_match(this, TOKEN_RIGHT_BRACE, q_pos);
 		break;
 	case BLOCK_STATEMENT:
 		type = BLOCK;
@@ -993,12 +2245,16 @@ int parser_parse(struct parser *this,
 			printf("%s: unsup non-term %d\n", __func__, type - SCRIPT);
 		else if (type >= TOKEN_IDENTIFIER)
 			printf("%s: unsup ident %d\n", __func__, type - TOKEN_IDENTIFIER);
-		exit(0);
+		err = ERR_UNSUPPORTED;
+		break;
 	}
 
+	if (!err && child)
+		err = parser_add_child(&node, in_type, &child);
+	if (!err && node == NULL)
+		err = parse_node_new(in_type, &node);	/* Without children */
+
 	if (!err) {
-		if (child)
-			parse_node_add_child(node, child);
 		*out = node;
 	} else {
 		/* child is not inserted into node yet. Should be NULL. */
@@ -1011,6 +2267,18 @@ int parser_parse(struct parser *this,
 		/* rest the q_pos upon error. */
 		*q_pos = in_pos;
 	}
+
+	if (is_memoized) {
+		entry.pos = in_pos;
+		entry.end_pos = *q_pos;
+		entry.reach = this->reach;
+		entry.err = err;
+		entry.flags = in_flags;
+		entry.type = in_type;
+		parser_record(this, &entry, *out);
+		if (this->reach < outer_reach)
+			this->reach = outer_reach;
+	}
 	return err;
 }
 
@@ -1025,3 +2293,29 @@ int parser_parse_script(struct parser *this)
 		err = ERR_SUCCESS;
 	return err;
 }
+
+/* A failure that is not the scanner's is placed at the furthest token read. */
+int parser_locate_error(struct parser *this,
+						size_t *row,
+						size_t *col)
+{
+	int err;
+	size_t pos, end;
+
+	if (this->pipeline)
+		pipeline_pause(this->pipeline);
+
+	pos = 0;
+	end = this->reach < this->num_tokens ? this->reach : this->num_tokens;
+	if (this->is_scan_failed)
+		pos = this->scan_fail_pos;
+	else if (end > this->base)
+		pos = this->tokens[end - 1 - this->base]->scan_pos;
+
+	err = scanner_locate(this->scanner, pos, row, col);
+	if (err)
+		return err;
+	++*row;
+	++*col;
+	return ERR_SUCCESS;
+}
@@ -0,0 +1,212 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+#include <prv/pipeline.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <threads.h>
+
+#define CACHE_LINE_SIZE		64
+
+enum pipeline_cmd {
+	PIPELINE_RUN,
+	PIPELINE_PAUSE,
+	PIPELINE_STOP,
+};
+
+/*
+ * The head is written only by the parser, and the tail only by the scanner
+ * thread; each is on its own cache line. The ring indices run freely, and
+ * wrap around the ring with a mask.
+ *
+ * The cmd and is_parked are under the lock. The pause is also asked for
+ * through is_pause_req, so that the scanner thread can poll it without the
+ * lock.
+ */
+struct pipeline {
+	_Alignas(CACHE_LINE_SIZE) atomic_size_t	head;
+	_Alignas(CACHE_LINE_SIZE) atomic_size_t	tail;
+	_Alignas(CACHE_LINE_SIZE) atomic_bool	is_pause_req;
+	atomic_bool			is_done;
+	int					err;	/* Valid once is_done */
+	struct goal_guess	guess;	/* The scanner thread's */
+	struct scanner		*scanner;
+	const struct token	*ring[PIPELINE_RING_SIZE];
+
+	mtx_t				lock;
+	cnd_t				cond;
+	enum pipeline_cmd	cmd;
+	bool				is_parked;
+	thrd_t				thread;
+};
+
+static_assert((PIPELINE_RING_SIZE & (PIPELINE_RING_SIZE - 1)) == 0,
+			  "PIPELINE_RING_SIZE must be a power of 2");
+/*******************************************************************/
+/* Returns once a pause is asked for, or once the scanner fails. */
+static
+void pipeline_scan(struct pipeline *this)
+{
+	int err;
+	size_t tail;
+	const struct token *token;
+
+	tail = atomic_load_explicit(&this->tail, memory_order_relaxed);
+	while (!atomic_load_explicit(&this->is_pause_req, memory_order_relaxed)) {
+		/* The parser must be done with a slot before it is reused. */
+		if (tail - atomic_load_explicit(&this->head, memory_order_acquire) ==
+			PIPELINE_RING_SIZE) {
+			thrd_yield();
+			continue;
+		}
+
+		err = goal_guess_scan(&this->guess, this->scanner, &token);
+		if (err) {
+			this->err = err;
+			atomic_store_explicit(&this->is_done, true, memory_order_release);
+			return;
+		}
+
+		goal_guess_add(&this->guess, token);
+		this->ring[tail & (PIPELINE_RING_SIZE - 1)] = token;
+		atomic_store_explicit(&this->tail, ++tail, memory_order_release);
+	}
+}
+
+/* Parks while paused, or once done, until resumed or stopped. */
+static
+int pipeline_run(void *arg)
+{
+	struct pipeline *this = arg;
+
+	mtx_lock(&this->lock);
+	while (this->cmd != PIPELINE_STOP) {
+		if (this->cmd == PIPELINE_PAUSE ||
+			atomic_load_explicit(&this->is_done, memory_order_relaxed)) {
+			this->is_parked = true;
+			cnd_broadcast(&this->cond);
+			cnd_wait(&this->cond, &this->lock);
+			continue;
+		}
+		this->is_parked = false;
+		mtx_unlock(&this->lock);
+		pipeline_scan(this);
+		mtx_lock(&this->lock);
+	}
+	this->is_parked = true;
+	cnd_broadcast(&this->cond);
+	mtx_unlock(&this->lock);
+	return 0;
+}
+/*******************************************************************/
+int pipeline_new(struct scanner *scanner,
+				 struct pipeline **out)
+{
+	int err;
+	struct pipeline *pipeline;
+
+	err = ERR_NO_MEMORY;
+	pipeline = aligned_alloc(_Alignof(struct pipeline), sizeof(*pipeline));
+	if (pipeline == NULL)
+		goto err0;
+
+	memset(pipeline, 0, sizeof(*pipeline));
+	atomic_init(&pipeline->head, 0);
+	atomic_init(&pipeline->tail, 0);
+	atomic_init(&pipeline->is_pause_req, false);
+	atomic_init(&pipeline->is_done, false);
+	pipeline->scanner = scanner;
+	pipeline->cmd = PIPELINE_RUN;
+
+	if (mtx_init(&pipeline->lock, mtx_plain) != thrd_success)
+		goto err1;
+	if (cnd_init(&pipeline->cond) != thrd_success)
+		goto err2;
+	if (thrd_create(&pipeline->thread, pipeline_run, pipeline) !=
+		thrd_success)
+		goto err3;
+	*out = pipeline;
+	return ERR_SUCCESS;
+err3:
+	cnd_destroy(&pipeline->cond);
+err2:
+	mtx_destroy(&pipeline->lock);
+err1:
+	free(pipeline);
+err0:
+	return err;
+}
+
+int pipeline_delete(struct pipeline *this)
+{
+	atomic_store_explicit(&this->is_pause_req, true, memory_order_relaxed);
+	mtx_lock(&this->lock);
+	this->cmd = PIPELINE_STOP;
+	cnd_broadcast(&this->cond);
+	mtx_unlock(&this->lock);
+
+	thrd_join(this->thread, NULL);
+	cnd_destroy(&this->cond);
+	mtx_destroy(&this->lock);
+	free(this);
+	return ERR_SUCCESS;
+}
+
+/* The tail is published before is_done; recheck it once done. */
+int pipeline_get_next_token(struct pipeline *this,
+							const struct token **out)
+{
+	size_t head;
+
+	head = atomic_load_explicit(&this->head, memory_order_relaxed);
+	while (head == atomic_load_explicit(&this->tail, memory_order_acquire)) {
+		if (atomic_load_explicit(&this->is_done, memory_order_acquire) &&
+			head == atomic_load_explicit(&this->tail, memory_order_acquire))
+			return this->err;
+		thrd_yield();
+	}
+
+	*out = this->ring[head & (PIPELINE_RING_SIZE - 1)];
+	atomic_store_explicit(&this->head, head + 1, memory_order_release);
+	return ERR_SUCCESS;
+}
+
+/*
+ * The scanner thread can't be scanning once it is parked with the cmd at
+ * PAUSE; it leaves the park only under the lock, and only for a RUN.
+ */
+void pipeline_pause(struct pipeline *this)
+{
+	atomic_store_explicit(&this->is_pause_req, true, memory_order_relaxed);
+	mtx_lock(&this->lock);
+	this->cmd = PIPELINE_PAUSE;
+	cnd_broadcast(&this->cond);
+	while (!this->is_parked)
+		cnd_wait(&this->cond, &this->lock);
+	mtx_unlock(&this->lock);
+}
+
+/* The stores are published to the scanner thread by the lock. */
+void pipeline_resume(struct pipeline *this,
+					 const struct token *const *tokens,
+					 size_t num_tokens)
+{
+	size_t i;
+
+	memset(&this->guess, 0, sizeof(this->guess));
+	for (i = 0; i < num_tokens; ++i)
+		goal_guess_add(&this->guess, tokens[i]);
+
+	atomic_store_explicit(&this->head, 0, memory_order_relaxed);
+	atomic_store_explicit(&this->tail, 0, memory_order_relaxed);
+	atomic_store_explicit(&this->is_done, false, memory_order_relaxed);
+	atomic_store_explicit(&this->is_pause_req, false, memory_order_relaxed);
+
+	mtx_lock(&this->lock);
+	this->cmd = PIPELINE_RUN;
+	cnd_broadcast(&this->cond);
+	mtx_unlock(&this->lock);
+}
@@ -0,0 +1,147 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+#include <pub/pool.h>
+#include <pub/error.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <threads.h>
+
+/*
+ * No jobs are added once the workers start. A deque is then just the range
+ * [head, tail) of its jobs; the owner advances the head, thieves retreat the
+ * tail. The jobs are coarse (whole files), so a lock per deque is cheap
+ * enough.
+ */
+struct pool_deque {
+	mtx_t					lock;
+	const struct pool_job	**jobs;
+	size_t					head;
+	size_t					tail;
+};
+
+struct pool_worker {
+	struct pool			*pool;
+	size_t				index;
+	thrd_t				thread;
+	struct pool_deque	deque;
+};
+
+struct pool {
+	struct pool_worker	*workers;
+	size_t				num_workers;
+};
+/*******************************************************************/
+static
+const struct pool_job *pool_deque_pop(struct pool_deque *this,
+									  bool is_steal)
+{
+	const struct pool_job *job;
+
+	job = NULL;
+	mtx_lock(&this->lock);
+	if (this->head < this->tail)
+		job = is_steal ? this->jobs[--this->tail] : this->jobs[this->head++];
+	mtx_unlock(&this->lock);
+	return job;
+}
+
+static
+const struct pool_job *pool_worker_next_job(struct pool_worker *this)
+{
+	size_t i, n;
+	const struct pool_job *job;
+	struct pool *pool;
+
+	job = pool_deque_pop(&this->deque, false);
+	if (job)
+		return job;
+
+	/* Steal, starting with the next worker. */
+	pool = this->pool;
+	n = pool->num_workers;
+	for (i = 1; i < n && job == NULL; ++i)
+		job = pool_deque_pop(&pool->workers[(this->index + i) % n].deque,
+							 true);
+	return job;
+}
+
+/* Since no jobs are added, a worker is done when all deques are empty. */
+static
+int pool_worker_run(void *arg)
+{
+	const struct pool_job *job;
+	struct pool_worker *this = arg;
+
+	while ((job = pool_worker_next_job(this)))
+		job->fn(job->arg);
+	return 0;
+}
+/*******************************************************************/
+int pool_run(const struct pool_job *jobs,
+			 size_t num_jobs,
+			 size_t num_workers)
+{
+	int err;
+	size_t i, num_inited, num_started, per_worker;
+	struct pool pool;
+	struct pool_worker *worker;
+	struct pool_deque *deque;
+
+	if (num_workers == 0)
+		return ERR_INVALID_PARAMETER;
+	if (num_workers > num_jobs)
+		num_workers = num_jobs ? num_jobs : 1;
+
+	err = ERR_NO_MEMORY;
+	pool.num_workers = num_workers;
+	pool.workers = calloc(num_workers, sizeof(*pool.workers));
+	if (pool.workers == NULL)
+		goto err0;
+
+	per_worker = (num_jobs + num_workers - 1) / num_workers;
+	for (num_inited = 0; num_inited < num_workers; ++num_inited) {
+		worker = &pool.workers[num_inited];
+		worker->pool = &pool;
+		worker->index = num_inited;
+		deque = &worker->deque;
+		deque->jobs = calloc(per_worker ? per_worker : 1,
+							 sizeof(*deque->jobs));
+		if (deque->jobs == NULL)
+			goto err1;
+		if (mtx_init(&deque->lock, mtx_plain) != thrd_success) {
+			free(deque->jobs);
+			goto err1;
+		}
+	}
+
+	/* Deal the jobs. */
+	for (i = 0; i < num_jobs; ++i) {
+		deque = &pool.workers[i % num_workers].deque;
+		deque->jobs[deque->tail++] = &jobs[i];
+	}
+
+	/*
+	 * Worker 0 runs on the caller's thread. If a thread cannot be started,
+	 * its jobs are stolen by the others.
+	 */
+	for (num_started = 1; num_started < num_workers; ++num_started) {
+		worker = &pool.workers[num_started];
+		if (thrd_create(&worker->thread, pool_worker_run, worker) !=
+			thrd_success)
+			break;
+	}
+	pool_worker_run(&pool.workers[0]);
+	for (i = 1; i < num_started; ++i)
+		thrd_join(pool.workers[i].thread, NULL);
+	err = ERR_SUCCESS;
+err1:
+	for (i = 0; i < num_inited; ++i) {
+		mtx_destroy(&pool.workers[i].deque.lock);
+		free(pool.workers[i].deque.jobs);
+	}
+	free(pool.workers);
+err0:
+	return err;
+}
@@ -0,0 +1,370 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+#include <prv/prescan.h>
+
+#include <pub/pool.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Sorted by the positions of the tokens. */
+struct token_buf {
+	const struct token	**tokens;
+	size_t				len;
+	size_t				size;
+};
+
+/*
+ * The scan runs from start until a token starts at or past the end; that
+ * token is the first of the next segment, if the scan followed the src. The
+ * err, if any, is that which stopped the scan, at err_pos.
+ */
+struct segment {
+	struct scanner		*scanner;
+	size_t				start;
+	size_t				end;
+	struct token_buf	tokens;
+	uint32_t			*atom_map;	/* Into the atoms of the prescan's scanner */
+	int					err;
+	size_t				err_pos;
+};
+
+struct prescan {
+	struct scanner		*scanner;
+	struct token_buf	tokens;
+	int					err;	/* After the last token */
+	size_t				err_pos;	/* Of the token that failed */
+	size_t				next;
+	bool				is_synced;
+};
+/*******************************************************************/
+static
+int token_buf_add(struct token_buf *this,
+				  const struct token *token)
+{
+	size_t size;
+	const struct token **tokens;
+
+	if (this->len == this->size) {
+		size = this->size ? this->size << 1 : 1024;
+		tokens = realloc(this->tokens, size * sizeof(*tokens));
+		if (tokens == NULL)
+			return ERR_NO_MEMORY;
+		this->tokens = tokens;
+		this->size = size;
+	}
+	this->tokens[this->len++] = token;
+	return ERR_SUCCESS;
+}
+
+/* Tokens alike cover the same units, and read them the same. */
+static
+bool token_is_alike(const struct token *a,
+					const struct token *b)
+{
+	return a->scan_pos == b->scan_pos && a->raw_len == b->raw_len &&
+		a->type == b->type && a->flags == b->flags;
+}
+
+static
+bool token_buf_find(const struct token_buf *this,
+					const struct token *token,
+					size_t *out)
+{
+	size_t lo, hi, mid;
+
+	lo = 0;
+	hi = this->len;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (this->tokens[mid]->scan_pos < token->scan_pos)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == this->len || !token_is_alike(this->tokens[lo], token))
+		return false;
+	*out = lo;
+	return true;
+}
+/*******************************************************************/
+/* The first segment starts at the src's start; the rest, after a line. */
+static
+void segment_scan(void *arg)
+{
+	int err;
+	struct goal_guess guess;
+	const struct token *token;
+	struct segment *this = arg;
+
+	memset(&guess, 0, sizeof(guess));
+	err = scanner_seek(this->scanner, this->start,
+					   this->start ? TOKEN_NEW_LINE : TOKEN_INVALID);
+	while (!err) {
+		err = goal_guess_scan(&guess, this->scanner, &token);
+		if (!err)
+			err = token_buf_add(&this->tokens, token);
+		if (err)
+			break;
+		goal_guess_add(&guess, token);
+		if (token->scan_pos >= this->end)
+			break;
+	}
+	this->err = err;
+	this->err_pos = this->scanner->curr_pos;
+
+	this->atom_map = calloc(atom_table_count(this->scanner->atoms) + 1,
+							sizeof(*this->atom_map));
+}
+
+static
+void segment_delete(struct segment *this)
+{
+	if (this->scanner)
+		scanner_delete(this->scanner);
+	free(this->tokens.tokens);
+	free(this->atom_map);
+}
+
+/*
+ * The nominal starts are evenly spaced; each is moved past the next \n. The
+ * segments that would then be empty are dropped.
+ */
+static
+size_t prescan_split(const struct prescan *this,
+					 struct segment *segs,
+					 size_t num_segs)
+{
+	size_t i, n, pos, len;
+
+	len = this->scanner->src_len;
+	n = 0;
+	segs[n++].start = 0;
+	for (i = 1; i < num_segs; ++i) {
+		pos = i * len / num_segs;
+		if (pos < segs[n - 1].start)
+			pos = segs[n - 1].start;
+		while (pos < len && scanner_unit(this->scanner, pos++) != '\n')
+			;
+		if (pos == len)
+			break;
+		segs[n++].start = pos;
+	}
+
+	for (i = 0; i < n; ++i)
+		segs[i].end = i + 1 < n ? segs[i + 1].start : len;
+	return n;
+}
+/*******************************************************************/
+/* The scanner goes on from after the last stitched token. */
+static
+int prescan_seek_last(struct prescan *this)
+{
+	const struct token *last;
+
+	if (this->tokens.len == 0)
+		return scanner_seek(this->scanner, 0, TOKEN_INVALID);
+	last = this->tokens.tokens[this->tokens.len - 1];
+	return scanner_seek(this->scanner, last->scan_pos + last->raw_len,
+						token_type(last));
+}
+
+/*
+ * The tokens of the first segment follow the src. So do those of any other,
+ * from a token alike with one that does. The scanner reads in between, i.e.
+ * whenever the first token past the end of a segment is not in the next.
+ *
+ * The tokens are adopted in order; the atoms are thus numbered as they would
+ * be by a serial scan, unless a goal was misguessed.
+ */
+static
+int prescan_stitch(struct prescan *this,
+				   struct segment *segs,
+				   size_t num_segs)
+{
+	int err;
+	size_t k, i;
+	bool is_serial;
+	struct segment *seg;
+	struct goal_guess guess;
+	const struct token *token;
+
+	memset(&guess, 0, sizeof(guess));
+	k = i = 0;
+	is_serial = false;
+	while (true) {
+		seg = &segs[k];
+		if (is_serial) {
+			err = goal_guess_scan(&guess, this->scanner, &token);
+			if (err) {
+				this->err_pos = this->scanner->save_pos;
+				break;
+			}
+			while (k + 1 < num_segs && token->scan_pos >= segs[k + 1].start)
+				++k;
+			if (token_buf_find(&segs[k].tokens, token, &i)) {
+				++i;
+				is_serial = false;
+			}
+		} else if (i == seg->tokens.len) {
+			/* Unless it stopped past its end, the src fails there. */
+			err = seg->err;
+			this->err_pos = seg->scanner->save_pos;
+			if (seg->err_pos < seg->end || k + 1 == num_segs)
+				break;
+			err = prescan_seek_last(this);
+			if (err)
+				return err;
+			is_serial = true;
+			continue;
+		} else {
+			token = seg->tokens.tokens[i];
+			if (token->scan_pos >= seg->end) {
+				if (token_buf_find(&segs[k + 1].tokens, token, &i)) {
+					++k;
+					continue;
+				}
+				err = prescan_seek_last(this);
+				if (err)
+					return err;
+				is_serial = true;
+				continue;
+			}
+			err = scanner_adopt_token(this->scanner, seg->scanner, token,
+									  seg->atom_map, &token);
+			if (err)
+				return err;
+			++i;
+		}
+
+		err = token_buf_add(&this->tokens, token);
+		if (err)
+			return err;
+		goal_guess_add(&guess, token);
+	}
+	this->err = err;
+	return ERR_SUCCESS;
+}
+/*******************************************************************/
+int prescan_new(struct scanner *scanner,
+				size_t num_segments,
+				struct prescan **out)
+{
+	int err;
+	size_t i, num_segs;
+	struct segment *segs;
+	struct pool_job *jobs;
+	struct prescan *prescan;
+
+	if (num_segments == 0)
+		return ERR_INVALID_PARAMETER;
+	if (scanner->stream)
+		return ERR_UNSUPPORTED;
+
+	num_segs = scanner->src_len / PRESCAN_MIN_SEGMENT_SIZE;
+	num_segs = num_segs < num_segments ? num_segs : num_segments;
+	num_segs = num_segs ? num_segs : 1;
+
+	err = ERR_NO_MEMORY;
+	prescan = calloc(1, sizeof(*prescan));
+	if (prescan == NULL)
+		goto err0;
+
+	segs = calloc(num_segs, sizeof(*segs));
+	if (segs == NULL)
+		goto err1;
+
+	jobs = malloc(num_segs * sizeof(*jobs));
+	if (jobs == NULL)
+		goto err2;
+
+	prescan->scanner = scanner;
+	num_segs = prescan_split(prescan, segs, num_segs);
+	for (i = 0; i < num_segs; ++i) {
+		err = scanner_new(scanner->src, scanner->src_len,
+						  scanner->src_unit_size, &segs[i].scanner);
+		if (err)
+			goto err3;
+		jobs[i].fn = segment_scan;
+		jobs[i].arg = &segs[i];
+	}
+
+	err = pool_run(jobs, num_segs, num_segs);
+	if (err)
+		goto err3;
+
+	err = ERR_NO_MEMORY;
+	for (i = 0; i < num_segs; ++i)
+		if (segs[i].err == ERR_NO_MEMORY || segs[i].atom_map == NULL)
+			goto err3;
+
+	err = prescan_stitch(prescan, segs, num_segs);
+	if (err)
+		goto err3;
+
+	for (i = 0; i < num_segs; ++i)
+		segment_delete(&segs[i]);
+	free(jobs);
+	free(segs);
+	prescan->is_synced = true;
+	*out = prescan;
+	return ERR_SUCCESS;
+err3:
+	for (i = 0; i < num_segs; ++i)
+		segment_delete(&segs[i]);
+	free(jobs);
+err2:
+	free(segs);
+err1:
+	free(prescan->tokens.tokens);
+	free(prescan);
+err0:
+	return err;
+}
+
+/* The tokens are freed along with the scanner. */
+int prescan_delete(struct prescan *this)
+{
+	free(this->tokens.tokens);
+	free(this);
+	return ERR_SUCCESS;
+}
+
+int prescan_get_next_token(struct prescan *this,
+						   enum scanner_goal goal,
+						   const struct token **out)
+{
+	int err;
+	const struct token *token;
+
+	if (this->is_synced) {
+		if (this->next == this->tokens.len)
+			return this->err;
+		*out = this->tokens.tokens[this->next++];
+		return ERR_SUCCESS;
+	}
+
+	err = scanner_get_next_token(this->scanner, goal, &token);
+	if (err) {
+		this->err_pos = this->scanner->save_pos;
+		return err;
+	}
+	prescan_resume(this, token);
+	*out = token;
+	return ERR_SUCCESS;
+}
+
+size_t prescan_error_pos(const struct prescan *this)
+{
+	return this->err_pos;
+}
+
+void prescan_resume(struct prescan *this,
+					const struct token *token)
+{
+	this->is_synced = token && token_buf_find(&this->tokens, token,
+											  &this->next);
+	if (this->is_synced)
+		++this->next;
+}
@@ -5,8 +5,11 @@
 
 #include <pub/unicode.h>
 #include <pub/system.h>
+#include <pub/stream.h>
+#include <pub/arena.h>
+#include <pub/lines.h>
 
-#include <stdio.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -67,174 +70,528 @@ char16_t *g_key_words[] = {
 	u"with",
 	u"yield",
 };
-/*******************************************************************/
-static
-int token_new(enum token_type type,
-			  const struct token_location *locn,
-			  size_t raw_len,
-			  size_t flags,
-			  struct token **out)
-{
-	struct token *token;
 
-	token = calloc(1, sizeof(*token));
-	if (token == NULL)
-		return ERR_NO_MEMORY;
+/*
+ * Perfect hash of the key words, on their length and on their first, second
+ * and last chars. (The first and last chars alone cannot tell package from
+ * private.) The associated values were found by a search. A collision would
+ * make two designated initializers of g_key_word_hash overlap, which
+ * -Woverride-init (part of -Wextra) rejects at compile time.
+ */
+#define KW_MIN_LEN		2
+#define KW_MAX_LEN		10
+#define KW_HASH_SIZE	64
+
+#define KW_ASSO(c)	\
+	((c) == 'a' ? 39 : (c) == 'b' ? 37 : (c) == 'c' ? 4 : (c) == 'd' ? 29 :	\
+	 (c) == 'e' ? 41 : (c) == 'f' ? 55 : (c) == 'g' ? 7 : (c) == 'h' ? 44 :	\
+	 (c) == 'i' ? 26 : (c) == 'j' ? 1 : (c) == 'k' ? 51 : (c) == 'l' ? 61 :	\
+	 (c) == 'm' ? 26 : (c) == 'n' ? 8 : (c) == 'o' ? 41 : (c) == 'p' ? 11 :	\
+	 (c) == 'q' ? 63 : (c) == 'r' ? 2 : (c) == 's' ? 20 : (c) == 't' ? 56 :	\
+	 (c) == 'u' ? 0 : (c) == 'v' ? 28 : (c) == 'w' ? 26 : (c) == 'x' ? 2 :	\
+	 (c) == 'y' ? 51 : 45)
+
+#define KW_HASH(len, c0, c1, cl)	\
+	(((len) + KW_ASSO(c0) + KW_ASSO(c1) + KW_ASSO(cl)) & (KW_HASH_SIZE - 1))
 
-	token->type = type;
-	token->locn = *locn;
-	token->flags = flags;
-	token->raw_len = raw_len;
-	*out = token;
-	return ERR_SUCCESS;
-}
+static const
+unsigned char g_key_word_asso[26] = {
+	KW_ASSO('a'), KW_ASSO('b'), KW_ASSO('c'), KW_ASSO('d'), KW_ASSO('e'),
+	KW_ASSO('f'), KW_ASSO('g'), KW_ASSO('h'), KW_ASSO('i'), KW_ASSO('j'),
+	KW_ASSO('k'), KW_ASSO('l'), KW_ASSO('m'), KW_ASSO('n'), KW_ASSO('o'),
+	KW_ASSO('p'), KW_ASSO('q'), KW_ASSO('r'), KW_ASSO('s'), KW_ASSO('t'),
+	KW_ASSO('u'), KW_ASSO('v'), KW_ASSO('w'), KW_ASSO('x'), KW_ASSO('y'),
+	KW_ASSO('z'),
+};
 
-int token_delete(struct token *this)
-{
-	free((void *)this->cooked);
-	free(this);
-	return ERR_SUCCESS;
-}
+/* type - TOKEN_IDENTIFIER; 0 marks an empty slot. */
+static const
+unsigned char g_key_word_hash[KW_HASH_SIZE] = {
+	[KW_HASH(2, 'a', 's', 's')] = TOKEN_AS - TOKEN_IDENTIFIER,
+	[KW_HASH(5, 'a', 's', 'c')] = TOKEN_ASYNC - TOKEN_IDENTIFIER,
+	[KW_HASH(5, 'a', 'w', 't')] = TOKEN_AWAIT - TOKEN_IDENTIFIER,
+	[KW_HASH(5, 'b', 'r', 'k')] = TOKEN_BREAK - TOKEN_IDENTIFIER,
+	[KW_HASH(4, 'c', 'a', 'e')] = TOKEN_CASE - TOKEN_IDENTIFIER,
+	[KW_HASH(5, 'c', 'a', 'h')] = TOKEN_CATCH - TOKEN_IDENTIFIER,
+	[KW_HASH(5, 'c', 'l', 's')] = TOKEN_CLASS - TOKEN_IDENTIFIER,
+	[KW_HASH(5, 'c', 'o', 't')] = TOKEN_CONST - TOKEN_IDENTIFIER,
+	[KW_HASH(8, 'c', 'o', 'e')] = TOKEN_CONTINUE - TOKEN_IDENTIFIER,
+	[KW_HASH(8, 'd', 'e', 'r')] = TOKEN_DEBUGGER - TOKEN_IDENTIFIER,
+	[KW_HASH(7, 'd', 'e', 't')] = TOKEN_DEFAULT - TOKEN_IDENTIFIER,
+	[KW_HASH(6, 'd', 'e', 'e')] = TOKEN_DELETE - TOKEN_IDENTIFIER,
+	[KW_HASH(2, 'd', 'o', 'o')] = TOKEN_DO - TOKEN_IDENTIFIER,
+	[KW_HASH(4, 'e', 'l', 'e')] = TOKEN_ELSE - TOKEN_IDENTIFIER,
+	[KW_HASH(4, 'e', 'n', 'm')] = TOKEN_ENUM - TOKEN_IDENTIFIER,
+	[KW_HASH(6, 'e', 'x', 't')] = TOKEN_EXPORT - TOKEN_IDENTIFIER,
+	[KW_HASH(7, 'e', 'x', 's')] = TOKEN_EXTENDS - TOKEN_IDENTIFIER,
+	[KW_HASH(5, 'f', 'a', 'e')] = TOKEN_FALSE - TOKEN_IDENTIFIER,
+	[KW_HASH(7, 'f', 'i', 'y')] = TOKEN_FINALLY - TOKEN_IDENTIFIER,
+	[KW_HASH(3, 'f', 'o', 'r')] = TOKEN_FOR - TOKEN_IDENTIFIER,
+	[KW_HASH(4, 'f', 'r', 'm')] = TOKEN_FROM - TOKEN_IDENTIFIER,
+	[KW_HASH(8, 'f', 'u', 'n')] = TOKEN_FUNCTION - TOKEN_IDENTIFIER,
+	[KW_HASH(3, 'g', 'e', 't')] = TOKEN_GET - TOKEN_IDENTIFIER,
+	[KW_HASH(2, 'i', 'f', 'f')] = TOKEN_IF - TOKEN_IDENTIFIER,
+	[KW_HASH(10, 'i', 'm', 's')] = TOKEN_IMPLEMENTS - TOKEN_IDENTIFIER,
+	[KW_HASH(6, 'i', 'm', 't')] = TOKEN_IMPORT - TOKEN_IDENTIFIER,
+	[KW_HASH(2, 'i', 'n', 'n')] = TOKEN_IN - TOKEN_IDENTIFIER,
+	[KW_HASH(10, 'i', 'n', 'f')] = TOKEN_INSTANCEOF - TOKEN_IDENTIFIER,
+	[KW_HASH(9, 'i', 'n', 'e')] = TOKEN_INTERFACE - TOKEN_IDENTIFIER,
+	[KW_HASH(3, 'l', 'e', 't')] = TOKEN_LET - TOKEN_IDENTIFIER,
+	[KW_HASH(4, 'm', 'e', 'a')] = TOKEN_META - TOKEN_IDENTIFIER,
+	[KW_HASH(3, 'n', 'e', 'w')] = TOKEN_NEW - TOKEN_IDENTIFIER,
+	[KW_HASH(4, 'n', 'u', 'l')] = TOKEN_NULL - TOKEN_IDENTIFIER,
+	[KW_HASH(2, 'o', 'f', 'f')] = TOKEN_OF - TOKEN_IDENTIFIER,
+	[KW_HASH(7, 'p', 'a', 'e')] = TOKEN_PACKAGE - TOKEN_IDENTIFIER,
+	[KW_HASH(7, 'p', 'r', 'e')] = TOKEN_PRIVATE - TOKEN_IDENTIFIER,
+	[KW_HASH(9, 'p', 'r', 'd')] = TOKEN_PROTECTED - TOKEN_IDENTIFIER,
+	[KW_HASH(6, 'p', 'u', 'c')] = TOKEN_PUBLIC - TOKEN_IDENTIFIER,
+	[KW_HASH(6, 'r', 'e', 'n')] = TOKEN_RETURN - TOKEN_IDENTIFIER,
+	[KW_HASH(3, 's', 'e', 't')] = TOKEN_SET - TOKEN_IDENTIFIER,
+	[KW_HASH(6, 's', 't', 'c')] = TOKEN_STATIC - TOKEN_IDENTIFIER,
+	[KW_HASH(5, 's', 'u', 'r')] = TOKEN_SUPER - TOKEN_IDENTIFIER,
+	[KW_HASH(6, 's', 'w', 'h')] = TOKEN_SWITCH - TOKEN_IDENTIFIER,
+	[KW_HASH(6, 't', 'a', 't')] = TOKEN_TARGET - TOKEN_IDENTIFIER,
+	[KW_HASH(4, 't', 'h', 's')] = TOKEN_THIS - TOKEN_IDENTIFIER,
+	[KW_HASH(5, 't', 'h', 'w')] = TOKEN_THROW - TOKEN_IDENTIFIER,
+	[KW_HASH(4, 't', 'r', 'e')] = TOKEN_TRUE - TOKEN_IDENTIFIER,
+	[KW_HASH(3, 't', 'r', 'y')] = TOKEN_TRY - TOKEN_IDENTIFIER,
+	[KW_HASH(6, 't', 'y', 'f')] = TOKEN_TYPEOF - TOKEN_IDENTIFIER,
+	[KW_HASH(3, 'v', 'a', 'r')] = TOKEN_VAR - TOKEN_IDENTIFIER,
+	[KW_HASH(4, 'v', 'o', 'd')] = TOKEN_VOID - TOKEN_IDENTIFIER,
+	[KW_HASH(5, 'w', 'h', 'e')] = TOKEN_WHILE - TOKEN_IDENTIFIER,
+	[KW_HASH(4, 'w', 'i', 'h')] = TOKEN_WITH - TOKEN_IDENTIFIER,
+	[KW_HASH(5, 'y', 'i', 'd')] = TOKEN_YIELD - TOKEN_IDENTIFIER,
+};
+
+static_assert(ARRAY_SIZE(g_key_words) == TOKEN_YIELD - TOKEN_IDENTIFIER,
+			  "g_key_words must match enum token_type");
+
+/*
+ * The punctuators, as a DFA. The first unit picks the start state from
+ * g_punct_start; each of the (at most 3) units after it moves the DFA through
+ * g_punct_next, after being mapped to one of the few classes of units that
+ * can follow the first. The states are the token types; TOKEN_INVALID is the
+ * dead state.
+ */
+enum punct_class {
+	PC_NONE,
+	PC_EQUALS,
+	PC_GREATER,
+	PC_LESS,
+	PC_AND,
+	PC_OR,
+	PC_PLUS,
+	PC_MINUS,
+	PC_MUL,
+	PC_QUESTION,
+	PC_DOT,
+	PC_NUM_CLASSES,
+};
+
+static const
+unsigned char g_punct_class[128] = {
+	['='] = PC_EQUALS,
+	['>'] = PC_GREATER,
+	['<'] = PC_LESS,
+	['&'] = PC_AND,
+	['|'] = PC_OR,
+	['+'] = PC_PLUS,
+	['-'] = PC_MINUS,
+	['*'] = PC_MUL,
+	['?'] = PC_QUESTION,
+	['.'] = PC_DOT,
+};
+
+static const
+unsigned char g_punct_start[128] = {
+	['('] = TOKEN_LEFT_PAREN,
+	[')'] = TOKEN_RIGHT_PAREN,
+	['{'] = TOKEN_LEFT_BRACE,
+	['}'] = TOKEN_RIGHT_BRACE,
+	['['] = TOKEN_LEFT_BRACKET,
+	[']'] = TOKEN_RIGHT_BRACKET,
+	['#'] = TOKEN_NUMBER_SIGN,
+	[':'] = TOKEN_COLON,
+	[';'] = TOKEN_SEMI_COLON,
+	[','] = TOKEN_COMMA,
+	['~'] = TOKEN_BITWISE_NOT,
+	['.'] = TOKEN_DOT,
+	['?'] = TOKEN_QUESTION,
+	['='] = TOKEN_EQUALS,
+	['!'] = TOKEN_LOGICAL_NOT,
+	['<'] = TOKEN_LESS_THAN,
+	['>'] = TOKEN_GREATER_THAN,
+	['+'] = TOKEN_PLUS,
+	['-'] = TOKEN_MINUS,
+	['*'] = TOKEN_MUL,
+	['/'] = TOKEN_DIV,
+	['%'] = TOKEN_MOD,
+	['&'] = TOKEN_BITWISE_AND,
+	['|'] = TOKEN_BITWISE_OR,
+	['^'] = TOKEN_BITWISE_XOR,
+};
+
+static const
+unsigned char g_punct_next[TOKEN_IDENTIFIER][PC_NUM_CLASSES] = {
+	[TOKEN_DOT]			= {[PC_DOT] = TOKEN_DOT_DOT},
+	[TOKEN_DOT_DOT]		= {[PC_DOT] = TOKEN_ELLIPSIS},
+	[TOKEN_QUESTION]	= {[PC_DOT] = TOKEN_QUESTION_DOT,
+						   [PC_QUESTION] = TOKEN_COALESCE},
+	[TOKEN_COALESCE]	= {[PC_EQUALS] = TOKEN_COALESCE_EQUALS},
+	[TOKEN_EQUALS]		= {[PC_EQUALS] = TOKEN_DOUBLE_EQUALS,
+						   [PC_GREATER] = TOKEN_ARROW},
+	[TOKEN_DOUBLE_EQUALS]	= {[PC_EQUALS] = TOKEN_TRIPLE_EQUALS},
+	[TOKEN_LOGICAL_NOT]	= {[PC_EQUALS] = TOKEN_NOT_EQUALS},
+	[TOKEN_NOT_EQUALS]	= {[PC_EQUALS] = TOKEN_NOT_DOUBLE_EQUALS},
+	[TOKEN_LESS_THAN]	= {[PC_EQUALS] = TOKEN_LESS_EQUALS,
+						   [PC_LESS] = TOKEN_SHL},
+	[TOKEN_SHL]			= {[PC_EQUALS] = TOKEN_SHL_EQUALS},
+	[TOKEN_GREATER_THAN]	= {[PC_EQUALS] = TOKEN_GREATER_EQUALS,
+							   [PC_GREATER] = TOKEN_SAR},
+	[TOKEN_SAR]			= {[PC_EQUALS] = TOKEN_SAR_EQUALS,
+						   [PC_GREATER] = TOKEN_SHR},
+	[TOKEN_SHR]			= {[PC_EQUALS] = TOKEN_SHR_EQUALS},
+	[TOKEN_PLUS]		= {[PC_EQUALS] = TOKEN_PLUS_EQUALS,
+						   [PC_PLUS] = TOKEN_INC},
+	[TOKEN_MINUS]		= {[PC_EQUALS] = TOKEN_MINUS_EQUALS,
+						   [PC_MINUS] = TOKEN_DEC},
+	[TOKEN_MUL]			= {[PC_EQUALS] = TOKEN_MUL_EQUALS,
+						   [PC_MUL] = TOKEN_EXP},
+	[TOKEN_EXP]			= {[PC_EQUALS] = TOKEN_EXP_EQUALS},
+	[TOKEN_DIV]			= {[PC_EQUALS] = TOKEN_DIV_EQUALS},
+	[TOKEN_MOD]			= {[PC_EQUALS] = TOKEN_MOD_EQUALS},
+	[TOKEN_BITWISE_AND]	= {[PC_EQUALS] = TOKEN_BITWISE_AND_EQUALS,
+						   [PC_AND] = TOKEN_LOGICAL_AND},
+	[TOKEN_LOGICAL_AND]	= {[PC_EQUALS] = TOKEN_LOGICAL_AND_EQUALS},
+	[TOKEN_BITWISE_OR]	= {[PC_EQUALS] = TOKEN_BITWISE_OR_EQUALS,
+						   [PC_OR] = TOKEN_LOGICAL_OR},
+	[TOKEN_LOGICAL_OR]	= {[PC_EQUALS] = TOKEN_LOGICAL_OR_EQUALS},
+	[TOKEN_BITWISE_XOR]	= {[PC_EQUALS] = TOKEN_BITWISE_XOR_EQUALS},
+};
+
+static_assert(TOKEN_IDENTIFIER <= UCHAR_MAX,
+			  "The punctuator types must fit in g_punct_next");
 /*******************************************************************/
-int scanner_new(const char16_t *src,
+/*******************************************************************/
+int scanner_new(const void *src,
 				size_t src_len,
+				size_t src_unit_size,
 				struct scanner **out)
 {
 	int err;
 	struct scanner *scanner;
 
+	err = ERR_INVALID_PARAMETER;
+	if (src_unit_size != 1 && src_unit_size != sizeof(char16_t))
+		goto err0;
+
 	err = ERR_NO_MEMORY;
 	scanner = calloc(1, sizeof(*scanner));
 	if (scanner == NULL)
 		goto err0;
 
-	err = ERR_SUCCESS;
+	err = atom_table_new(&scanner->atoms);
+	if (err)
+		goto err1;
+
+	err = arena_new(TOKEN_SLAB_SIZE, &scanner->tokens);
+	if (err)
+		goto err2;
+
 	scanner->src = src;
 	scanner->src_len = src_len;
+	scanner->src_unit_size = src_unit_size;
+	units_get_ops(src_unit_size, &scanner->ops);
+	*out = scanner;
+	return ERR_SUCCESS;
+err2:
+	atom_table_delete(scanner->atoms);
+err1:
+	free(scanner);
+err0:
+	return err;
+}
+
+int scanner_new_stream(int fd,
+					   struct scanner **out)
+{
+	int err;
+	struct scanner *scanner;
+
+	err = ERR_NO_MEMORY;
+	scanner = calloc(1, sizeof(*scanner));
+	if (scanner == NULL)
+		goto err0;
+
+	scanner->window_size = STREAM_CHUNK_SIZE;
+	scanner->window = malloc(scanner->window_size * sizeof(char16_t));
+	if (scanner->window == NULL)
+		goto err1;
+
+	err = stream_new(fd, &scanner->stream);
+	if (err)
+		goto err2;
+
+	err = atom_table_new(&scanner->atoms);
+	if (err)
+		goto err3;
+
+	err = arena_new(TOKEN_SLAB_SIZE, &scanner->tokens);
+	if (err)
+		goto err4;
+
+	/* The units are dropped as the scanner moves on; index them as read. */
+	err = line_index_new(sizeof(char16_t), &scanner->lines);
+	if (err)
+		goto err5;
+
+	scanner->src = scanner->window;
+	scanner->src_unit_size = sizeof(char16_t);
+	units_get_ops(scanner->src_unit_size, &scanner->ops);
 	*out = scanner;
+	return ERR_SUCCESS;
+err5:
+	arena_delete(scanner->tokens);
+err4:
+	atom_table_delete(scanner->atoms);
+err3:
+	stream_delete(scanner->stream);
+err2:
+	free(scanner->window);
+err1:
+	free(scanner);
 err0:
 	return err;
 }
 
+/* A resident src is owned by the caller. The tokens are freed here. */
 int scanner_delete(struct scanner *this)
 {
-	free((void *)this->src);
+	if (this->stream)
+		stream_delete(this->stream);
+	if (this->lines)
+		line_index_delete(this->lines);
+	arena_delete(this->tokens);
+	atom_table_delete(this->atoms);
+	free(this->cooked.units);
+	free(this->lazy_cooked.units);
+	free(this->numbers.values);
+	free(this->window);
 	free(this);
 	return ERR_SUCCESS;
 }
+
+/*
+ * A resident src is indexed in one pass, on the first call. A stream is
+ * indexed as it is read.
+ */
+int scanner_locate(struct scanner *this,
+				   size_t pos,
+				   size_t *row,
+				   size_t *col)
+{
+	int err;
+
+	if (pos > this->src_len)
+		return ERR_INVALID_PARAMETER;
+
+	if (this->lines == NULL) {
+		err = line_index_new(this->src_unit_size, &this->lines);
+		if (err)
+			return err;
+		err = line_index_add(this->lines, this->src, this->src_len);
+		if (err) {
+			line_index_delete(this->lines);
+			this->lines = NULL;
+			return err;
+		}
+	}
+	line_index_find(this->lines, pos, row, col);
+	return ERR_SUCCESS;
+}
 /*******************************************************************/
 static inline
 int scanner_build_token(struct scanner *this,
 						enum token_type type,
 						size_t flags,
+						uint32_t value,	/* An atom, or a number */
 						struct token **out)
 {
-	size_t raw_len;
+	struct token *token;
+
+	/* Token positions are 32-bit. */
+	if (this->curr_pos > UINT32_MAX)
+		return ERR_UNSUPPORTED;
+
+	token = arena_alloc(this->tokens, sizeof(*token), _Alignof(struct token));
+	if (token == NULL)
+		return ERR_NO_MEMORY;
 
 	if (this->prev_token_type == TOKEN_NEW_LINE)
 		flags |= bits_on(TF_NL_PFX);
-	raw_len = this->curr_locn.scan_pos - this->save_locn.scan_pos;
-	return token_new(type, &this->save_locn, raw_len, flags, out);
+	token->scan_pos = this->save_pos;
+	token->raw_len = this->curr_pos - this->save_pos;
+	token->type = type;
+	token->flags = flags;
+	token->atom = value;
+	*out = token;
+	return ERR_SUCCESS;
 }
 /*******************************************************************/
+/*
+ * Drop the units behind the current position, except for those of the token
+ * being scanned, which is interned once complete. Then, append the next
+ * chunk, and record its line starts.
+ */
+static
+int scanner_read_chunk(struct scanner *this)
+{
+	int err;
+	size_t keep, num_kept, len, size;
+	char16_t *window;
+
+	keep = this->curr_pos;
+	if (this->is_in_token && this->save_pos < keep)
+		keep = this->save_pos;
+	if (this->has_pin && this->pin_pos < keep)
+		keep = this->pin_pos;
+	assert(keep >= this->src_base && keep <= this->src_len);
+	num_kept = this->src_len - keep;
+
+	size = num_kept + STREAM_CHUNK_SIZE;
+	if (size > this->window_size) {
+		window = realloc(this->window, size * sizeof(char16_t));
+		if (window == NULL)
+			return ERR_NO_MEMORY;
+		this->window = window;
+		this->window_size = size;
+	}
+
+	window = this->window;
+	memmove(window, &window[keep - this->src_base],
+			num_kept * sizeof(char16_t));
+	this->src = window;
+	this->src_base = keep;
+
+	err = stream_read(this->stream, &window[num_kept], &len);
+	if (err)
+		return err;
+	err = line_index_add(this->lines, &window[num_kept], len);
+	if (!err)
+		this->src_len += len;
+	return err;
+}
+
+/* Make the unit at pos available, reading from the stream if needed. */
 static
-bool scanner_is_end(const struct scanner *this,
-					size_t pos)
+int scanner_fill(struct scanner *this,
+				 size_t pos)
 {
-	return pos >= this->src_len;
+	int err;
+
+	while (pos >= this->src_len) {
+		if (this->stream == NULL)
+			return ERR_END_OF_FILE;
+		err = scanner_read_chunk(this);
+		if (err)
+			return err;
+	}
+	return ERR_SUCCESS;
 }
 
 static
-int scanner_peek(const struct scanner *this,
+int scanner_peek(struct scanner *this,
 				 size_t offset,
 				 char16_t *out)
 {
+	int err;
 	size_t pos, scan_pos;
 
-	scan_pos = this->curr_locn.scan_pos;
+	scan_pos = this->curr_pos;
 	pos = scan_pos + offset;
-	if (pos < scan_pos || scanner_is_end(this, pos))
+	if (pos < scan_pos)
 		return ERR_END_OF_FILE;
-	*out = this->src[pos];
+	err = scanner_fill(this, pos);
+	if (err)
+		return err;
+	*out = scanner_unit(this, pos);
 	return ERR_SUCCESS;
 }
 
-/* For surr. pairs, file_col is incremented only once per pair */
-static
+/* The units must have been peeked at. */
+static inline
 void scanner_consume(struct scanner *this,
 					 size_t num_units)
 {
-	size_t i;
-	char16_t cu;
-	struct token_location *locn;
-
-	locn = &this->curr_locn;
-	for (i = 0; i < num_units; ++i) {
-		if (scanner_is_end(this, locn->scan_pos))
-			break;
-
-		cu = this->src[locn->scan_pos++];
-		if (is_low_surrogate(cu) && locn->scan_pos >= 2 &&
-			is_high_surrogate(this->src[locn->scan_pos - 2]))
-			continue;
-		++locn->file_col;
-
-		/* \r and \r\n => \n */
-		if (cu == '\r') {
-			if (!scanner_peek(this, 0, &cu) && cu == '\n')
-				++locn->scan_pos;
-			cu = '\n';
-		}
-
-		if (cu == '\n') {
-			++locn->file_row;
-			locn->file_col = 0;
-		}
-	}
+	this->curr_pos += num_units;
+	assert(this->curr_pos <= this->src_len);
 }
 /*******************************************************************/
+/*
+ * The units from curr_pos up to the end of those in memory, reading the next
+ * chunk of a stream if there are none. Fails at the end of the src.
+ */
 static
-void scanner_skip_single_line_comment(struct scanner *this)
+int scanner_units(struct scanner *this,
+				  const void **units,
+				  size_t *len)
 {
 	int err;
-	char16_t cu;
+
+	err = scanner_fill(this, this->curr_pos);
+	if (err)
+		return err;
+	*units = (const char *)this->src +
+		(this->curr_pos - this->src_base) * this->src_unit_size;
+	*len = this->src_len - this->curr_pos;
+	return ERR_SUCCESS;
+}
+
+/* The comment ends before the line terminator, which is not consumed. */
+static
+void scanner_skip_single_line_comment(struct scanner *this)
+{
+	size_t n, len;
+	const void *units;
 
 	scanner_consume(this, 2);	/* Consume // or #! */
 
-	while (true) {
-		err = scanner_peek(this, 0, &cu);
-		if (err || is_line_terminator(cu))
+	while (!scanner_units(this, &units, &len)) {
+		n = this->ops.find_line_term(units, len);
+		scanner_consume(this, n);
+		if (n < len)
 			break;
-		scanner_consume(this, 1);
 	}
 }
 
 static
 bool scanner_skip_multi_line_comment(struct scanner *this)
 {
-	int err;
+	size_t n, len;
 	char16_t cu;
 	bool has_new_line;
-	bool half_close_seen;
+	const void *units;
 
-	has_new_line = half_close_seen = false;
+	has_new_line = false;
 
 	scanner_consume(this, 2);	/* Consume slash-star */
 
-	while (true) {
-		err = scanner_peek(this, 0, &cu);
-		if (err)
-			break;
+	while (!scanner_units(this, &units, &len)) {
+		n = this->ops.find_star_or_line_term(units, len);
+		scanner_consume(this, n);
+		if (n == len)
+			continue;
+
+		cu = scanner_unit(this, this->curr_pos);
 		scanner_consume(this, 1);
-		if (is_line_terminator(cu)) {
+		if (cu != '*') {
 			has_new_line = true;
-			half_close_seen = false;
-		} else if (cu == '*') {
-			half_close_seen = true;
-		} else if (cu == '/' && half_close_seen) {
+			continue;
+		}
+
+		if (!scanner_peek(this, 0, &cu) && cu == '/') {
+			scanner_consume(this, 1);
 			break;
-		} else {
-			half_close_seen = false;
 		}
 	}
 	return has_new_line;
@@ -248,15 +605,24 @@ bool scanner_skip_multi_line_comment(struct scanner *this)
 static
 bool scanner_skip_white_space(struct scanner *this)
 {
+	size_t n, len;
 	char16_t cu, t;
 	bool has_new_line;
+	const void *units;
 
 	has_new_line = false;
 
 	while (true) {
-		if (scanner_peek(this, 0, &cu))
+		if (scanner_units(this, &units, &len))
 			break;
 
+		/* Runs of ASCII white-space (+ line-terminators) */
+		n = this->ops.span_white_space(units, len, &has_new_line);
+		scanner_consume(this, n);
+		if (n == len)
+			continue;
+		cu = scanner_unit(this, this->curr_pos);
+
 		/*
 		 * All white-space (+ line-terminators) are within the plane-0.
 		 * i.e. they are not encoded within the src using surrogate pairs.
@@ -274,197 +640,1188 @@ bool scanner_skip_white_space(struct scanner *this)
 			break;
 
 		/* #! must be at scan_pos == 0 */
-		if (cu == '#' && this->curr_locn.scan_pos)
+		if (cu == '#' && this->curr_pos)
 			break;
 
 		if (scanner_peek(this, 1, &t))
 			break;
 
-		if (cu == '#') {
-			cu = t;
-			if (cu == '!')
-				scanner_skip_single_line_comment(this);
-			else
-				break;
-		} else {
-			cu = t;
-			if (cu == '/')
-				scanner_skip_single_line_comment(this);
-			else if (cu == '*' && scanner_skip_multi_line_comment(this))
-				has_new_line = true;
-			else
-				break;
-		}
+		if (cu == '#' && t == '!')
+			scanner_skip_single_line_comment(this);
+		else if (cu == '/' && t == '/')
+			scanner_skip_single_line_comment(this);
+		else if (cu == '/' && t == '*')
+			has_new_line |= scanner_skip_multi_line_comment(this);
+		else
+			break;
 	}
 	return has_new_line;
 }
 /*******************************************************************/
-int scanner_scan_string(struct scanner *this,
-						struct token **out)
+static
+int cooked_buf_reserve(struct cooked_buf *this,
+					   size_t num_units)
 {
-	int err;
-	enum token_type type;
-	struct token *token;
-	size_t i, cooked_len, flags;
-	char16_t cu, *cooked;
-	bool is_double_quoted;
-	static char16_t str[32];
-
-	err = scanner_peek(this, 0, &cu);
-	if (err)
-		return err;
-	scanner_consume(this, 1);
-	is_double_quoted = cu == '\"';
-
-	cooked_len = i = flags = 0;
-	cooked = NULL;
-	while (true) {
-		err = scanner_peek(this, 0, &cu);
-		/* Can't have an error parsing a string. */
-		if (err)
-			break;
-		scanner_consume(this, 1);
+	size_t size;
+	char16_t *units;
 
-		if (is_double_quoted && cu == '\"')
-			break;
-		if (!is_double_quoted && cu == '\'')
-			break;
+	if (this->len + num_units <= this->size)
+		return ERR_SUCCESS;
 
-		/* Can't have unescaped LF, CR in a string. */
-		err = ERR_INVALID_TOKEN;
-		if (cu == '\r' || cu == '\n')
-			break;
+	size = this->size ? this->size : 32;
+	while (size < this->len + num_units)
+		size <<= 1;
+	units = realloc(this->units, size * sizeof(char16_t));
+	if (units == NULL)
+		return ERR_NO_MEMORY;
+	this->units = units;
+	this->size = size;
+	return ERR_SUCCESS;
+}
 
-		/* Not an escape, so append */
-		if (cu != '\\')
-			goto append;
+/* Append the src units [from, to). */
+static
+int cooked_buf_append_src(struct cooked_buf *this,
+						  const struct scanner *scanner,
+						  size_t from,
+						  size_t to)
+{
+	int err;
 
-		/* Read the char after \ */
-		err = scanner_peek(this, 0, &cu);
-		if (err)
-			break;
-		scanner_consume(this, 1);
+	err = cooked_buf_reserve(this, to - from);
+	if (err)
+		return err;
+	for (; from < to; ++from)
+		this->units[this->len++] = scanner_unit(scanner, from);
+	return ERR_SUCCESS;
+}
 
-		/* LineTerminatorSequence. Ignore the line-terminator. */
-		if (is_line_terminator(cu))
-			continue;
+/* As a surr. pair, if beyond the plane-0 */
+static
+int cooked_buf_append_code_point(struct cooked_buf *this,
+								 char32_t cp)
+{
+	int err;
 
-		/* SingleEscapeCharacter */
-		if (cu == '\'' || cu == '\"' || cu == '\\') {
-			goto append;
-		} else if (cu == 'b') {
-			cu = '\b';
-			goto append;
-		} else if (cu == 'f') {
-			cu = '\f';
-			goto append;
-		} else if (cu == 'n') {
-			cu = '\n';
-			goto append;
-		} else if (cu == 'r') {
-			cu = '\r';
-			goto append;
-		} else if (cu == 't') {
-			cu = '\t';
-			goto append;
-		} else if (cu == 'v') {
-			cu = '\v';
-			goto append;
-		}
+	err = cooked_buf_reserve(this, 2);
+	if (!err)
+		err = encode_code_point(cp, &this->units[this->len]);
+	if (!err)
+		this->len += is_astral(cp) ? 2 : 1;
+	return err;
+}
 
-		/* TODO: handle x, u, dec_digit and NonEscChar */
-		/* Set flags */
-		flags |= bits_on(TF_UNC_SEQ);	/* For u */
-		flags |= bits_on(TF_HEX_SEQ);	/* For x */
-		printf("%s: TODO %c\n", __func__, cu);
-		exit(0);
-	append:
-		if (i == 32) {
-			cooked = realloc(cooked, (cooked_len + i) * sizeof(char16_t));
-			if (cooked == NULL)
-				return ERR_NO_MEMORY;
-			memcpy(&cooked[cooked_len], str, i * sizeof(char16_t));
-			cooked_len += i;
-			i = 0;
-		}
-		str[i++] = cu;
-	}
+/* Intern the src units [pos, pos + len). */
+static
+int scanner_intern_slice(struct scanner *this,
+						 size_t pos,
+						 size_t len,
+						 uint32_t *out)
+{
+	const char *units;
 
-	if (err) {
-		free(cooked);
-		return err;
-	}
+	units = (const char *)this->src + (pos - this->src_base) *
+		this->src_unit_size;
+	return atom_table_intern(this->atoms, units, len, this->src_unit_size,
+							 out);
+}
 
-	if (i) {
-		cooked = realloc(cooked, (cooked_len + i) * sizeof(char16_t));
-		if (cooked == NULL)
-			return ERR_NO_MEMORY;
-		memcpy(&cooked[cooked_len], str, i * sizeof(char16_t));
-		cooked_len += i;
-	}
+/* Exactly num_digits hex digits */
+static
+int scanner_scan_hex_digits(struct scanner *this,
+							size_t num_digits,
+							char32_t *out)
+{
+	size_t i;
+	char16_t cu;
+	char32_t value;
 
-	type = TOKEN_STRING;
-	err = scanner_build_token(this, type, flags, &token);
-	if (!err) {
-		token_set_cooked(token, cooked, cooked_len);
-		*out = token;
+	value = 0;
+	for (i = 0; i < num_digits; ++i) {
+		if (scanner_peek(this, 0, &cu) || !is_hex_digit(cu))
+			return ERR_INVALID_TOKEN;
+		scanner_consume(this, 1);
+		value = value << 4 | hex_digit_value(cu);
 	}
-	return err;
+	*out = value;
+	return ERR_SUCCESS;
 }
 
+/* The part after \u; i.e. XXXX or {X...} */
 static
-int scanner_scan_equals(struct scanner *this,
-						struct token **out)
+int scanner_scan_unicode_escape(struct scanner *this,
+								char32_t *out)
 {
-	enum token_type type;
+	size_t i;
 	char16_t cu;
+	char32_t value;
 
-	/* =, ==, ===, => */
-
-	/* At least TOKEN_EQUALS is present. */
-	type = TOKEN_EQUALS;
+	if (scanner_peek(this, 0, &cu))
+		return ERR_INVALID_TOKEN;
+	if (cu != '{')
+		return scanner_scan_hex_digits(this, 4, out);
 	scanner_consume(this, 1);
 
-	while (true) {
+	value = 0;
+	for (i = 0; ; ++i) {
 		if (scanner_peek(this, 0, &cu))
-			break;
-
-		if (type == TOKEN_EQUALS && cu == '=')
-			type = TOKEN_DOUBLE_EQUALS;
-		else if (type == TOKEN_EQUALS && cu == '>')
-			type = TOKEN_ARROW;
-		else if (type == TOKEN_DOUBLE_EQUALS && cu == '=')
-			type = TOKEN_TRIPLE_EQUALS;
-		else
-			break;
-
+			return ERR_INVALID_TOKEN;
 		scanner_consume(this, 1);
-		if (type != TOKEN_DOUBLE_EQUALS)
+		if (cu == '}')
 			break;
+		if (!is_hex_digit(cu))
+			return ERR_INVALID_TOKEN;
+		value = value << 4 | hex_digit_value(cu);
+		if (value > 0x10ffff)
+			return ERR_INVALID_TOKEN;
 	}
-	return scanner_build_token(this, type, 0, out);
+	if (i == 0)
+		return ERR_INVALID_TOKEN;
+	*out = value;
+	return ERR_SUCCESS;
 }
-/*******************************************************************/
+
 /*
- * Identifiers can contain \uxxxx or \u{} esc. seqs.
- * They cannot contain \x.. hex esc seqs.
- * They cannot contain surr pairs.
+ * The part after \0..\7, the first digit of which is already consumed.
+ * \0..\3 take up to 2 more octal digits, \4..\7 up to 1 more.
  */
 static
-int scanner_scan_identifier(struct scanner *this,
-							struct token **out)
+char32_t scanner_scan_legacy_octal_escape(struct scanner *this,
+										  char16_t first)
 {
-	int err;
-	size_t i, j, flags;
-	size_t cooked_len;
-	char16_t cu, *cooked;
+	size_t i, num_digits;
+	char16_t cu;
+	char32_t value;
+
+	value = first - '0';
+	num_digits = first <= '3' ? 3 : 2;
+	for (i = 1; i < num_digits; ++i) {
+		if (scanner_peek(this, 0, &cu) || cu < '0' || cu > '7')
+			break;
+		scanner_consume(this, 1);
+		value = value << 3 | (cu - '0');
+	}
+	return value;
+}
+
+/*
+ * The part after \, other than a LineTerminatorSequence. Cooks it into a
+ * code point.
+ */
+static
+int scanner_scan_escape(struct scanner *this,
+						char16_t cu,
+						size_t *flags,
+						char32_t *out)
+{
+	char16_t t;
+
+	switch (cu) {
+	case 'b':	*out = '\b';	return ERR_SUCCESS;
+	case 'f':	*out = '\f';	return ERR_SUCCESS;
+	case 'n':	*out = '\n';	return ERR_SUCCESS;
+	case 'r':	*out = '\r';	return ERR_SUCCESS;
+	case 't':	*out = '\t';	return ERR_SUCCESS;
+	case 'v':	*out = '\v';	return ERR_SUCCESS;
+	case 'x':
+		*flags |= bits_on(TF_HEX_SEQ);
+		return scanner_scan_hex_digits(this, 2, out);
+	case 'u':
+		*flags |= bits_on(TF_UNC_SEQ);
+		return scanner_scan_unicode_escape(this, out);
+	case '8':
+	case '9':
+		/* NonOctalDecimalEscapeSequence */
+		*flags |= bits_on(TF_OCT_SEQ);
+		*out = cu;
+		return ERR_SUCCESS;
+	default:
+		break;
+	}
+
+	if (cu < '0' || cu > '7') {
+		*out = cu;	/* SingleEscapeCharacter ' " \, or NonEscapeCharacter */
+		return ERR_SUCCESS;
+	}
+
+	/* \0 [lookahead ∉ DecimalDigit] */
+	if (cu == '0' && (scanner_peek(this, 0, &t) || !is_dec_digit(t))) {
+		*out = 0;
+		return ERR_SUCCESS;
+	}
+
+	*flags |= bits_on(TF_OCT_SEQ);
+	*out = scanner_scan_legacy_octal_escape(this, cu);
+	return ERR_SUCCESS;
+}
+
+/*
+ * The runs between the quotes, escapes and line terminators are found with
+ * find_string_stop. An escape-free string is interned straight from the src.
+ * Otherwise, the runs are bulk-copied into the cooked buffer, between the
+ * cooked escapes.
+ */
+int scanner_scan_string(struct scanner *this,
+						struct token **out)
+{
+	int err;
+	size_t n, len, run, end, flags;
+	char16_t quote, cu, t;
+	char32_t cp;
+	uint32_t atom;
+	const void *units;
+	struct cooked_buf *buf;
+
+	err = scanner_peek(this, 0, &quote);
+	if (err)
+		return err;
+	scanner_consume(this, 1);
+
+	/*
+	 * The units [run, end) are yet to be appended to buf. Until an escape is
+	 * seen, buf stays empty, and the cooked value is a slice of the src.
+	 */
+	buf = &this->cooked;
+	buf->len = 0;
+	flags = 0;
+	run = end = this->curr_pos;
+	while (true) {
+		/* Can't have an error parsing a string. */
+		err = scanner_units(this, &units, &len);
+		if (err)
+			break;
+		n = this->ops.find_string_stop(units, len);
+		scanner_consume(this, n);
+		if (n == len)
+			continue;
+
+		end = this->curr_pos;
+		cu = scanner_unit(this, end);
+		scanner_consume(this, 1);
+		if (cu == quote)
+			break;
+		if (cu == '\'' || cu == '\"')
+			continue;
+
+		/* Can't have unescaped LF, CR in a string. */
+		err = ERR_INVALID_TOKEN;
+		if (cu == '\r' || cu == '\n')
+			break;
+
+		/* An escape */
+		err = cooked_buf_append_src(buf, this, run, end);
+		if (err)
+			break;
+
+		/* Read the char after \ */
+		err = scanner_peek(this, 0, &cu);
+		if (err)
+			break;
+		scanner_consume(this, 1);
+
+		/* LineTerminatorSequence. Ignore the line-terminator. */
+		if (is_line_terminator(cu)) {
+			if (cu == '\r' && !scanner_peek(this, 0, &t) && t == '\n')
+				scanner_consume(this, 1);
+			run = this->curr_pos;
+			continue;
+		}
+
+		err = scanner_scan_escape(this, cu, &flags, &cp);
+		if (!err)
+			err = cooked_buf_append_code_point(buf, cp);
+		if (err)
+			break;
+		run = this->curr_pos;
+	}
+
+	if (err)
+		return err;
+
+	if (buf->len == 0) {
+		err = scanner_intern_slice(this, run, end - run, &atom);
+	} else {
+		err = cooked_buf_append_src(buf, this, run, end);
+		if (!err)
+			err = atom_table_intern(this->atoms, buf->units, buf->len,
+									sizeof(char16_t), &atom);
+	}
+	if (err)
+		return err;
+	return scanner_build_token(this, TOKEN_STRING, flags, atom, out);
+}
+/*******************************************************************/
+/* A stream drops the units as it is read; the raw ones are interned. */
+static
+int scanner_build_raw_token(struct scanner *this,
+							enum token_type type,
+							size_t flags,
+							struct token **out)
+{
+	int err;
+	uint32_t atom;
+
+	atom = ATOM_NONE;
+	if (this->stream) {
+		err = scanner_intern_slice(this, this->save_pos,
+								   this->curr_pos - this->save_pos, &atom);
+		if (err)
+			return err;
+	}
+	return scanner_build_token(this, type, flags, atom, out);
+}
+
+/*
+ * A template chunk, from its ` or } up to its ` or ${. The stops are found
+ * with find_template_stop. The escapes are checked, so that the parser can
+ * reject a bad one in an untagged template, but are not cooked. A
+ * NotEscapeSequence is skipped past its first unit; the rest of it is made of
+ * plain template characters.
+ */
+static
+int scanner_scan_template(struct scanner *this,
+						  char16_t first,
+						  struct token **out)
+{
+	int err;
+	size_t n, len, pos, flags, esc_flags;
+	char16_t cu, t;
+	char32_t cp;
+	const void *units;
 	enum token_type type;
-	struct token *token;
-	static char16_t name[32];
 
-	i = flags = 0;
-	cooked_len = 0;
-	cooked = NULL;
+	scanner_consume(this, 1);
+	flags = 0;
+	while (true) {
+		err = scanner_units(this, &units, &len);
+		if (err)
+			break;
+		n = this->ops.find_template_stop(units, len);
+		scanner_consume(this, n);
+		if (n == len)
+			continue;
+
+		cu = scanner_unit(this, this->curr_pos);
+		scanner_consume(this, 1);
+		if (cu == '`') {
+			type = first == '`' ? TOKEN_TEMPLATE : TOKEN_TEMPLATE_TAIL;
+			break;
+		}
+		if (cu == '$') {
+			if (scanner_peek(this, 0, &t) || t != '{')
+				continue;
+			scanner_consume(this, 1);
+			type = first == '`' ? TOKEN_TEMPLATE_HEAD : TOKEN_TEMPLATE_MIDDLE;
+			break;
+		}
+
+		/* An escape. A LineTerminatorSequence is a LineContinuation. */
+		err = scanner_peek(this, 0, &cu);
+		if (err)
+			break;
+		scanner_consume(this, 1);
+		if (is_line_terminator(cu))
+			continue;
+
+		pos = this->curr_pos;
+		esc_flags = 0;
+		err = scanner_scan_escape(this, cu, &esc_flags, &cp);
+		if (err || bits_get(esc_flags, TF_OCT_SEQ)) {
+			flags |= bits_on(TF_BAD_ESC);
+			this->curr_pos = pos;
+		}
+	}
+
+	if (err == ERR_END_OF_FILE)
+		err = ERR_UNEXPECTED_END_OF_FILE;
+	if (err)
+		return err;
+	return scanner_build_raw_token(this, type, flags, out);
+}
+
+/*
+ * A regexp, from its / up to the end of its flags. Only its extent is found
+ * here: the body ends at a / that is neither escaped, nor within a class.
+ */
+static
+int scanner_scan_reg_exp(struct scanner *this,
+						 struct token **out)
+{
+	int err;
+	bool is_in_class;
+	char16_t cu;
+
+	scanner_consume(this, 1);
+	is_in_class = false;
+	while (true) {
+		err = scanner_peek(this, 0, &cu);
+		if (err == ERR_END_OF_FILE)
+			return ERR_UNEXPECTED_END_OF_FILE;
+		if (err)
+			return err;
+		if (is_line_terminator(cu))
+			return ERR_INVALID_TOKEN;
+		scanner_consume(this, 1);
+
+		if (cu == '/' && !is_in_class)
+			break;
+		if (cu == '[') {
+			is_in_class = true;
+		} else if (cu == ']') {
+			is_in_class = false;
+		} else if (cu == '\\') {
+			if (scanner_peek(this, 0, &cu) || is_line_terminator(cu))
+				return ERR_INVALID_TOKEN;
+			scanner_consume(this, 1);
+		}
+	}
+
+	/* The flags are IdentifierPartChars, but can't be escaped. */
+	while (!scanner_peek(this, 0, &cu)) {
+		if (cu == '\\')
+			return ERR_INVALID_TOKEN;
+		if (!is_id_continue(cu))
+			break;
+		scanner_consume(this, 1);
+	}
+	return scanner_build_raw_token(this, TOKEN_REG_EXP, 0, out);
+}
+
+/*
+ * A resident view of the raw units of a regexp, or of a template chunk, at
+ * the positions they were scanned at. It lets the escape scanners, which read
+ * through scanner_peek, cook them long after the src has moved on.
+ */
+static
+void scanner_view_raw(const struct scanner *this,
+					  const struct token *token,
+					  struct scanner *out)
+{
+	size_t len;
+
+	memset(out, 0, sizeof(*out));
+	if (token_atom(token) == ATOM_NONE) {
+		out->src = this->src;
+		out->src_base = this->src_base;
+		out->src_unit_size = this->src_unit_size;
+	} else {
+		out->src = atom_table_get(this->atoms, token_atom(token), &len,
+								  &out->src_unit_size);
+		out->src_base = token->scan_pos;
+		assert(len == token->raw_len);
+	}
+	out->src_len = token->scan_pos + token->raw_len;
+	out->atoms = this->atoms;
+	out->curr_pos = token->scan_pos;
+}
+
+/*
+ * The TV, or the TRV if is_raw. A CR, or a CR LF, is an LF in both. The
+ * escapes are cooked, and the LineContinuations dropped, only in the TV. As
+ * with the strings, the units are interned straight from the src until there
+ * is something to cook.
+ */
+static
+int scanner_cook_template(struct scanner *this,
+						  const struct token *token,
+						  bool is_raw,
+						  uint32_t *out)
+{
+	int err;
+	size_t pos, end, run, flags;
+	char16_t cu, t;
+	char32_t cp;
+	struct scanner view;
+	struct cooked_buf *buf;
+	enum token_type type;
+
+	type = token_type(token);
+	if (type != TOKEN_TEMPLATE && type != TOKEN_TEMPLATE_HEAD &&
+		type != TOKEN_TEMPLATE_MIDDLE && type != TOKEN_TEMPLATE_TAIL)
+		return ERR_INVALID_PARAMETER;
+	if (!is_raw && token_has_bad_esc(token))
+		return ERR_INVALID_TOKEN;
+
+	/* Leave out the delimiters; the escapes can't peek past them. */
+	scanner_view_raw(this, token, &view);
+	view.src_len -= type == TOKEN_TEMPLATE_HEAD ||
+		type == TOKEN_TEMPLATE_MIDDLE ? 2 : 1;
+	end = view.src_len;
+
+	buf = &this->lazy_cooked;
+	buf->len = 0;
+	flags = 0;
+	run = pos = view.curr_pos + 1;
+	while (pos < end) {
+		cu = scanner_unit(&view, pos);
+		if (cu == '\r') {
+			err = cooked_buf_append_src(buf, &view, run, pos);
+			if (!err)
+				err = cooked_buf_append_code_point(buf, '\n');
+			if (err)
+				return err;
+			if (++pos < end && scanner_unit(&view, pos) == '\n')
+				++pos;
+			run = pos;
+			continue;
+		}
+		if (cu != '\\' || is_raw) {
+			++pos;
+			continue;
+		}
+
+		err = cooked_buf_append_src(buf, &view, run, pos);
+		if (err)
+			return err;
+		view.curr_pos = pos + 1;
+		cu = scanner_unit(&view, view.curr_pos);
+		scanner_consume(&view, 1);
+		if (is_line_terminator(cu)) {
+			if (cu == '\r' && !scanner_peek(&view, 0, &t) && t == '\n')
+				scanner_consume(&view, 1);
+		} else {
+			err = scanner_scan_escape(&view, cu, &flags, &cp);
+			if (!err)
+				err = cooked_buf_append_code_point(buf, cp);
+			if (err)
+				return err;
+		}
+		run = pos = view.curr_pos;
+	}
+
+	if (buf->len == 0)
+		return scanner_intern_slice(&view, run, end - run, out);
+	err = cooked_buf_append_src(buf, &view, run, end);
+	if (err)
+		return err;
+	return atom_table_intern(this->atoms, buf->units, buf->len,
+							 sizeof(char16_t), out);
+}
+
+int scanner_template_cooked(struct scanner *this,
+							const struct token *token,
+							uint32_t *out)
+{
+	return scanner_cook_template(this, token, false, out);
+}
+
+int scanner_template_raw(struct scanner *this,
+						 const struct token *token,
+						 uint32_t *out)
+{
+	return scanner_cook_template(this, token, true, out);
+}
+
+/*
+ * The flags are a subset of dgimsuyv, without repeats, and with at most one of
+ * u and v. The body ends at the last /, since the flags can't contain one.
+ */
+int scanner_reg_exp(struct scanner *this,
+					const struct token *token,
+					uint32_t *body,
+					uint32_t *flags)
+{
+	static const char valid_flags[] = "dgimsuyv";
+	int err;
+	size_t pos, end, slash;
+	char16_t cu;
+	unsigned seen, bit;
+	const char *flag;
+	struct scanner view;
+
+	if (token_type(token) != TOKEN_REG_EXP)
+		return ERR_INVALID_PARAMETER;
+
+	scanner_view_raw(this, token, &view);
+	end = view.src_len;
+	for (slash = end - 1; scanner_unit(&view, slash) != '/'; --slash)
+		;
+
+	seen = 0;
+	for (pos = slash + 1; pos < end; ++pos) {
+		cu = scanner_unit(&view, pos);
+		flag = cu && cu < 128 ? strchr(valid_flags, cu) : NULL;
+		if (flag == NULL)
+			return ERR_SYNTAX;
+		bit = 1u << (flag - valid_flags);
+		if (seen & bit)
+			return ERR_SYNTAX;
+		seen |= bit;
+	}
+	if ((seen & 0xa0) == 0xa0)	/* u is bit 5, v is bit 7 */
+		return ERR_SYNTAX;
+
+	pos = view.curr_pos + 1;
+	err = scanner_intern_slice(&view, pos, slash - pos, body);
+	if (!err)
+		err = scanner_intern_slice(&view, slash + 1, end - slash - 1, flags);
+	return err;
+}
+/*******************************************************************/
+/* A decimal keeps its first 19 significant digits in w; i.e. w * 10^q. */
+#define DECIMAL_MAX_DIGITS	19
+
+/* The exponent saturates there; far beyond the range of a double. */
+#define EXPONENT_LIMIT		(1ll << 40)
+
+struct decimal {
+	uint64_t	w;
+	int64_t		q;
+	size_t		num_digits;		/* Significant, in w */
+	bool		is_truncated;	/* Non-zero digits were dropped from w */
+};
+
+static
+void decimal_push(struct decimal *this,
+				  unsigned digit,
+				  bool is_frac)
+{
+	if (this->num_digits == 0 && digit == 0) {
+		this->q -= is_frac;
+	} else if (this->num_digits < DECIMAL_MAX_DIGITS) {
+		this->w = this->w * 10 + digit;
+		++this->num_digits;
+		this->q -= is_frac;
+	} else {
+		this->q += !is_frac;
+		this->is_truncated |= digit != 0;
+	}
+}
+
+static
+int number_buf_add(struct number_buf *this,
+				   union number number,
+				   uint32_t *out)
+{
+	size_t size;
+	union number *values;
+
+	if (this->len > UINT32_MAX)
+		return ERR_NO_MEMORY;
+
+	if (this->len == this->size) {
+		size = this->size ? this->size << 1 : 32;
+		values = realloc(this->values, size * sizeof(*values));
+		if (values == NULL)
+			return ERR_NO_MEMORY;
+		this->values = values;
+		this->size = size;
+	}
+	*out = this->len;
+	this->values[this->len++] = number;
+	return ERR_SUCCESS;
+}
+
+/*
+ * The src units [from, to), without the separators and the decimal point.
+ * The caller frees the digits.
+ */
+static
+int scanner_gather_digits(const struct scanner *this,
+						  size_t from,
+						  size_t to,
+						  char **out,
+						  size_t *len)
+{
+	size_t n;
+	char16_t cu;
+	char *digits;
+
+	digits = malloc(to - from + 1);
+	if (digits == NULL)
+		return ERR_NO_MEMORY;
+
+	for (n = 0; from < to; ++from) {
+		cu = scanner_unit(this, from);
+		if (cu != '_' && cu != '.')
+			digits[n++] = cu;
+	}
+	*out = digits;
+	*len = n;
+	return ERR_SUCCESS;
+}
+
+/*
+ * The next digit of the radix, if any. A separator is consumed along with the
+ * digit after it; it must be between two digits.
+ */
+static
+int scanner_scan_digit(struct scanner *this,
+					   unsigned radix,
+					   bool allow_sep,
+					   bool is_first,
+					   unsigned *out)
+{
+	size_t n;
+	char16_t cu;
+	unsigned value;
+
+	if (scanner_peek(this, 0, &cu))
+		return ERR_NO_MATCH;
+
+	n = 0;
+	if (cu == '_') {
+		if (!allow_sep || is_first || scanner_peek(this, 1, &cu))
+			return ERR_INVALID_TOKEN;
+		n = 1;
+	}
+
+	value = is_hex_digit(cu) ? (unsigned)hex_digit_value(cu) : radix;
+	if (value >= radix)
+		return n ? ERR_INVALID_TOKEN : ERR_NO_MATCH;
+	scanner_consume(this, n + 1);
+	*out = value;
+	return ERR_SUCCESS;
+}
+
+static
+int scanner_scan_decimal_digits(struct scanner *this,
+								struct decimal *dec,
+								bool is_frac,
+								size_t *out)
+{
+	int err;
+	size_t n;
+	unsigned digit;
+
+	for (n = 0; !(err = scanner_scan_digit(this, 10, true, n == 0, &digit));
+		 ++n)
+		decimal_push(dec, digit, is_frac);
+	*out = n;
+	return err == ERR_NO_MATCH ? ERR_SUCCESS : err;
+}
+
+static
+int scanner_scan_exponent(struct scanner *this,
+						  bool *has_exp,
+						  int64_t *out)
+{
+	int err;
+	size_t n;
+	unsigned digit;
+	int64_t exp;
+	char16_t cu;
+	bool is_neg;
+
+	*has_exp = false;
+	*out = 0;
+	if (scanner_peek(this, 0, &cu) || (cu != 'e' && cu != 'E'))
+		return ERR_SUCCESS;
+	scanner_consume(this, 1);
+
+	is_neg = false;
+	if (!scanner_peek(this, 0, &cu) && (cu == '+' || cu == '-')) {
+		is_neg = cu == '-';
+		scanner_consume(this, 1);
+	}
+
+	exp = 0;
+	for (n = 0; !(err = scanner_scan_digit(this, 10, true, n == 0, &digit));
+		 ++n)
+		if (exp < EXPONENT_LIMIT)
+			exp = exp * 10 + digit;
+	if (err != ERR_NO_MATCH)
+		return err;
+	if (n == 0)
+		return ERR_INVALID_TOKEN;
+	*has_exp = true;
+	*out = is_neg ? -exp : exp;
+	return ERR_SUCCESS;
+}
+
+/* The char after a number can't be an IdentifierStart or a DecimalDigit. */
+static
+int scanner_scan_number_end(struct scanner *this)
+{
+	char16_t cu;
+
+	if (scanner_peek(this, 0, &cu))
+		return ERR_SUCCESS;
+	if (is_id_start(cu) || is_dec_digit(cu) || cu == '\\')
+		return ERR_INVALID_TOKEN;
+	return ERR_SUCCESS;
+}
+
+/* Numbers are never negative; -x is a unary minus on x. */
+static
+int scanner_build_number(struct scanner *this,
+						 size_t flags,
+						 double value,
+						 struct token **out)
+{
+	int err;
+	uint32_t index;
+	union number number;
+
+	if (value <= UINT32_MAX && value == (uint32_t)value) {
+		flags |= bits_on(TF_SMALL_INT);
+		return scanner_build_token(this, TOKEN_NUMBER, flags, value, out);
+	}
+
+	number.value = value;
+	err = number_buf_add(&this->numbers, number, &index);
+	if (err)
+		return err;
+	return scanner_build_token(this, TOKEN_NUMBER, flags, index, out);
+}
+
+/* The digits are the src units [from, to). */
+static
+int scanner_build_big_int(struct scanner *this,
+						  size_t from,
+						  size_t to,
+						  unsigned radix,
+						  size_t flags,
+						  struct token **out)
+{
+	int err;
+	size_t len;
+	uint32_t index;
+	char *digits;
+	union number number;
+
+	err = scanner_gather_digits(this, from, to, &digits, &len);
+	if (err)
+		return err;
+	err = big_int_new(this->tokens, digits, len, radix, &number.big_int);
+	free(digits);
+	if (!err)
+		err = number_buf_add(&this->numbers, number, &index);
+	if (err)
+		return err;
+	flags |= bits_on(TF_BIG_INT);
+	return scanner_build_token(this, TOKEN_NUMBER, flags, index, out);
+}
+
+/*
+ * The part after the DecimalIntegerLiteral, which is already pushed into dec:
+ * the fraction, the exponent, or the BigInt suffix.
+ *
+ * Only a literal with more than 19 significant digits needs another look at
+ * its digits; and only if w and w + 1 (the bounds of its value) convert to
+ * different doubles.
+ */
+static
+int scanner_scan_decimal_rest(struct scanner *this,
+							  struct decimal *dec,
+							  size_t flags,
+							  bool allow_big_int,
+							  struct token **out)
+{
+	int err;
+	size_t len, num_frac_digits, end;
+	int64_t exp;
+	double value;
+	char16_t cu;
+	char *digits;
+	bool has_dot, has_exp;
+
+	has_dot = !scanner_peek(this, 0, &cu) && cu == '.';
+	num_frac_digits = 0;
+	if (has_dot) {
+		scanner_consume(this, 1);
+		err = scanner_scan_decimal_digits(this, dec, true, &num_frac_digits);
+		if (err)
+			return err;
+	}
+
+	end = this->curr_pos;
+	err = scanner_scan_exponent(this, &has_exp, &exp);
+	if (err)
+		return err;
+
+	if (allow_big_int && !has_dot && !has_exp &&
+		!scanner_peek(this, 0, &cu) && cu == 'n') {
+		scanner_consume(this, 1);
+		err = scanner_scan_number_end(this);
+		if (err)
+			return err;
+		return scanner_build_big_int(this, this->save_pos, end, 10, flags,
+									 out);
+	}
+
+	err = scanner_scan_number_end(this);
+	if (err)
+		return err;
+
+	value = number_from_decimal(dec->w, dec->q + exp);
+	if (dec->is_truncated &&
+		value != number_from_decimal(dec->w + 1, dec->q + exp)) {
+		err = scanner_gather_digits(this, this->save_pos, end, &digits, &len);
+		if (err)
+			return err;
+		err = number_from_decimal_digits(digits, len,
+										 exp - (int64_t)num_frac_digits,
+										 &value);
+		free(digits);
+		if (err)
+			return err;
+	}
+	return scanner_build_number(this, flags, value, out);
+}
+
+/* The part after 0x, 0o or 0b. */
+static
+int scanner_scan_non_decimal(struct scanner *this,
+							 unsigned radix,
+							 struct token **out)
+{
+	int err;
+	size_t n, len, bits_per_digit, end;
+	unsigned digit;
+	uint64_t w;
+	double value;
+	char16_t cu;
+	char *digits;
+	bool is_big;
+
+	bits_per_digit = __builtin_ctz(radix);
+	w = 0;
+	is_big = false;
+	for (n = 0; !(err = scanner_scan_digit(this, radix, true, n == 0, &digit));
+		 ++n) {
+		is_big |= (w >> (64 - bits_per_digit)) != 0;
+		w = w << bits_per_digit | digit;
+	}
+	if (err != ERR_NO_MATCH)
+		return err;
+	if (n == 0)
+		return ERR_INVALID_TOKEN;
+
+	end = this->curr_pos;
+	if (!scanner_peek(this, 0, &cu) && cu == 'n') {
+		scanner_consume(this, 1);
+		err = scanner_scan_number_end(this);
+		if (err)
+			return err;
+		return scanner_build_big_int(this, this->save_pos + 2, end, radix, 0,
+									 out);
+	}
+
+	err = scanner_scan_number_end(this);
+	if (err)
+		return err;
+
+	/* The conversion of a uint64_t is correctly rounded. */
+	value = w;
+	if (is_big) {
+		err = scanner_gather_digits(this, this->save_pos + 2, end, &digits,
+									&len);
+		if (err)
+			return err;
+		value = number_from_digits(digits, len, radix);
+		free(digits);
+	}
+	return scanner_build_number(this, 0, value, out);
+}
+
+/*
+ * The part after the leading 0 of a LegacyOctalIntegerLiteral, or of a
+ * NonOctalDecimalIntegerLiteral; the latter has an 8 or a 9, and continues as
+ * a decimal. Neither allows separators, nor BigInt suffixes.
+ */
+static
+int scanner_scan_legacy_octal(struct scanner *this,
+							  struct token **out)
+{
+	int err;
+	size_t n, len, flags;
+	unsigned digit;
+	uint64_t w;
+	double value;
+	char *digits;
+	bool is_big, is_octal;
+	struct decimal dec;
+
+	memset(&dec, 0, sizeof(dec));
+	flags = bits_on(TF_OCT_SEQ);
+	w = 0;
+	is_big = false;
+	is_octal = true;
+	for (n = 0; !(err = scanner_scan_digit(this, 10, false, n == 0, &digit));
+		 ++n) {
+		decimal_push(&dec, digit, false);
+		is_octal &= digit < 8;
+		is_big |= (w >> 61) != 0;
+		w = w << 3 | (digit & 7);
+	}
+	if (err != ERR_NO_MATCH)
+		return err;
+
+	if (!is_octal)
+		return scanner_scan_decimal_rest(this, &dec, flags, false, out);
+
+	err = scanner_scan_number_end(this);
+	if (err)
+		return err;
+
+	value = w;
+	if (is_big) {
+		err = scanner_gather_digits(this, this->save_pos + 1, this->curr_pos,
+									&digits, &len);
+		if (err)
+			return err;
+		value = number_from_digits(digits, len, 8);
+		free(digits);
+	}
+	return scanner_build_number(this, flags, value, out);
+}
+
+/*
+ * NumericLiteral. The value is converted while the digits are scanned, and is
+ * kept in the token; the later stages never look at the digits again.
+ */
+static
+int scanner_scan_number(struct scanner *this,
+						struct token **out)
+{
+	int err;
+	size_t n;
+	unsigned radix;
+	char16_t cu, t;
+	struct decimal dec;
+
+	err = scanner_peek(this, 0, &cu);
+	if (err)
+		return err;
+	if (scanner_peek(this, 1, &t))
+		t = 0;
+
+	memset(&dec, 0, sizeof(dec));
+	if (cu == '0') {
+		radix = 0;
+		if (t == 'x' || t == 'X')
+			radix = 16;
+		else if (t == 'o' || t == 'O')
+			radix = 8;
+		else if (t == 'b' || t == 'B')
+			radix = 2;
+
+		if (radix) {
+			scanner_consume(this, 2);
+			return scanner_scan_non_decimal(this, radix, out);
+		}
+
+		scanner_consume(this, 1);
+		if (is_dec_digit(t))
+			return scanner_scan_legacy_octal(this, out);
+		/* A lone 0 can't have a separator after it. */
+	} else if (cu != '.') {
+		err = scanner_scan_decimal_digits(this, &dec, false, &n);
+		if (err)
+			return err;
+	}
+	return scanner_scan_decimal_rest(this, &dec, 0, true, out);
+}
+/*******************************************************************/
+static inline
+size_t key_word_asso(char16_t cu)
+{
+	return g_key_word_asso[cu - 'a'];
+}
+
+static inline
+bool key_word_char(char16_t cu)
+{
+	return cu >= 'a' && cu <= 'z';
+}
+
+/* One probe; the index + 1 of the only key word that can match, or 0. */
+static
+size_t key_word_probe(size_t len,
+					  char16_t c0,
+					  char16_t c1,
+					  char16_t cl)
+{
+	size_t slot;
+
+	if (len < KW_MIN_LEN || len > KW_MAX_LEN)
+		return 0;
+	if (!key_word_char(c0) || !key_word_char(c1) || !key_word_char(cl))
+		return 0;
+
+	slot = len + key_word_asso(c0) + key_word_asso(c1) + key_word_asso(cl);
+	return g_key_word_hash[slot & (KW_HASH_SIZE - 1)];
+}
+
+/*
+ * The name is the src units [pos, pos + len).
+ * One probe, and at most one compare.
+ */
+static
+enum token_type key_word_type(const struct scanner *this,
+							  size_t pos,
+							  size_t len)
+{
+	size_t i, j;
+	const char16_t *key_word;
+
+	if (len < KW_MIN_LEN)
+		return TOKEN_IDENTIFIER;
+
+	i = key_word_probe(len, scanner_unit(this, pos),
+					   scanner_unit(this, pos + 1),
+					   scanner_unit(this, pos + len - 1));
+	if (i == 0)
+		return TOKEN_IDENTIFIER;
+
+	/* The nul of a shorter key word mismatches, and ends the loop. */
+	key_word = g_key_words[i - 1];
+	for (j = 0; j < len; ++j)
+		if (scanner_unit(this, pos + j) != key_word[j])
+			return TOKEN_IDENTIFIER;
+	return key_word[len] ? TOKEN_IDENTIFIER : TOKEN_IDENTIFIER + i;
+}
+
+/* As above, but the name is the cooked buffer. */
+static
+enum token_type key_word_type_cooked(const struct cooked_buf *buf)
+{
+	size_t i, j, len;
+	const char16_t *key_word;
+
+	len = buf->len;
+	if (len < KW_MIN_LEN)
+		return TOKEN_IDENTIFIER;
+
+	i = key_word_probe(len, buf->units[0], buf->units[1],
+					   buf->units[len - 1]);
+	if (i == 0)
+		return TOKEN_IDENTIFIER;
+
+	key_word = g_key_words[i - 1];
+	for (j = 0; j < len; ++j)
+		if (buf->units[j] != key_word[j])
+			return TOKEN_IDENTIFIER;
+	return key_word[len] ? TOKEN_IDENTIFIER : TOKEN_IDENTIFIER + i;
+}
+
+/*
+ * Identifiers can contain \uxxxx or \u{} esc. seqs.
+ * They cannot contain \x.. hex esc seqs.
+ * They cannot contain surr pairs.
+ *
+ * As with strings, an escape-free name is a slice of the src; otherwise, the
+ * runs and the cooked escapes are gathered in the cooked buffer. A reserved
+ * word written with escapes keeps its type, and TF_UNC_SEQ tells it apart
+ * from the literal.
+ */
+static
+int scanner_scan_identifier(struct scanner *this,
+							struct token **out)
+{
+	int err;
+	size_t pos, len, run, flags;
+	uint32_t atom;
+	char16_t cu;
+	char32_t cp;
+	enum token_type type;
+	struct cooked_buf *buf;
+
+	buf = &this->cooked;
+	buf->len = 0;
+	flags = 0;
+	run = pos = this->curr_pos;
 	while (true) {
 		if (scanner_peek(this, 0, &cu))
 			break;
@@ -474,105 +1831,232 @@ int scanner_scan_identifier(struct scanner *this,
 			break;
 
 		if (cu == '\\') {
+			err = cooked_buf_append_src(buf, this, run, this->curr_pos);
+			if (err)
+				return err;
+
+			/* Only \u is allowed; its code point must fit the position. */
+			if (scanner_peek(this, 1, &cu) || cu != 'u')
+				return ERR_INVALID_TOKEN;
+			len = this->curr_pos - pos;
+			scanner_consume(this, 2);
+			err = scanner_scan_unicode_escape(this, &cp);
+			if (err)
+				return err;
+			if (len == 0 ? !is_id_start(cp) : !is_id_continue(cp))
+				return ERR_INVALID_TOKEN;
+
+			err = cooked_buf_append_code_point(buf, cp);
+			if (err)
+				return err;
 			flags |= bits_on(TF_UNC_SEQ);
-			printf("%s: TODO\n", __func__);
-			exit(0);
+			run = this->curr_pos;
+			continue;
 		}
 
 		/* At start, the cu must be in id_start */
-		if (i == 0 && cooked_len == 0 && !is_id_start(cu))
+		if (this->curr_pos == pos && !is_id_start(cu))
 			break;
 
 		/* Valid codepoint but not part of id_continue */
-		if ((i || cooked_len) && !is_id_continue(cu))
+		if (this->curr_pos != pos && !is_id_continue(cu))
 			break;
-
-		if (i == 32) {
-			cooked = realloc(cooked, (cooked_len + i) * sizeof(char16_t));
-			if (cooked == NULL)
-				return ERR_NO_MEMORY;
-			memcpy(&cooked[cooked_len], name, i * sizeof(char16_t));
-			cooked_len += i;
-			i = 0;
-		}
-		name[i++] = cu;
 		scanner_consume(this, 1);
 	}
 
-	if (i == 0 && cooked_len == 0)
+	len = this->curr_pos - pos;
+	if (len == 0)
 		return ERR_INVALID_TOKEN;
 
-	if (i) {
-		cooked = realloc(cooked, (cooked_len + i) * sizeof(char16_t));
-		if (cooked == NULL)
-			return ERR_NO_MEMORY;
-		memcpy(&cooked[cooked_len], name, i * sizeof(char16_t));
-		cooked_len += i;
+	/* Reserved words are identified by their type alone. */
+	err = ERR_SUCCESS;
+	atom = ATOM_NONE;
+	if (flags == 0) {
+		type = key_word_type(this, pos, len);
+		if (type == TOKEN_IDENTIFIER)
+			err = scanner_intern_slice(this, pos, len, &atom);
+	} else {
+		err = cooked_buf_append_src(buf, this, run, this->curr_pos);
+		if (err)
+			return err;
+		type = key_word_type_cooked(buf);
+		if (type == TOKEN_IDENTIFIER)
+			err = atom_table_intern(this->atoms, buf->units, buf->len,
+									sizeof(char16_t), &atom);
 	}
+	if (err)
+		return err;
+	return scanner_build_token(this, type, flags, atom, out);
+}
+/*******************************************************************/
+/*
+ * One table dispatch per unit. The DFA may overshoot by a unit: .. is not a
+ * punctuator, and neither is ?. before a digit, which is ? followed by a
+ * number.
+ */
+static
+int scanner_scan_punctuator(struct scanner *this,
+							char16_t cu,
+							struct token **out)
+{
+	enum token_type type, next;
 
-	type = TOKEN_IDENTIFIER;
-	for (i = 0; i < ARRAY_SIZE(g_key_words); ++i) {
-		for (j = 0; j < cooked_len; ++j) {
-			if (cooked[j] != g_key_words[i][j])
-				break;
-		}
+	type = g_punct_start[cu];
+	scanner_consume(this, 1);
 
-		if (j == cooked_len && g_key_words[i][j] == 0) {
-			type = TOKEN_IDENTIFIER + i + 1;
+	while (!scanner_peek(this, 0, &cu) && cu < ARRAY_SIZE(g_punct_class)) {
+		next = g_punct_next[type][g_punct_class[cu]];
+		if (next == TOKEN_INVALID)
 			break;
-		}
+		type = next;
+		scanner_consume(this, 1);
 	}
 
-	err = scanner_build_token(this, type, flags, &token);
-	if (!err && type == TOKEN_IDENTIFIER)
-		token_set_cooked(token, cooked, cooked_len);
-	if (!err)
-		*out = token;
-	return err;
+	if (type == TOKEN_DOT_DOT) {
+		type = TOKEN_DOT;
+		--this->curr_pos;
+	} else if (type == TOKEN_QUESTION_DOT && !scanner_peek(this, 0, &cu) &&
+			   is_dec_digit(cu)) {
+		type = TOKEN_QUESTION;
+		--this->curr_pos;
+	}
+	return scanner_build_token(this, type, 0, ATOM_NONE, out);
 }
 /*******************************************************************/
+/* Whether the token can end an operand; a / after it is a division. */
 static
-int scanner_scan_semi_colon(struct scanner *this,
-							struct token **out)
+bool goal_guess_is_operand_end(enum token_type type)
+{
+	switch (type) {
+	case TOKEN_IDENTIFIER:
+	case TOKEN_NUMBER:
+	case TOKEN_STRING:
+	case TOKEN_REG_EXP:
+	case TOKEN_TEMPLATE:
+	case TOKEN_TEMPLATE_TAIL:
+	case TOKEN_RIGHT_PAREN:
+	case TOKEN_RIGHT_BRACKET:
+	case TOKEN_RIGHT_BRACE:
+	case TOKEN_INC:
+	case TOKEN_DEC:
+	case TOKEN_THIS:
+	case TOKEN_SUPER:
+	case TOKEN_NULL:
+	case TOKEN_TRUE:
+	case TOKEN_FALSE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* A } can't end a substitution where an operand is due. */
+enum scanner_goal goal_guess_goal(const struct goal_guess *this)
+{
+	if (!goal_guess_is_operand_end(this->prev_type))
+		return SCANNER_GOAL_REG_EXP;
+	if (this->depth && this->depth <= GOAL_GUESS_MAX_DEPTH &&
+		(this->bits >> (this->depth - 1)) & 1)
+		return SCANNER_GOAL_TEMPLATE_TAIL;
+	return SCANNER_GOAL_DIV;
+}
+
+void goal_guess_add(struct goal_guess *this,
+					const struct token *token)
+{
+	uint64_t bit;
+	enum token_type type;
+
+	type = token_type(token);
+	this->prev_type = type;
+	switch (type) {
+	case TOKEN_LEFT_BRACE:
+	case TOKEN_TEMPLATE_HEAD:
+		if (this->depth < GOAL_GUESS_MAX_DEPTH) {
+			bit = 1ull << this->depth;
+			if (type == TOKEN_TEMPLATE_HEAD)
+				this->bits |= bit;
+			else
+				this->bits &= ~bit;
+		}
+		++this->depth;
+		break;
+	case TOKEN_RIGHT_BRACE:
+	case TOKEN_TEMPLATE_TAIL:
+		if (this->depth)
+			--this->depth;
+		break;
+	default:
+		break;
+	}
+}
+
+/*
+ * A / or a } can always be read under the DIV goal; a failure under that
+ * goal is the same under any other goal.
+ */
+int goal_guess_scan(const struct goal_guess *this,
+					struct scanner *scanner,
+					const struct token **out)
 {
-	scanner_consume(this, 1);	/* Consume ; */
-	return scanner_build_token(this, TOKEN_SEMI_COLON, 0, out);
+	int err;
+	enum scanner_goal goal;
+
+	goal = goal_guess_goal(this);
+	err = scanner_get_next_token(scanner, goal, out);
+	if (err && goal != SCANNER_GOAL_DIV)
+		err = scanner_get_next_token(scanner, SCANNER_GOAL_DIV, out);
+	return err;
 }
 /*******************************************************************/
+/*
+ * A / or a } may be read differently under another goal; its units are
+ * pinned, so that a stream can rescan it.
+ */
 static
 int scanner_scan_next_token(struct scanner *this,
+							enum scanner_goal goal,
 							struct token **out)
 {
 	int err;
-	char16_t cu;
+	char16_t cu, t;
 
-	this->save_locn = this->curr_locn;
+	this->save_pos = this->curr_pos;
+	this->is_in_token = true;
 
 	err = scanner_peek(this, 0, &cu);
 	if (err)
 		return err;
 
-	if (cu == ';')
-		return scanner_scan_semi_colon(this, out);
+	if (cu == '/' || cu == '}') {
+		this->has_pin = true;
+		this->pin_pos = this->save_pos;
+	}
 
 	if (cu == '\"' || cu == '\'')
 		return scanner_scan_string(this, out);
 
-	if (cu == '=')
-		return scanner_scan_equals(this, out);
+	if (cu == '`' || (cu == '}' && goal == SCANNER_GOAL_TEMPLATE_TAIL))
+		return scanner_scan_template(this, cu, out);
 
-	if (is_id_start(cu))
+	if (cu == '/' && goal == SCANNER_GOAL_REG_EXP)
+		return scanner_scan_reg_exp(this, out);
+
+	if (is_dec_digit(cu) ||
+		(cu == '.' && !scanner_peek(this, 1, &t) && is_dec_digit(t)))
+		return scanner_scan_number(this, out);
+
+	if (cu < ARRAY_SIZE(g_punct_start) && g_punct_start[cu])
+		return scanner_scan_punctuator(this, cu, out);
+
+	if (is_id_start(cu) || cu == '\\')
 		return scanner_scan_identifier(this, out);
 
-	printf("%s: (%ld, %ld) unsup %x (%c)\n", __func__,
-		   this->curr_locn.file_row + 1,
-		   this->curr_locn.file_col + 1,
-		   cu, cu);
-	exit(0);
-	return err;
+	return ERR_UNSUPPORTED;
 }
 
 int scanner_get_next_token(struct scanner *this,
+						   enum scanner_goal goal,
 						   const struct token **out)
 {
 	int err;
@@ -581,12 +2065,99 @@ int scanner_get_next_token(struct scanner *this,
 	if (scanner_skip_white_space(this))
 		this->prev_token_type = TOKEN_NEW_LINE;
 
-	err = scanner_scan_next_token(this, &token);
+	err = scanner_scan_next_token(this, goal, &token);
+	this->is_in_token = false;
 
-	/* Restore the curr_locn on error. */
-	if (err)
-		this->curr_locn = this->save_locn;
-	else
+	/* Restore the curr_pos on error. */
+	if (err) {
+		this->curr_pos = this->save_pos;
+	} else {
+		this->prev_token_type = token_type(token);
 		*out = token;
+	}
 	return err;
 }
+
+/*
+ * The token starts past any white space; only its new-line prefix has to be
+ * restored.
+ */
+int scanner_rescan_token(struct scanner *this,
+						 const struct token *token,
+						 enum scanner_goal goal,
+						 const struct token **out)
+{
+	if (token->scan_pos < this->src_base)
+		return ERR_UNSUPPORTED;
+
+	this->curr_pos = token->scan_pos;
+	this->prev_token_type = token_has_new_line_pfx(token) ? TOKEN_NEW_LINE :
+		token_type(token);
+	return scanner_get_next_token(this, goal, out);
+}
+
+int scanner_seek(struct scanner *this,
+				 size_t pos,
+				 enum token_type prev_type)
+{
+	if (this->stream)
+		return ERR_UNSUPPORTED;
+	if (pos > this->src_len)
+		return ERR_INVALID_PARAMETER;
+
+	this->curr_pos = pos;
+	this->prev_token_type = prev_type;
+	return ERR_SUCCESS;
+}
+
+/* A BigInt lives in the other's arena; it is copied into this one's. */
+int scanner_adopt_token(struct scanner *this,
+						const struct scanner *other,
+						const struct token *token,
+						uint32_t *atom_map,
+						const struct token **out)
+{
+	int err;
+	size_t len, unit_size, size;
+	uint32_t atom, index;
+	const void *units;
+	union number number;
+	struct big_int *big_int;
+	struct token *copy;
+
+	copy = arena_alloc(this->tokens, sizeof(*copy), _Alignof(struct token));
+	if (copy == NULL)
+		return ERR_NO_MEMORY;
+	*copy = *token;
+
+	if (token_type(token) == TOKEN_NUMBER) {
+		if (bits_get(token->flags, TF_SMALL_INT))
+			goto done;
+		number = other->numbers.values[token->number];
+		if (token_is_big_int(token)) {
+			size = sizeof(*number.big_int) +
+				number.big_int->num_limbs * sizeof(uint64_t);
+			big_int = arena_alloc(this->tokens, size, _Alignof(struct big_int));
+			if (big_int == NULL)
+				return ERR_NO_MEMORY;
+			number.big_int = memcpy(big_int, number.big_int, size);
+		}
+		err = number_buf_add(&this->numbers, number, &index);
+		if (err)
+			return err;
+		copy->number = index;
+	} else if (token->atom != ATOM_NONE) {
+		atom = atom_map[token->atom];
+		if (atom == ATOM_NONE) {
+			units = atom_table_get(other->atoms, token->atom, &len, &unit_size);
+			err = atom_table_intern(this->atoms, units, len, unit_size, &atom);
+			if (err)
+				return err;
+			atom_map[token->atom] = atom;
+		}
+		copy->atom = atom;
+	}
+done:
+	*out = copy;
+	return ERR_SUCCESS;
+}
@@ -0,0 +1,193 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+#include <pub/source.h>
+#include <pub/utf8.h>
+#include <pub/error.h>
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+static const
+uint8_t g_bom_native[] = {0xff, 0xfe};
+static const
+uint8_t g_bom_swapped[] = {0xfe, 0xff};
+#else
+static const
+uint8_t g_bom_native[] = {0xfe, 0xff};
+static const
+uint8_t g_bom_swapped[] = {0xff, 0xfe};
+#endif
+
+/* Used for empty files, which cannot be mapped. */
+static const
+uint8_t g_empty[1];
+/*******************************************************************/
+static
+bool source_has_bom(const struct source *this,
+					const uint8_t *bom)
+{
+	const uint8_t *p = this->map;
+
+	return this->map_size >= 2 && p[0] == bom[0] && p[1] == bom[1];
+}
+
+static
+int source_swap_utf16(struct source *this)
+{
+	size_t i, num_units;
+	const uint8_t *p;
+	char16_t *buf;
+	bool is_be;
+
+	if (this->map_size & 1)
+		return ERR_BAD_FILE;
+
+	num_units = this->map_size / 2 - 1;	/* Skip the BOM */
+	buf = malloc((num_units ? num_units : 1) * sizeof(char16_t));
+	if (buf == NULL)
+		return ERR_NO_MEMORY;
+
+	/* Decode by the BOM found; FE FF is big-endian, FF FE little-endian. */
+	p = this->map;
+	is_be = p[0] == 0xfe;
+	for (i = 0, p += 2; i < num_units; ++i, p += 2)
+		buf[i] = is_be ? p[0] << 8 | p[1] : p[1] << 8 | p[0];
+	this->buf = buf;
+	this->num_units = num_units;
+	this->unit_size = sizeof(char16_t);
+	return ERR_SUCCESS;
+}
+
+static
+int source_load_utf8(struct source *this)
+{
+	int err;
+	size_t num_units;
+	char32_t max;
+	char16_t *buf;
+	uint8_t *bytes;
+
+	err = utf8_to_utf16_length(this->map, this->map_size, &num_units, &max);
+	if (err)
+		return err;
+
+	/* Zero-copy */
+	if (max < 0x80) {
+		this->units = this->map;
+		this->num_units = this->map_size;
+		return ERR_SUCCESS;
+	}
+
+	if (max <= 0xff) {
+		bytes = malloc(num_units);
+		if (bytes == NULL)
+			return ERR_NO_MEMORY;
+		utf8_to_latin1(this->map, this->map_size, bytes);
+		this->buf = bytes;
+	} else {
+		buf = malloc(num_units * sizeof(char16_t));
+		if (buf == NULL)
+			return ERR_NO_MEMORY;
+		utf8_to_utf16(this->map, this->map_size, buf);
+		this->buf = buf;
+		this->unit_size = sizeof(char16_t);
+	}
+	this->num_units = num_units;
+	return ERR_SUCCESS;
+}
+
+static
+int source_load(struct source *this)
+{
+	int err;
+
+	this->unit_size = 1;
+
+	/* Zero-copy */
+	if (source_has_bom(this, g_bom_native)) {
+		if (this->map_size & 1)
+			return ERR_BAD_FILE;
+		this->units = (const char16_t *)this->map + 1;	/* Skip the BOM */
+		this->num_units = this->map_size / 2 - 1;
+		this->unit_size = sizeof(char16_t);
+		return ERR_SUCCESS;
+	}
+
+	if (source_has_bom(this, g_bom_swapped))
+		err = source_swap_utf16(this);
+	else
+		err = source_load_utf8(this);
+	if (err || this->buf == NULL)
+		return err;
+
+	/* The units are in buf. The mapping is not needed anymore. */
+	this->units = this->buf;
+	munmap(this->map, this->map_size);
+	this->map = NULL;
+	return ERR_SUCCESS;
+}
+/*******************************************************************/
+int source_new(const char *path,
+			   struct source **out)
+{
+	int fd, err;
+	struct stat st;
+	struct source *source;
+
+	err = ERR_OPEN_FILE;
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		goto err0;
+
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode))
+		goto err1;
+
+	err = ERR_NO_MEMORY;
+	source = calloc(1, sizeof(*source));
+	if (source == NULL)
+		goto err1;
+
+	source->units = g_empty;
+	source->unit_size = 1;
+	source->map_size = st.st_size;
+	if (source->map_size) {
+		source->map = mmap(NULL, source->map_size, PROT_READ, MAP_PRIVATE, fd,
+						   0);
+		if (source->map == MAP_FAILED) {
+			source->map = NULL;
+			goto err2;
+		}
+		posix_madvise(source->map, source->map_size,
+					  POSIX_MADV_SEQUENTIAL);
+
+		err = source_load(source);
+		if (err)
+			goto err2;
+	}
+
+	close(fd);
+	*out = source;
+	return ERR_SUCCESS;
+err2:
+	source_delete(source);
+err1:
+	close(fd);
+err0:
+	return err;
+}
+
+int source_delete(struct source *this)
+{
+	if (this->map)
+		munmap(this->map, this->map_size);
+	free(this->buf);
+	free(this);
+	return ERR_SUCCESS;
+}
@@ -0,0 +1,107 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+#include <pub/stream.h>
+#include <pub/utf8.h>
+#include <pub/error.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+int stream_new(int fd,
+			   struct stream **out)
+{
+	struct stream *stream;
+
+	stream = calloc(1, sizeof(*stream));
+	if (stream == NULL)
+		return ERR_NO_MEMORY;
+	stream->fd = fd;
+	*out = stream;
+	return ERR_SUCCESS;
+}
+
+int stream_delete(struct stream *this)
+{
+	free(this);
+	return ERR_SUCCESS;
+}
+/*******************************************************************/
+/* Fill the bytes until either the buffer is full, or the eof is reached. */
+static
+int stream_fill(struct stream *this)
+{
+	ssize_t ret;
+
+	while (!this->is_eof && this->num_bytes < STREAM_CHUNK_SIZE) {
+		ret = read(this->fd, &this->bytes[this->num_bytes],
+				   STREAM_CHUNK_SIZE - this->num_bytes);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret < 0)
+			return ERR_BAD_FILE;
+		if (ret == 0)
+			this->is_eof = true;
+		this->num_bytes += ret;
+	}
+	return ERR_SUCCESS;
+}
+
+/* Returns the # of bytes that form complete seqs. */
+static
+size_t stream_complete_len(const struct stream *this)
+{
+	size_t i, n, len;
+	uint8_t b;
+
+	len = this->num_bytes;
+	if (this->is_eof)
+		return len;
+
+	/* Find the leader of the last seq. It is at most 3 bytes back. */
+	for (i = len; i > 0 && len - i < 4; --i) {
+		b = this->bytes[i - 1];
+		if ((b & 0xc0) == 0x80)
+			continue;
+
+		if (b < 0xc0)
+			n = 1;
+		else if (b < 0xe0)
+			n = 2;
+		else if (b < 0xf0)
+			n = 3;
+		else
+			n = 4;
+		return len - (i - 1) < n ? i - 1 : len;
+	}
+	return len;
+}
+
+int stream_read(struct stream *this,
+				char16_t *dst,
+				size_t *out_len)
+{
+	int err;
+	size_t n, len;
+	char32_t max;
+
+	err = stream_fill(this);
+	if (err)
+		return err;
+
+	if (this->num_bytes == 0)
+		return ERR_END_OF_FILE;
+
+	/* Validation also rejects a truncated seq. at the eof. */
+	n = stream_complete_len(this);
+	err = utf8_to_utf16_length((const char *)this->bytes, n, &len, &max);
+	if (err)
+		return err;
+
+	*out_len = utf8_to_utf16((const char *)this->bytes, n, dst);
+	this->num_bytes -= n;
+	memmove(this->bytes, &this->bytes[n], this->num_bytes);
+	return ERR_SUCCESS;
+}
@@ -0,0 +1,712 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+#include <pub/units.h>
+
+#include <stdint.h>
+#include <uchar.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define UNITS_X86
+#endif
+
+/*
+ * The vector kernels classify 16 or 32 bytes at a time, and turn the result
+ * into a bit mask with movemask. For 2-byte units, each unit sets 2 bits of
+ * the mask; the index of the unit is then half the index of the bit.
+ *
+ * A kernel is a loop shared by both widths, and specialized by inlining with
+ * the unit size and the classifier of the width. The tail, shorter than a
+ * vector, is left to the scalar kernel.
+ */
+#define UNITS_INLINE	static inline __attribute__((always_inline))
+
+typedef bool fn_unit_pred(char16_t cu);
+
+static inline
+bool is_line_term_unit(char16_t cu)
+{
+	return cu == '\n' || cu == '\r' || (cu & 0xfffe) == 0x2028;
+}
+
+static inline
+bool is_star_or_line_term_unit(char16_t cu)
+{
+	return cu == '*' || is_line_term_unit(cu);
+}
+
+static inline
+bool is_string_stop_unit(char16_t cu)
+{
+	return cu == '\'' || cu == '"' || cu == '\\' || cu == '\n' || cu == '\r';
+}
+
+static inline
+bool is_template_stop_unit(char16_t cu)
+{
+	return cu == '`' || cu == '$' || cu == '\\';
+}
+
+static inline
+bool is_white_space_unit(char16_t cu)
+{
+	return cu == ' ' || (cu >= '\t' && cu <= '\r');
+}
+/*******************************************************************/
+UNITS_INLINE
+char16_t unit_at(const void *units,
+				 size_t unit_size,
+				 size_t i)
+{
+	if (unit_size == 1)
+		return ((const uint8_t *)units)[i];
+	return ((const char16_t *)units)[i];
+}
+
+UNITS_INLINE
+size_t find_scalar(const void *units,
+				   size_t len,
+				   size_t unit_size,
+				   fn_unit_pred *pred)
+{
+	size_t i;
+
+	for (i = 0; i < len && !pred(unit_at(units, unit_size, i)); ++i)
+		;
+	return i;
+}
+
+UNITS_INLINE
+size_t span_scalar(const void *units,
+				   size_t len,
+				   size_t unit_size,
+				   bool *has_line_term)
+{
+	size_t i;
+	char16_t cu;
+
+	for (i = 0; i < len; ++i) {
+		cu = unit_at(units, unit_size, i);
+		if (!is_white_space_unit(cu))
+			break;
+		if (cu == '\n' || cu == '\r')
+			*has_line_term = true;
+	}
+	return i;
+}
+
+static
+size_t find_line_term_8_scalar(const void *units,
+							   size_t len)
+{
+	return find_scalar(units, len, 1, is_line_term_unit);
+}
+
+static
+size_t find_line_term_16_scalar(const void *units,
+								size_t len)
+{
+	return find_scalar(units, len, 2, is_line_term_unit);
+}
+
+static
+size_t find_star_or_line_term_8_scalar(const void *units,
+									   size_t len)
+{
+	return find_scalar(units, len, 1, is_star_or_line_term_unit);
+}
+
+static
+size_t find_star_or_line_term_16_scalar(const void *units,
+										size_t len)
+{
+	return find_scalar(units, len, 2, is_star_or_line_term_unit);
+}
+
+static
+size_t find_string_stop_8_scalar(const void *units,
+								 size_t len)
+{
+	return find_scalar(units, len, 1, is_string_stop_unit);
+}
+
+static
+size_t find_string_stop_16_scalar(const void *units,
+								  size_t len)
+{
+	return find_scalar(units, len, 2, is_string_stop_unit);
+}
+
+static
+size_t find_template_stop_8_scalar(const void *units,
+								   size_t len)
+{
+	return find_scalar(units, len, 1, is_template_stop_unit);
+}
+
+static
+size_t find_template_stop_16_scalar(const void *units,
+									size_t len)
+{
+	return find_scalar(units, len, 2, is_template_stop_unit);
+}
+
+static
+size_t span_white_space_8_scalar(const void *units,
+								 size_t len,
+								 bool *has_line_term)
+{
+	return span_scalar(units, len, 1, has_line_term);
+}
+
+static
+size_t span_white_space_16_scalar(const void *units,
+								  size_t len,
+								  bool *has_line_term)
+{
+	return span_scalar(units, len, 2, has_line_term);
+}
+/*******************************************************************/
+#ifdef UNITS_X86
+#define SSE2_INLINE	UNITS_INLINE __attribute__((target("sse2")))
+
+typedef __m128i fn_sse2_class(__m128i v);
+
+SSE2_INLINE
+__m128i sse2_line_term_8(__m128i v)
+{
+	return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+						_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+}
+
+SSE2_INLINE
+__m128i sse2_line_term_16(__m128i v)
+{
+	__m128i m;
+
+	m = _mm_or_si128(_mm_cmpeq_epi16(v, _mm_set1_epi16('\n')),
+					 _mm_cmpeq_epi16(v, _mm_set1_epi16('\r')));
+	v = _mm_and_si128(v, _mm_set1_epi16((short)0xfffe));
+	return _mm_or_si128(m, _mm_cmpeq_epi16(v, _mm_set1_epi16(0x2028)));
+}
+
+SSE2_INLINE
+__m128i sse2_star_or_line_term_8(__m128i v)
+{
+	return _mm_or_si128(sse2_line_term_8(v),
+						_mm_cmpeq_epi8(v, _mm_set1_epi8('*')));
+}
+
+SSE2_INLINE
+__m128i sse2_star_or_line_term_16(__m128i v)
+{
+	return _mm_or_si128(sse2_line_term_16(v),
+						_mm_cmpeq_epi16(v, _mm_set1_epi16('*')));
+}
+
+SSE2_INLINE
+__m128i sse2_string_stop_8(__m128i v)
+{
+	__m128i m;
+
+	m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\'')),
+					 _mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+	m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+	return _mm_or_si128(m, sse2_line_term_8(v));
+}
+
+SSE2_INLINE
+__m128i sse2_string_stop_16(__m128i v)
+{
+	__m128i m;
+
+	m = _mm_or_si128(_mm_cmpeq_epi16(v, _mm_set1_epi16('\'')),
+					 _mm_cmpeq_epi16(v, _mm_set1_epi16('"')));
+	m = _mm_or_si128(m, _mm_cmpeq_epi16(v, _mm_set1_epi16('\\')));
+	m = _mm_or_si128(m, _mm_cmpeq_epi16(v, _mm_set1_epi16('\n')));
+	return _mm_or_si128(m, _mm_cmpeq_epi16(v, _mm_set1_epi16('\r')));
+}
+
+SSE2_INLINE
+__m128i sse2_template_stop_8(__m128i v)
+{
+	__m128i m;
+
+	m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('`')),
+					 _mm_cmpeq_epi8(v, _mm_set1_epi8('$')));
+	return _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+}
+
+SSE2_INLINE
+__m128i sse2_template_stop_16(__m128i v)
+{
+	__m128i m;
+
+	m = _mm_or_si128(_mm_cmpeq_epi16(v, _mm_set1_epi16('`')),
+					 _mm_cmpeq_epi16(v, _mm_set1_epi16('$')));
+	return _mm_or_si128(m, _mm_cmpeq_epi16(v, _mm_set1_epi16('\\')));
+}
+
+/* \t..\r are contiguous: v - '\t' <= 4, unsigned. */
+SSE2_INLINE
+__m128i sse2_white_space_8(__m128i v)
+{
+	__m128i t;
+
+	t = _mm_subs_epu8(_mm_sub_epi8(v, _mm_set1_epi8('\t')), _mm_set1_epi8(4));
+	return _mm_or_si128(_mm_cmpeq_epi8(t, _mm_setzero_si128()),
+						_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+}
+
+SSE2_INLINE
+__m128i sse2_white_space_16(__m128i v)
+{
+	__m128i t;
+
+	t = _mm_subs_epu16(_mm_sub_epi16(v, _mm_set1_epi16('\t')),
+					   _mm_set1_epi16(4));
+	return _mm_or_si128(_mm_cmpeq_epi16(t, _mm_setzero_si128()),
+						_mm_cmpeq_epi16(v, _mm_set1_epi16(' ')));
+}
+
+SSE2_INLINE
+size_t find_sse2(const void *units,
+				 size_t len,
+				 size_t unit_size,
+				 fn_sse2_class *class,
+				 fn_units_find *tail)
+{
+	int mask;
+	size_t i, n;
+	__m128i v;
+	const char *p = units;
+
+	n = sizeof(v) / unit_size;
+	for (i = 0; i + n <= len; i += n) {
+		v = _mm_loadu_si128((const __m128i *)&p[i * unit_size]);
+		mask = _mm_movemask_epi8(class(v));
+		if (mask)
+			return i + __builtin_ctz(mask) / unit_size;
+	}
+	return i + tail(&p[i * unit_size], len - i);
+}
+
+SSE2_INLINE
+size_t span_sse2(const void *units,
+				 size_t len,
+				 size_t unit_size,
+				 bool *has_line_term,
+				 fn_sse2_class *white_space,
+				 fn_sse2_class *line_term,
+				 fn_units_span *tail)
+{
+	unsigned int ws, lt, end;
+	size_t i, n;
+	__m128i v;
+	const char *p = units;
+
+	n = sizeof(v) / unit_size;
+	for (i = 0; i + n <= len; i += n) {
+		v = _mm_loadu_si128((const __m128i *)&p[i * unit_size]);
+		ws = _mm_movemask_epi8(white_space(v));
+		lt = _mm_movemask_epi8(line_term(v));
+		if (ws == 0xffff) {
+			if (lt)
+				*has_line_term = true;
+			continue;
+		}
+		end = __builtin_ctz(~ws);
+		if (lt & ((1u << end) - 1))
+			*has_line_term = true;
+		return i + end / unit_size;
+	}
+	return i + tail(&p[i * unit_size], len - i, has_line_term);
+}
+
+__attribute__((target("sse2")))
+static
+size_t find_line_term_8_sse2(const void *units,
+							 size_t len)
+{
+	return find_sse2(units, len, 1, sse2_line_term_8,
+					 find_line_term_8_scalar);
+}
+
+__attribute__((target("sse2")))
+static
+size_t find_line_term_16_sse2(const void *units,
+							  size_t len)
+{
+	return find_sse2(units, len, 2, sse2_line_term_16,
+					 find_line_term_16_scalar);
+}
+
+__attribute__((target("sse2")))
+static
+size_t find_star_or_line_term_8_sse2(const void *units,
+									 size_t len)
+{
+	return find_sse2(units, len, 1, sse2_star_or_line_term_8,
+					 find_star_or_line_term_8_scalar);
+}
+
+__attribute__((target("sse2")))
+static
+size_t find_star_or_line_term_16_sse2(const void *units,
+									  size_t len)
+{
+	return find_sse2(units, len, 2, sse2_star_or_line_term_16,
+					 find_star_or_line_term_16_scalar);
+}
+
+__attribute__((target("sse2")))
+static
+size_t find_string_stop_8_sse2(const void *units,
+							 size_t len)
+{
+	return find_sse2(units, len, 1, sse2_string_stop_8,
+					 find_string_stop_8_scalar);
+}
+
+__attribute__((target("sse2")))
+static
+size_t find_string_stop_16_sse2(const void *units,
+							  size_t len)
+{
+	return find_sse2(units, len, 2, sse2_string_stop_16,
+					 find_string_stop_16_scalar);
+}
+
+__attribute__((target("sse2")))
+static
+size_t find_template_stop_8_sse2(const void *units,
+								 size_t len)
+{
+	return find_sse2(units, len, 1, sse2_template_stop_8,
+					 find_template_stop_8_scalar);
+}
+
+__attribute__((target("sse2")))
+static
+size_t find_template_stop_16_sse2(const void *units,
+								  size_t len)
+{
+	return find_sse2(units, len, 2, sse2_template_stop_16,
+					 find_template_stop_16_scalar);
+}
+
+__attribute__((target("sse2")))
+static
+size_t span_white_space_8_sse2(const void *units,
+							   size_t len,
+							   bool *has_line_term)
+{
+	return span_sse2(units, len, 1, has_line_term, sse2_white_space_8,
+					 sse2_line_term_8, span_white_space_8_scalar);
+}
+
+__attribute__((target("sse2")))
+static
+size_t span_white_space_16_sse2(const void *units,
+								size_t len,
+								bool *has_line_term)
+{
+	return span_sse2(units, len, 2, has_line_term, sse2_white_space_16,
+					 sse2_line_term_16, span_white_space_16_scalar);
+}
+/*******************************************************************/
+#define AVX2_INLINE	UNITS_INLINE __attribute__((target("avx2")))
+
+typedef __m256i fn_avx2_class(__m256i v);
+
+AVX2_INLINE
+__m256i avx2_line_term_8(__m256i v)
+{
+	return _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+						   _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+}
+
+AVX2_INLINE
+__m256i avx2_line_term_16(__m256i v)
+{
+	__m256i m;
+
+	m = _mm256_or_si256(_mm256_cmpeq_epi16(v, _mm256_set1_epi16('\n')),
+						_mm256_cmpeq_epi16(v, _mm256_set1_epi16('\r')));
+	v = _mm256_and_si256(v, _mm256_set1_epi16((short)0xfffe));
+	return _mm256_or_si256(m, _mm256_cmpeq_epi16(v,
+												 _mm256_set1_epi16(0x2028)));
+}
+
+AVX2_INLINE
+__m256i avx2_star_or_line_term_8(__m256i v)
+{
+	return _mm256_or_si256(avx2_line_term_8(v),
+						   _mm256_cmpeq_epi8(v, _mm256_set1_epi8('*')));
+}
+
+AVX2_INLINE
+__m256i avx2_star_or_line_term_16(__m256i v)
+{
+	return _mm256_or_si256(avx2_line_term_16(v),
+						   _mm256_cmpeq_epi16(v, _mm256_set1_epi16('*')));
+}
+
+AVX2_INLINE
+__m256i avx2_string_stop_8(__m256i v)
+{
+	__m256i m;
+
+	m = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\'')),
+						_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')));
+	m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+	return _mm256_or_si256(m, avx2_line_term_8(v));
+}
+
+AVX2_INLINE
+__m256i avx2_string_stop_16(__m256i v)
+{
+	__m256i m;
+
+	m = _mm256_or_si256(_mm256_cmpeq_epi16(v, _mm256_set1_epi16('\'')),
+						_mm256_cmpeq_epi16(v, _mm256_set1_epi16('"')));
+	m = _mm256_or_si256(m, _mm256_cmpeq_epi16(v, _mm256_set1_epi16('\\')));
+	m = _mm256_or_si256(m, _mm256_cmpeq_epi16(v, _mm256_set1_epi16('\n')));
+	return _mm256_or_si256(m, _mm256_cmpeq_epi16(v, _mm256_set1_epi16('\r')));
+}
+
+AVX2_INLINE
+__m256i avx2_template_stop_8(__m256i v)
+{
+	__m256i m;
+
+	m = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('`')),
+						_mm256_cmpeq_epi8(v, _mm256_set1_epi8('$')));
+	return _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+}
+
+AVX2_INLINE
+__m256i avx2_template_stop_16(__m256i v)
+{
+	__m256i m;
+
+	m = _mm256_or_si256(_mm256_cmpeq_epi16(v, _mm256_set1_epi16('`')),
+						_mm256_cmpeq_epi16(v, _mm256_set1_epi16('$')));
+	return _mm256_or_si256(m, _mm256_cmpeq_epi16(v, _mm256_set1_epi16('\\')));
+}
+
+AVX2_INLINE
+__m256i avx2_white_space_8(__m256i v)
+{
+	__m256i t;
+
+	t = _mm256_subs_epu8(_mm256_sub_epi8(v, _mm256_set1_epi8('\t')),
+						 _mm256_set1_epi8(4));
+	return _mm256_or_si256(_mm256_cmpeq_epi8(t, _mm256_setzero_si256()),
+						   _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')));
+}
+
+AVX2_INLINE
+__m256i avx2_white_space_16(__m256i v)
+{
+	__m256i t;
+
+	t = _mm256_subs_epu16(_mm256_sub_epi16(v, _mm256_set1_epi16('\t')),
+						  _mm256_set1_epi16(4));
+	return _mm256_or_si256(_mm256_cmpeq_epi16(t, _mm256_setzero_si256()),
+						   _mm256_cmpeq_epi16(v, _mm256_set1_epi16(' ')));
+}
+
+AVX2_INLINE
+size_t find_avx2(const void *units,
+				 size_t len,
+				 size_t unit_size,
+				 fn_avx2_class *class,
+				 fn_units_find *tail)
+{
+	unsigned int mask;
+	size_t i, n;
+	__m256i v;
+	const char *p = units;
+
+	n = sizeof(v) / unit_size;
+	for (i = 0; i + n <= len; i += n) {
+		v = _mm256_loadu_si256((const __m256i *)&p[i * unit_size]);
+		mask = _mm256_movemask_epi8(class(v));
+		if (mask)
+			return i + __builtin_ctz(mask) / unit_size;
+	}
+	return i + tail(&p[i * unit_size], len - i);
+}
+
+AVX2_INLINE
+size_t span_avx2(const void *units,
+				 size_t len,
+				 size_t unit_size,
+				 bool *has_line_term,
+				 fn_avx2_class *white_space,
+				 fn_avx2_class *line_term,
+				 fn_units_span *tail)
+{
+	unsigned int ws, lt, end;
+	size_t i, n;
+	__m256i v;
+	const char *p = units;
+
+	n = sizeof(v) / unit_size;
+	for (i = 0; i + n <= len; i += n) {
+		v = _mm256_loadu_si256((const __m256i *)&p[i * unit_size]);
+		ws = _mm256_movemask_epi8(white_space(v));
+		lt = _mm256_movemask_epi8(line_term(v));
+		if (ws == 0xffffffff) {
+			if (lt)
+				*has_line_term = true;
+			continue;
+		}
+		end = __builtin_ctz(~ws);
+		if (lt & ((1u << end) - 1))
+			*has_line_term = true;
+		return i + end / unit_size;
+	}
+	return i + tail(&p[i * unit_size], len - i, has_line_term);
+}
+
+__attribute__((target("avx2")))
+static
+size_t find_line_term_8_avx2(const void *units,
+							 size_t len)
+{
+	return find_avx2(units, len, 1, avx2_line_term_8,
+					 find_line_term_8_scalar);
+}
+
+__attribute__((target("avx2")))
+static
+size_t find_line_term_16_avx2(const void *units,
+							  size_t len)
+{
+	return find_avx2(units, len, 2, avx2_line_term_16,
+					 find_line_term_16_scalar);
+}
+
+__attribute__((target("avx2")))
+static
+size_t find_star_or_line_term_8_avx2(const void *units,
+									 size_t len)
+{
+	return find_avx2(units, len, 1, avx2_star_or_line_term_8,
+					 find_star_or_line_term_8_scalar);
+}
+
+__attribute__((target("avx2")))
+static
+size_t find_star_or_line_term_16_avx2(const void *units,
+									  size_t len)
+{
+	return find_avx2(units, len, 2, avx2_star_or_line_term_16,
+					 find_star_or_line_term_16_scalar);
+}
+
+__attribute__((target("avx2")))
+static
+size_t find_string_stop_8_avx2(const void *units,
+							 size_t len)
+{
+	return find_avx2(units, len, 1, avx2_string_stop_8,
+					 find_string_stop_8_scalar);
+}
+
+__attribute__((target("avx2")))
+static
+size_t find_string_stop_16_avx2(const void *units,
+							  size_t len)
+{
+	return find_avx2(units, len, 2, avx2_string_stop_16,
+					 find_string_stop_16_scalar);
+}
+
+__attribute__((target("avx2")))
+static
+size_t find_template_stop_8_avx2(const void *units,
+								 size_t len)
+{
+	return find_avx2(units, len, 1, avx2_template_stop_8,
+					 find_template_stop_8_scalar);
+}
+
+__attribute__((target("avx2")))
+static
+size_t find_template_stop_16_avx2(const void *units,
+								  size_t len)
+{
+	return find_avx2(units, len, 2, avx2_template_stop_16,
+					 find_template_stop_16_scalar);
+}
+
+__attribute__((target("avx2")))
+static
+size_t span_white_space_8_avx2(const void *units,
+							   size_t len,
+							   bool *has_line_term)
+{
+	return span_avx2(units, len, 1, has_line_term, avx2_white_space_8,
+					 avx2_line_term_8, span_white_space_8_scalar);
+}
+
+__attribute__((target("avx2")))
+static
+size_t span_white_space_16_avx2(const void *units,
+								size_t len,
+								bool *has_line_term)
+{
+	return span_avx2(units, len, 2, has_line_term, avx2_white_space_16,
+					 avx2_line_term_16, span_white_space_16_scalar);
+}
+#endif
+/*******************************************************************/
+/* No state is cached; the cpu check is a load of a libgcc variable. */
+void units_get_ops(size_t unit_size,
+				   struct units_ops *ops)
+{
+	if (unit_size == 1) {
+		ops->find_line_term = find_line_term_8_scalar;
+		ops->find_star_or_line_term = find_star_or_line_term_8_scalar;
+		ops->find_string_stop = find_string_stop_8_scalar;
+		ops->find_template_stop = find_template_stop_8_scalar;
+		ops->span_white_space = span_white_space_8_scalar;
+	} else {
+		ops->find_line_term = find_line_term_16_scalar;
+		ops->find_star_or_line_term = find_star_or_line_term_16_scalar;
+		ops->find_string_stop = find_string_stop_16_scalar;
+		ops->find_template_stop = find_template_stop_16_scalar;
+		ops->span_white_space = span_white_space_16_scalar;
+	}
+#ifdef UNITS_X86
+	if (__builtin_cpu_supports("avx2") && unit_size == 1) {
+		ops->find_line_term = find_line_term_8_avx2;
+		ops->find_star_or_line_term = find_star_or_line_term_8_avx2;
+		ops->find_string_stop = find_string_stop_8_avx2;
+		ops->find_template_stop = find_template_stop_8_avx2;
+		ops->span_white_space = span_white_space_8_avx2;
+	} else if (__builtin_cpu_supports("avx2")) {
+		ops->find_line_term = find_line_term_16_avx2;
+		ops->find_star_or_line_term = find_star_or_line_term_16_avx2;
+		ops->find_string_stop = find_string_stop_16_avx2;
+		ops->find_template_stop = find_template_stop_16_avx2;
+		ops->span_white_space = span_white_space_16_avx2;
+	} else if (__builtin_cpu_supports("sse2") && unit_size == 1) {
+		ops->find_line_term = find_line_term_8_sse2;
+		ops->find_star_or_line_term = find_star_or_line_term_8_sse2;
+		ops->find_string_stop = find_string_stop_8_sse2;
+		ops->find_template_stop = find_template_stop_8_sse2;
+		ops->span_white_space = span_white_space_8_sse2;
+	} else if (__builtin_cpu_supports("sse2")) {
+		ops->find_line_term = find_line_term_16_sse2;
+		ops->find_star_or_line_term = find_star_or_line_term_16_sse2;
+		ops->find_string_stop = find_string_stop_16_sse2;
+		ops->find_template_stop = find_template_stop_16_sse2;
+		ops->span_white_space = span_white_space_16_sse2;
+	}
+#endif
+}
@@ -0,0 +1,313 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+#include <pub/utf8.h>
+#include <pub/unicode.h>
+#include <pub/error.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define UTF8_X86
+#endif
+
+/*
+ * The ASCII runs are handled by the vector kernels, 16 or 32 bytes at a time.
+ * Multi-byte sequences are validated and decoded by the scalar code, one
+ * code point at a time.
+ */
+
+/* Returns the # of leading ASCII bytes in src. */
+typedef size_t fn_ascii_span(const uint8_t *src,
+							 size_t len);
+
+/* Widens the leading ASCII bytes of src into dst. Returns their #. */
+typedef size_t fn_ascii_widen(const uint8_t *src,
+							  size_t len,
+							  char16_t *dst);
+
+struct utf8_ops {
+	fn_ascii_span	*span;
+	fn_ascii_widen	*widen;
+};
+/*******************************************************************/
+static
+size_t ascii_span_scalar(const uint8_t *src,
+						 size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len && src[i] < 0x80; ++i)
+		;
+	return i;
+}
+
+static
+size_t ascii_widen_scalar(const uint8_t *src,
+						  size_t len,
+						  char16_t *dst)
+{
+	size_t i;
+
+	for (i = 0; i < len && src[i] < 0x80; ++i)
+		dst[i] = src[i];
+	return i;
+}
+
+#ifdef UTF8_X86
+__attribute__((target("sse2")))
+static
+size_t ascii_span_sse2(const uint8_t *src,
+					   size_t len)
+{
+	int mask;
+	size_t i;
+	__m128i v;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		v = _mm_loadu_si128((const __m128i *)&src[i]);
+		mask = _mm_movemask_epi8(v);
+		if (mask)
+			return i + __builtin_ctz(mask);
+	}
+	return i + ascii_span_scalar(&src[i], len - i);
+}
+
+__attribute__((target("sse2")))
+static
+size_t ascii_widen_sse2(const uint8_t *src,
+						size_t len,
+						char16_t *dst)
+{
+	int mask;
+	size_t i;
+	__m128i v, zero;
+
+	zero = _mm_setzero_si128();
+	for (i = 0; i + 16 <= len; i += 16) {
+		v = _mm_loadu_si128((const __m128i *)&src[i]);
+		mask = _mm_movemask_epi8(v);
+		if (mask)
+			break;
+		_mm_storeu_si128((__m128i *)&dst[i], _mm_unpacklo_epi8(v, zero));
+		_mm_storeu_si128((__m128i *)&dst[i + 8], _mm_unpackhi_epi8(v, zero));
+	}
+	return i + ascii_widen_scalar(&src[i], len - i, &dst[i]);
+}
+
+__attribute__((target("avx2")))
+static
+size_t ascii_span_avx2(const uint8_t *src,
+					   size_t len)
+{
+	unsigned int mask;
+	size_t i;
+	__m256i v;
+
+	for (i = 0; i + 32 <= len; i += 32) {
+		v = _mm256_loadu_si256((const __m256i *)&src[i]);
+		mask = _mm256_movemask_epi8(v);
+		if (mask)
+			return i + __builtin_ctz(mask);
+	}
+	return i + ascii_span_scalar(&src[i], len - i);
+}
+
+__attribute__((target("avx2")))
+static
+size_t ascii_widen_avx2(const uint8_t *src,
+						size_t len,
+						char16_t *dst)
+{
+	size_t i;
+	__m128i lo, hi;
+	__m256i v;
+
+	for (i = 0; i + 32 <= len; i += 32) {
+		v = _mm256_loadu_si256((const __m256i *)&src[i]);
+		if (_mm256_movemask_epi8(v))
+			break;
+		lo = _mm256_castsi256_si128(v);
+		hi = _mm256_extracti128_si256(v, 1);
+		_mm256_storeu_si256((__m256i *)&dst[i], _mm256_cvtepu8_epi16(lo));
+		_mm256_storeu_si256((__m256i *)&dst[i + 16], _mm256_cvtepu8_epi16(hi));
+	}
+	return i + ascii_widen_scalar(&src[i], len - i, &dst[i]);
+}
+#endif
+
+/* No state is cached; the cpu check is a load of a libgcc variable. */
+static
+void utf8_get_ops(struct utf8_ops *ops)
+{
+	ops->span = ascii_span_scalar;
+	ops->widen = ascii_widen_scalar;
+#ifdef UTF8_X86
+	if (__builtin_cpu_supports("avx2")) {
+		ops->span = ascii_span_avx2;
+		ops->widen = ascii_widen_avx2;
+	} else if (__builtin_cpu_supports("sse2")) {
+		ops->span = ascii_span_sse2;
+		ops->widen = ascii_widen_sse2;
+	}
+#endif
+}
+/*******************************************************************/
+static inline
+bool is_cont(uint8_t b)
+{
+	return (b & 0xc0) == 0x80;
+}
+
+/*
+ * Validates and decodes a single multi-byte sequence. Returns the # of bytes
+ * in the sequence, or 0 if it is invalid, truncated, overlong, encodes a
+ * surrogate, or is beyond U+10FFFF.
+ */
+static
+size_t utf8_decode_seq(const uint8_t *src,
+					   size_t len,
+					   char32_t *out)
+{
+	uint8_t b0, lo, hi;
+	size_t n, i;
+	char32_t cp;
+
+	b0 = src[0];
+	lo = 0x80;
+	hi = 0xbf;
+	if (b0 >= 0xc2 && b0 <= 0xdf) {
+		n = 2;
+		cp = b0 & 0x1f;
+	} else if (b0 >= 0xe0 && b0 <= 0xef) {
+		n = 3;
+		cp = b0 & 0x0f;
+		if (b0 == 0xe0)
+			lo = 0xa0;	/* Overlong */
+		else if (b0 == 0xed)
+			hi = 0x9f;	/* Surrogates */
+	} else if (b0 >= 0xf0 && b0 <= 0xf4) {
+		n = 4;
+		cp = b0 & 0x07;
+		if (b0 == 0xf0)
+			lo = 0x90;	/* Overlong */
+		else if (b0 == 0xf4)
+			hi = 0x8f;	/* > U+10FFFF */
+	} else {
+		return 0;
+	}
+
+	if (len < n || src[1] < lo || src[1] > hi)
+		return 0;
+
+	for (i = 1; i < n; ++i) {
+		if (!is_cont(src[i]))
+			return 0;
+		cp = (cp << 6) | (src[i] & 0x3f);
+	}
+	*out = cp;
+	return n;
+}
+/*******************************************************************/
+int utf8_to_utf16_length(const char *src,
+						 size_t src_len,
+						 size_t *out_len,
+						 char32_t *out_max)
+{
+	size_t i, n, len;
+	char32_t cp, max;
+	const uint8_t *s;
+	struct utf8_ops ops;
+
+	utf8_get_ops(&ops);
+	s = (const uint8_t *)src;
+	max = len = 0;
+	i = 0;
+	while (i < src_len) {
+		if (s[i] < 0x80) {
+			n = ops.span(&s[i], src_len - i);
+			i += n;
+			len += n;
+			continue;
+		}
+
+		n = utf8_decode_seq(&s[i], src_len - i, &cp);
+		if (n == 0)
+			return ERR_BAD_FILE;
+		i += n;
+		len += is_astral(cp) ? 2 : 1;
+		max = cp > max ? cp : max;
+	}
+
+	/* Only multi-byte seqs update max. */
+	if (max == 0 && src_len)
+		max = 0x7f;
+	*out_len = len;
+	*out_max = max;
+	return ERR_SUCCESS;
+}
+
+size_t utf8_to_utf16(const char *src,
+					 size_t src_len,
+					 char16_t *dst)
+{
+	size_t i, n, len;
+	char32_t cp;
+	const uint8_t *s;
+	struct utf8_ops ops;
+
+	utf8_get_ops(&ops);
+	s = (const uint8_t *)src;
+	len = 0;
+	i = 0;
+	while (i < src_len) {
+		if (s[i] < 0x80) {
+			n = ops.widen(&s[i], src_len - i, &dst[len]);
+			i += n;
+			len += n;
+			continue;
+		}
+
+		n = utf8_decode_seq(&s[i], src_len - i, &cp);
+		assert(n);
+		i += n;
+		encode_code_point(cp, &dst[len]);
+		len += is_astral(cp) ? 2 : 1;
+	}
+	return len;
+}
+
+size_t utf8_to_latin1(const char *src,
+					  size_t src_len,
+					  uint8_t *dst)
+{
+	size_t i, n, len;
+	char32_t cp;
+	const uint8_t *s;
+	struct utf8_ops ops;
+
+	utf8_get_ops(&ops);
+	s = (const uint8_t *)src;
+	len = 0;
+	i = 0;
+	while (i < src_len) {
+		if (s[i] < 0x80) {
+			n = ops.span(&s[i], src_len - i);
+			memcpy(&dst[len], &s[i], n);
+			i += n;
+			len += n;
+			continue;
+		}
+
+		n = utf8_decode_seq(&s[i], src_len - i, &cp);
+		assert(n && cp <= 0xff);
+		i += n;
+		dst[len++] = cp;
+	}
+	return len;
+}
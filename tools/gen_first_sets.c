@@ -0,0 +1,240 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+/*
+ * Builds the FIRST sets of prv/first_sets.h from the grammar in
+ * tools/grammar.h; the parser rules out, without reading further, the
+ * non-terminals that can't start with the token at hand.
+ *
+ * The sets are grown until none changes. A non-terminal that can derive the
+ * empty string, or that has no productions, may start with anything; its set
+ * is full, TOKEN_INVALID included. A set then has the rest of the goal groups
+ * of its tokens. The exclusions of a non-terminal are kept out of its set as
+ * it grows, and thus out of the sets of its users.
+ *
+ * Usage: gen_first_sets out.h
+ */
+
+#include "grammar.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define NUM_TERMINALS	SCRIPT
+#define NUM_WORDS		((NUM_TERMINALS + 63) / 64)
+#define ARRAY_SIZE(a)	(sizeof(a) / sizeof((a)[0]))
+
+struct set {
+	uint64_t	words[NUM_WORDS];
+};
+
+static struct set	g_sets[NUM_SYMBOLS];
+static struct set	g_exclusion_sets[NUM_SYMBOLS];
+static bool			g_is_nullable[NUM_SYMBOLS];
+static bool			g_has_productions[NUM_SYMBOLS];
+
+static
+bool set_has(const struct set *this,
+			 int type)
+{
+	return (this->words[type / 64] >> (type % 64)) & 1;
+}
+
+static
+bool set_add(struct set *this,
+			 int type)
+{
+	if (set_has(this, type))
+		return false;
+	this->words[type / 64] |= 1ull << (type % 64);
+	return true;
+}
+
+/* Leaves out the tokens in the mask. */
+static
+bool set_merge(struct set *this,
+			   const struct set *other,
+			   const struct set *mask)
+{
+	int i;
+	uint64_t words;
+	bool is_grown = false;
+
+	for (i = 0; i < NUM_WORDS; ++i) {
+		words = this->words[i] | (other->words[i] & ~mask->words[i]);
+		is_grown |= words != this->words[i];
+		this->words[i] = words;
+	}
+	return is_grown;
+}
+
+static
+void set_fill(struct set *this)
+{
+	int i;
+
+	memset(this, 0, sizeof(*this));
+	for (i = TOKEN_INVALID; i < NUM_TERMINALS; ++i)
+		set_add(this, i);
+}
+/*******************************************************************/
+static
+bool grow_production(const struct production *this)
+{
+	int i, sym;
+	struct set *set;
+	const struct set *mask;
+	bool is_grown = false;
+
+	set = &g_sets[this->lhs];
+	mask = &g_exclusion_sets[this->lhs];
+	for (i = 0; i < MAX_RHS; ++i) {
+		sym = this->rhs[i];
+		if (sym == TOKEN_INVALID)
+			break;
+		if (sym < NUM_TERMINALS) {
+			if (!set_has(mask, sym))
+				is_grown |= set_add(set, sym);
+			return is_grown;
+		}
+		is_grown |= set_merge(set, &g_sets[sym], mask);
+		if (!g_is_nullable[sym])
+			return is_grown;
+	}
+
+	if (!g_is_nullable[this->lhs]) {
+		g_is_nullable[this->lhs] = true;
+		is_grown = true;
+	}
+	return is_grown;
+}
+
+static
+void build(void)
+{
+	size_t i;
+	int type;
+	bool is_grown;
+	const struct token_range *range;
+	const struct exclusion *exclusion;
+	const uint16_t *group;
+
+	for (i = 0; i < ARRAY_SIZE(g_productions); ++i)
+		g_has_productions[g_productions[i].lhs] = true;
+
+	for (i = 0; i < ARRAY_SIZE(g_exclusions); ++i) {
+		exclusion = &g_exclusions[i];
+		set_add(&g_exclusion_sets[exclusion->lhs], exclusion->token);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(g_token_ranges); ++i) {
+		range = &g_token_ranges[i];
+		g_has_productions[range->lhs] = true;
+		for (type = range->first; type <= range->last; ++type)
+			set_add(&g_sets[range->lhs], type);
+	}
+
+	do {
+		is_grown = false;
+		for (i = 0; i < ARRAY_SIZE(g_productions); ++i)
+			is_grown |= grow_production(&g_productions[i]);
+	} while (is_grown);
+
+	for (type = SCRIPT; type < NUM_SYMBOLS; ++type) {
+		if (g_is_nullable[type] || !g_has_productions[type]) {
+			set_fill(&g_sets[type]);
+			continue;
+		}
+
+		for (i = 0; i < ARRAY_SIZE(g_goal_groups); ++i) {
+			group = g_goal_groups[i];
+			if (set_has(&g_sets[type], group[0]) ||
+				set_has(&g_sets[type], group[1]) ||
+				set_has(&g_sets[type], group[2])) {
+				set_add(&g_sets[type], group[0]);
+				set_add(&g_sets[type], group[1]);
+				set_add(&g_sets[type], group[2]);
+			}
+		}
+	}
+}
+/*******************************************************************/
+static
+void emit(FILE *file)
+{
+	int type, i;
+
+	fprintf(file,
+			"/* SPDX-License-Identifier: GPL-3.0-or-later */\n"
+			"/* Copyright (c) 2023 Amol Surati */\n\n"
+			"/* Generated by tools/gen_first_sets.c. Do not edit. */\n\n"
+			"#ifndef PRV_FIRST_SETS_H\n"
+			"#define PRV_FIRST_SETS_H\n\n"
+			"#include <prv/scanner.h>\n\n"
+			"#include <assert.h>\n"
+			"#include <stdint.h>\n"
+			"#include <stdbool.h>\n\n"
+			"#define FIRST_SET_WORDS\t%d\n\n"
+			"static_assert(SCRIPT == %d && LAST_NON_TERMINAL == %d,\n"
+			"\t\t\t  \"Run the first_sets target\");\n\n",
+			NUM_WORDS, SCRIPT, LAST_NON_TERMINAL);
+
+	fprintf(file, "/* [type - SCRIPT] = the token types that may start it */\n"
+			"static const\n"
+			"uint64_t g_first_sets[%d][FIRST_SET_WORDS] = {\n",
+			LAST_NON_TERMINAL - SCRIPT + 1);
+
+	for (type = SCRIPT; type <= LAST_NON_TERMINAL; ++type) {
+		fprintf(file, "\t{");
+		for (i = 0; i < NUM_WORDS; ++i)
+			fprintf(file, "%s0x%016llx", i ? ", " : "",
+					(unsigned long long)g_sets[type].words[i]);
+		fprintf(file, "},\t/* %d%s */\n", type - SCRIPT,
+				set_has(&g_sets[type], TOKEN_INVALID) ? ", any" : "");
+	}
+	fprintf(file, "};\n\n");
+
+	fprintf(file,
+			"/* Its set has TOKEN_INVALID iff it may start with any token. */\n"
+			"static inline\n"
+			"bool first_set_is_any(enum token_type type)\n"
+			"{\n"
+			"\tassert(type >= SCRIPT && type <= LAST_NON_TERMINAL);\n"
+			"\treturn g_first_sets[type - SCRIPT][0] & 1;\n"
+			"}\n\n");
+
+	fprintf(file,
+			"static inline\n"
+			"bool first_set_has(enum token_type type,\n"
+			"\t\t\t\t   enum token_type first)\n"
+			"{\n"
+			"\tconst uint64_t *set;\n\n"
+			"\tassert(type >= SCRIPT && type <= LAST_NON_TERMINAL);\n"
+			"\tassert(first < SCRIPT);\n"
+			"\tset = g_first_sets[type - SCRIPT];\n"
+			"\treturn (set[first / 64] >> (first %% 64)) & 1;\n"
+			"}\n"
+			"#endif\n");
+}
+
+int main(int argc, char **argv)
+{
+	FILE *file;
+
+	if (argc != 2) {
+		fprintf(stderr, "%s: Usage: %s out.h\n", __func__, argv[0]);
+		return 1;
+	}
+
+	file = fopen(argv[1], "w");
+	if (file == NULL) {
+		fprintf(stderr, "%s: Error: Opening %s\n", __func__, argv[1]);
+		return 1;
+	}
+	build();
+	emit(file);
+	fclose(file);
+	return 0;
+}
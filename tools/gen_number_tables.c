@@ -0,0 +1,234 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+/*
+ * Builds the 128-bit powers of five of pub/number_tables.h, which the
+ * Eisel-Lemire conversion in src/number.c multiplies the decimal significand
+ * with.
+ *
+ * For q >= 0, the entry is 5^q, shifted so that its top bit is at bit 127,
+ * and truncated to 128 bits. For q < 0, it is 2^b / 5^-q, plus 1, truncated
+ * to 128 bits; i.e. a slight over-estimate of the reciprocal.
+ *
+ * Usage: gen_number_tables out.h
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define SMALLEST_POWER	(-342)
+#define LARGEST_POWER	308
+#define NUM_LIMBS		64	/* 2048 bits; 2^b for q = -342 needs ~1720. */
+
+/* Little-endian 32-bit limbs. */
+struct big {
+	uint32_t	limbs[NUM_LIMBS];
+};
+
+static
+size_t big_bit_length(const struct big *this)
+{
+	size_t i;
+
+	for (i = NUM_LIMBS; i-- > 0;)
+		if (this->limbs[i])
+			return i * 32 + 32 - __builtin_clz(this->limbs[i]);
+	return 0;
+}
+
+static
+bool big_bit(const struct big *this,
+			 size_t i)
+{
+	return (this->limbs[i / 32] >> (i % 32)) & 1;
+}
+
+static
+void big_mul_small(struct big *this,
+				   uint32_t m)
+{
+	size_t i;
+	uint64_t carry;
+
+	carry = 0;
+	for (i = 0; i < NUM_LIMBS; ++i) {
+		carry += (uint64_t)this->limbs[i] * m;
+		this->limbs[i] = carry;
+		carry >>= 32;
+	}
+}
+
+static
+void big_shr(struct big *this,
+			 size_t n)
+{
+	size_t i;
+	struct big r;
+
+	memset(&r, 0, sizeof(r));
+	for (i = n; i < NUM_LIMBS * 32; ++i)
+		if (big_bit(this, i))
+			r.limbs[(i - n) / 32] |= 1u << ((i - n) % 32);
+	*this = r;
+}
+
+static
+void big_shl(struct big *this,
+			 size_t n)
+{
+	size_t i;
+	struct big r;
+
+	memset(&r, 0, sizeof(r));
+	for (i = 0; i + n < NUM_LIMBS * 32; ++i)
+		if (big_bit(this, i))
+			r.limbs[(i + n) / 32] |= 1u << ((i + n) % 32);
+	*this = r;
+}
+
+static
+int big_cmp(const struct big *a,
+			const struct big *b)
+{
+	size_t i;
+
+	for (i = NUM_LIMBS; i-- > 0;)
+		if (a->limbs[i] != b->limbs[i])
+			return a->limbs[i] < b->limbs[i] ? -1 : 1;
+	return 0;
+}
+
+static
+void big_sub(struct big *this,
+			 const struct big *b)
+{
+	size_t i;
+	uint64_t borrow, d;
+
+	borrow = 0;
+	for (i = 0; i < NUM_LIMBS; ++i) {
+		d = (uint64_t)this->limbs[i] - b->limbs[i] - borrow;
+		this->limbs[i] = d;
+		borrow = (d >> 32) & 1;
+	}
+}
+
+static
+void big_add_one(struct big *this)
+{
+	size_t i;
+
+	for (i = 0; i < NUM_LIMBS && ++this->limbs[i] == 0; ++i)
+		;
+}
+
+/* 2^b / d, by shift and subtract. */
+static
+void big_pow2_div(size_t b,
+				  const struct big *d,
+				  struct big *out)
+{
+	size_t i;
+	struct big r;
+
+	memset(&r, 0, sizeof(r));
+	memset(out, 0, sizeof(*out));
+	for (i = b + 1; i-- > 0;) {
+		big_shl(&r, 1);
+		r.limbs[0] |= i == b;
+		if (big_cmp(&r, d) >= 0) {
+			big_sub(&r, d);
+			out->limbs[i / 32] |= 1u << (i % 32);
+		}
+	}
+}
+
+static
+void emit_entry(FILE *file,
+				const struct big *v,
+				int q)
+{
+	uint64_t hi, lo;
+
+	hi = (uint64_t)v->limbs[3] << 32 | v->limbs[2];
+	lo = (uint64_t)v->limbs[1] << 32 | v->limbs[0];
+	fprintf(file, "\t{0x%016llx, 0x%016llx},\t/* %d */\n",
+			(unsigned long long)hi, (unsigned long long)lo, q);
+}
+
+static
+void emit(FILE *file)
+{
+	int q, i;
+	size_t z, len;
+	struct big p, c;
+
+	fprintf(file,
+			"/* SPDX-License-Identifier: GPL-3.0-or-later */\n"
+			"/* Copyright (c) 2023 Amol Surati */\n\n"
+			"/* Generated by tools/gen_number_tables.c. Do not edit. */\n\n"
+			"#ifndef PUB_NUMBER_TABLES_H\n"
+			"#define PUB_NUMBER_TABLES_H\n\n"
+			"#include <stdint.h>\n\n"
+			"#define POW5_SMALLEST\t(%d)\n"
+			"#define POW5_LARGEST\t%d\n\n", SMALLEST_POWER, LARGEST_POWER);
+
+	fprintf(file, "/* [q - POW5_SMALLEST] = {hi, lo} of 5^q */\n"
+			"static const\n"
+			"uint64_t g_pow5_128[%d][2] = {\n",
+			LARGEST_POWER - SMALLEST_POWER + 1);
+
+	for (q = SMALLEST_POWER; q < 0; ++q) {
+		memset(&p, 0, sizeof(p));
+		p.limbs[0] = 1;
+		for (i = 0; i < -q; ++i)
+			big_mul_small(&p, 5);
+
+		/* z is the least, such that 2^z >= 5^-q. */
+		z = big_bit_length(&p);
+		if (q >= -27)
+			big_pow2_div(z + 127, &p, &c);
+		else
+			big_pow2_div(2 * z + 128, &p, &c);
+		big_add_one(&c);
+		len = big_bit_length(&c);
+		if (len > 128)
+			big_shr(&c, len - 128);
+		emit_entry(file, &c, q);
+	}
+
+	for (q = 0; q <= LARGEST_POWER; ++q) {
+		memset(&p, 0, sizeof(p));
+		p.limbs[0] = 1;
+		for (i = 0; i < q; ++i)
+			big_mul_small(&p, 5);
+		len = big_bit_length(&p);
+		if (len > 128)
+			big_shr(&p, len - 128);
+		else
+			big_shl(&p, 128 - len);
+		emit_entry(file, &p, q);
+	}
+	fprintf(file, "};\n#endif\n");
+}
+
+int main(int argc, char **argv)
+{
+	FILE *file;
+
+	if (argc != 2) {
+		fprintf(stderr, "%s: Usage: %s out.h\n", __func__, argv[0]);
+		return 1;
+	}
+
+	file = fopen(argv[1], "w");
+	if (file == NULL) {
+		fprintf(stderr, "%s: Error: Opening %s\n", __func__, argv[1]);
+		return 1;
+	}
+	emit(file);
+	fclose(file);
+	return 0;
+}
@@ -0,0 +1,137 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+/*
+ * Builds the two-stage ID_Start/ID_Continue bitmaps of pub/unicode_tables.h
+ * from the run-length encoded properties in tools/unicode_ids.h.
+ *
+ * The code points are split into blocks of 256. Stage 1 maps cp >> 8 to a
+ * block index. Stage 2 holds each distinct block once, as a 256-bit ID_Start
+ * bitmap followed by a 256-bit ID_Continue bitmap; i.e. one 64-byte cache
+ * line per block.
+ *
+ * Usage: gen_unicode_tables out.h
+ */
+
+#include <tools/unicode_ids.h>
+
+#include <pub/system.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define NUM_CODE_POINTS	0x110000
+#define BLOCK_SHIFT		8
+#define BLOCK_SIZE		(1 << BLOCK_SHIFT)
+#define NUM_BLOCKS		(NUM_CODE_POINTS >> BLOCK_SHIFT)
+#define BLOCK_WORDS		(2 * BLOCK_SIZE / 32)
+
+static uint32_t g_blocks[NUM_BLOCKS][BLOCK_WORDS];
+static uint32_t g_stage1[NUM_BLOCKS];
+static size_t g_num_unique;
+
+static
+void set_bit(char32_t cp,
+			 size_t word_offset)
+{
+	g_blocks[cp >> BLOCK_SHIFT][word_offset + (cp & 0xff) / 32] |=
+		1u << (cp & 31);
+}
+
+static
+void set_bits(const char32_t *cps,
+			  size_t size,
+			  size_t word_offset)
+{
+	size_t i;
+	char32_t cp, end;
+
+	for (i = 0; i < size; i += 2) {
+		end = cps[i] + cps[i + 1];
+		for (cp = cps[i]; cp < end; ++cp)
+			set_bit(cp, word_offset);
+	}
+}
+
+/* Dedup the blocks in place; the unique ones move to the front. */
+static
+void build_stages(void)
+{
+	size_t i, j;
+
+	for (i = 0; i < NUM_BLOCKS; ++i) {
+		for (j = 0; j < g_num_unique; ++j)
+			if (!memcmp(g_blocks[i], g_blocks[j], sizeof(g_blocks[i])))
+				break;
+		if (j == g_num_unique)
+			memmove(g_blocks[g_num_unique++], g_blocks[i],
+					sizeof(g_blocks[i]));
+		g_stage1[i] = j;
+	}
+}
+
+static
+void emit(FILE *file)
+{
+	size_t i, j;
+
+	fprintf(file,
+			"/* SPDX-License-Identifier: GPL-3.0-or-later */\n"
+			"/* Copyright (c) 2023 Amol Surati */\n\n"
+			"/* Generated by tools/gen_unicode_tables.c. Do not edit. */\n\n"
+			"#ifndef PUB_UNICODE_TABLES_H\n"
+			"#define PUB_UNICODE_TABLES_H\n\n"
+			"#include <stdint.h>\n\n"
+			"#define ID_BLOCK_SHIFT\t\t%d\n"
+			"#define ID_START_WORD\t\t0\n"
+			"#define ID_CONTINUE_WORD\t%d\n\n", BLOCK_SHIFT, BLOCK_WORDS / 2);
+
+	fprintf(file, "static const\nuint%d_t g_id_stage1[%d] = {",
+			g_num_unique > 256 ? 16 : 8, NUM_BLOCKS);
+	for (i = 0; i < NUM_BLOCKS; ++i)
+		fprintf(file, "%s%zu,", i % 16 ? " " : "\n\t", (size_t)g_stage1[i]);
+	fprintf(file, "\n};\n\n");
+
+	fprintf(file, "/* [block][0..7] = ID_Start, [block][8..15] = ID_Continue */\n"
+			"static const _Alignas(64)\n"
+			"uint32_t g_id_stage2[%zu][%d] = {\n", g_num_unique, BLOCK_WORDS);
+	for (i = 0; i < g_num_unique; ++i) {
+		fprintf(file, "\t{\t/* %zu */", i);
+		for (j = 0; j < BLOCK_WORDS; ++j)
+			fprintf(file, "%s0x%08x,", j % 4 ? " " : "\n\t\t", g_blocks[i][j]);
+		fprintf(file, "\n\t},\n");
+	}
+	fprintf(file, "};\n#endif\n");
+}
+
+int main(int argc, char **argv)
+{
+	FILE *file;
+
+	if (argc != 2) {
+		fprintf(stderr, "%s: Usage: %s out.h\n", __func__, argv[0]);
+		return 1;
+	}
+
+	/*
+	 * ID_Continue is a superset of ID_Start. Also, <ZWNJ> and <ZWJ> are
+	 * IdentifierPartChars.
+	 */
+	set_bits(g_id_start, ARRAY_SIZE(g_id_start), 0);
+	set_bits(g_id_start, ARRAY_SIZE(g_id_start), BLOCK_WORDS / 2);
+	set_bits(g_id_continue, ARRAY_SIZE(g_id_continue), BLOCK_WORDS / 2);
+	set_bit(0x200c, BLOCK_WORDS / 2);
+	set_bit(0x200d, BLOCK_WORDS / 2);
+	build_stages();
+
+	file = fopen(argv[1], "w");
+	if (file == NULL) {
+		fprintf(stderr, "%s: Error: Opening %s\n", __func__, argv[1]);
+		return 1;
+	}
+	emit(file);
+	fclose(file);
+	return 0;
+}
@@ -0,0 +1,263 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Amol Surati */
+
+#ifndef TOOLS_GRAMMAR_H
+#define TOOLS_GRAMMAR_H
+
+#include <prv/scanner.h>
+
+#include <stdint.h>
+
+/*
+ * The syntactic grammar, as far as the FIRST sets of its non-terminals need
+ * it. This is the input to gen_first_sets, which builds prv/first_sets.h
+ * from it. When the parser grows a non-terminal, or changes how it derives
+ * one, update these and run the first_sets target.
+ *
+ * A production is cut after its first symbol that can't derive the empty
+ * string; the rest does not change the FIRST set. An empty rhs is the empty
+ * string. The rhs ends at the first TOKEN_INVALID.
+ *
+ * The non-terminals of the parser without a type of their own (e.g. the
+ * literals) are folded into their users. The sets are
+ * supersets where the parser is stricter, e.g. on reserved words used as
+ * identifiers; they only rule out the alternatives that can't match.
+ */
+
+/* Used only here. */
+enum {
+	G_IDENTIFIER = LAST_NON_TERMINAL + 1,	/* Identifier, yield, await */
+	G_LITERAL,
+	NUM_SYMBOLS,
+};
+
+#define MAX_RHS	3
+
+struct production {
+	uint16_t	lhs;
+	uint16_t	rhs[MAX_RHS];
+};
+
+static const
+struct production g_productions[] = {
+	{SCRIPT,					{0}},
+	{SCRIPT,					{SCRIPT_BODY}},
+	{SCRIPT_BODY,				{STATEMENT_LIST}},
+	{STATEMENT_LIST,			{STATEMENT_LIST_ITEM}},
+	{STATEMENT_LIST_ITEM,		{STATEMENT}},
+	{STATEMENT_LIST_ITEM,		{DECLARATION}},
+
+	{STATEMENT,					{BLOCK_STATEMENT}},
+	{STATEMENT,					{VARIABLE_STATEMENT}},
+	{STATEMENT,					{EMPTY_STATEMENT}},
+	{STATEMENT,					{EXPRESSION_STATEMENT}},
+	{STATEMENT,					{IF_STATEMENT}},
+	{STATEMENT,					{BREAKABLE_STATEMENT}},
+	{STATEMENT,					{CONTINUE_STATEMENT}},
+	{STATEMENT,					{BREAK_STATEMENT}},
+	{STATEMENT,					{RETURN_STATEMENT}},
+	{STATEMENT,					{WITH_STATEMENT}},
+	{STATEMENT,					{LABELLED_STATEMENT}},
+	{STATEMENT,					{THROW_STATEMENT}},
+	{STATEMENT,					{TRY_STATEMENT}},
+	{STATEMENT,					{DEBUGGER_STATEMENT}},
+
+	/* Hoistable, class and lexical declarations. */
+	{DECLARATION,				{TOKEN_FUNCTION}},
+	{DECLARATION,				{TOKEN_ASYNC}},
+	{DECLARATION,				{TOKEN_CLASS}},
+	{DECLARATION,				{TOKEN_LET}},
+	{DECLARATION,				{TOKEN_CONST}},
+
+	{BLOCK_STATEMENT,			{BLOCK}},
+	{BLOCK,						{TOKEN_LEFT_BRACE}},
+	{VARIABLE_STATEMENT,		{TOKEN_VAR}},
+	{EMPTY_STATEMENT,			{TOKEN_SEMI_COLON}},
+	{EXPRESSION_STATEMENT,		{EXPRESSION}},
+	{IF_STATEMENT,				{TOKEN_IF}},
+	{BREAKABLE_STATEMENT,		{TOKEN_DO}},
+	{BREAKABLE_STATEMENT,		{TOKEN_WHILE}},
+	{BREAKABLE_STATEMENT,		{TOKEN_FOR}},
+	{BREAKABLE_STATEMENT,		{TOKEN_SWITCH}},
+	{CONTINUE_STATEMENT,		{TOKEN_CONTINUE}},
+	{BREAK_STATEMENT,			{TOKEN_BREAK}},
+	{RETURN_STATEMENT,			{TOKEN_RETURN}},
+	{WITH_STATEMENT,			{TOKEN_WITH}},
+	{LABELLED_STATEMENT,		{G_IDENTIFIER}},
+	{THROW_STATEMENT,			{TOKEN_THROW}},
+	{TRY_STATEMENT,				{TOKEN_TRY}},
+	{DEBUGGER_STATEMENT,		{TOKEN_DEBUGGER}},
+
+	{VARIABLE_DECLARATION_LIST,	{VARIABLE_DECLARATION}},
+	{VARIABLE_DECLARATION,		{BINDING_IDENTIFIER}},
+	{VARIABLE_DECLARATION,		{BINDING_PATTERN}},
+	{BINDING_IDENTIFIER,		{G_IDENTIFIER}},
+	{BINDING_PATTERN,			{TOKEN_LEFT_BRACE}},
+	{BINDING_PATTERN,			{TOKEN_LEFT_BRACKET}},
+	{INITIALIZER,				{TOKEN_EQUALS}},
+
+	/* What a cover of arrow parameters is reinterpreted as. */
+	{FORMAL_PARAMETERS,			{0}},
+	{FORMAL_PARAMETERS,			{BINDING_ELEMENT}},
+	{FORMAL_PARAMETERS,			{BINDING_REST_ELEMENT}},
+	{BINDING_ELEMENT,			{BINDING_IDENTIFIER}},
+	{BINDING_ELEMENT,			{BINDING_PATTERN}},
+	{BINDING_REST_ELEMENT,		{TOKEN_ELLIPSIS}},
+
+	{EXPRESSION,				{ASSIGNMENT_EXPRESSION}},
+	{ASSIGNMENT_EXPRESSION,		{CONDITIONAL_EXPRESSION}},
+	{ASSIGNMENT_EXPRESSION,		{YIELD_EXPRESSION}},
+	{ASSIGNMENT_EXPRESSION,		{ARROW_FUNCTION}},
+	{ASSIGNMENT_EXPRESSION,		{ASYNC_ARROW_FUNCTION}},
+	{ASSIGNMENT_EXPRESSION,		{LHS_EXPRESSION}},
+	{YIELD_EXPRESSION,			{TOKEN_YIELD}},
+	{ARROW_FUNCTION,			{G_IDENTIFIER}},
+	{ARROW_FUNCTION,			{TOKEN_LEFT_PAREN}},
+	{ASYNC_ARROW_FUNCTION,		{TOKEN_ASYNC}},
+
+	/* ShortCircuitExpression, down to UnaryExpression; #x in y. */
+	{CONDITIONAL_EXPRESSION,	{BINARY_EXPRESSION}},
+	{BINARY_EXPRESSION,			{UNARY_EXPRESSION}},
+	{BINARY_EXPRESSION,			{PRIVATE_IDENTIFIER}},
+	{UNARY_EXPRESSION,			{UPDATE_EXPRESSION}},
+	{UNARY_EXPRESSION,			{TOKEN_DELETE}},
+	{UNARY_EXPRESSION,			{TOKEN_VOID}},
+	{UNARY_EXPRESSION,			{TOKEN_TYPEOF}},
+	{UNARY_EXPRESSION,			{TOKEN_PLUS}},
+	{UNARY_EXPRESSION,			{TOKEN_MINUS}},
+	{UNARY_EXPRESSION,			{TOKEN_BITWISE_NOT}},
+	{UNARY_EXPRESSION,			{TOKEN_LOGICAL_NOT}},
+	{UNARY_EXPRESSION,			{TOKEN_AWAIT}},
+	{UPDATE_EXPRESSION,			{LHS_EXPRESSION}},
+	{UPDATE_EXPRESSION,			{TOKEN_INC}},
+	{UPDATE_EXPRESSION,			{TOKEN_DEC}},
+
+	{LHS_EXPRESSION,			{NEW_EXPRESSION}},
+	{LHS_EXPRESSION,			{CALL_EXPRESSION}},
+	{LHS_EXPRESSION,			{OPTIONAL_EXPRESSION}},
+	{OPTIONAL_EXPRESSION,		{MEMBER_EXPRESSION}},
+	{OPTIONAL_EXPRESSION,		{CALL_EXPRESSION}},
+	{OPTIONAL_CHAIN,			{TOKEN_QUESTION_DOT}},
+	{CALL_EXPRESSION,			{CALL_MEMBER_EXPRESSION}},
+	{CALL_EXPRESSION,			{SUPER_CALL}},
+	{CALL_EXPRESSION,			{IMPORT_CALL}},
+	{CALL_MEMBER_EXPRESSION,	{MEMBER_EXPRESSION}},
+	{SUPER_CALL,				{TOKEN_SUPER}},
+	{IMPORT_CALL,				{TOKEN_IMPORT}},
+	{NEW_EXPRESSION,			{MEMBER_EXPRESSION}},
+	{NEW_EXPRESSION,			{TOKEN_NEW}},
+	{MEMBER_EXPRESSION,			{PRIMARY_EXPRESSION}},
+	{MEMBER_EXPRESSION,			{SUPER_PROPERTY}},
+	{MEMBER_EXPRESSION,			{META_PROPERTY}},
+	{MEMBER_EXPRESSION,			{TOKEN_NEW}},
+	{SUPER_PROPERTY,			{TOKEN_SUPER}},
+	{META_PROPERTY,				{NEW_TARGET}},
+	{META_PROPERTY,				{IMPORT_META}},
+	{NEW_TARGET,				{TOKEN_NEW}},
+	{IMPORT_META,				{TOKEN_IMPORT}},
+	{ARGUMENTS,					{TOKEN_LEFT_PAREN}},
+
+	/* The parser's loops over the tails; each needs one. */
+	{MEMBER_EXPRESSION_POST,	{ARRAY_EXPRESSION}},
+	{MEMBER_EXPRESSION_POST,	{TEMPLATE_LITERAL}},
+	{MEMBER_EXPRESSION_POST,	{DOT_IDENTIFIER_NAME}},
+	{MEMBER_EXPRESSION_POST,	{DOT_PRIVATE_IDENTIFIER}},
+	{CALL_EXPRESSION_POST,		{MEMBER_EXPRESSION_POST}},
+	{CALL_EXPRESSION_POST,		{ARGUMENTS}},
+	{OPTIONAL_CHAIN_POST,		{CALL_EXPRESSION_POST}},
+	{ARRAY_EXPRESSION,			{TOKEN_LEFT_BRACKET}},
+	{DOT_IDENTIFIER_NAME,		{TOKEN_DOT}},
+	{DOT_PRIVATE_IDENTIFIER,	{TOKEN_DOT}},
+	{PRIVATE_IDENTIFIER,		{TOKEN_NUMBER_SIGN}},
+
+	{PRIMARY_EXPRESSION,		{TOKEN_THIS}},
+	{PRIMARY_EXPRESSION,		{IDENTIFIER_REFERENCE}},
+	{PRIMARY_EXPRESSION,		{G_LITERAL}},
+	{PRIMARY_EXPRESSION,		{ARRAY_LITERAL}},
+	{PRIMARY_EXPRESSION,		{OBJECT_LITERAL}},
+	{PRIMARY_EXPRESSION,		{FUNCTION_EXPRESSION}},
+	{PRIMARY_EXPRESSION,		{CLASS_EXPRESSION}},
+	{PRIMARY_EXPRESSION,		{GENERATOR_EXPRESSION}},
+	{PRIMARY_EXPRESSION,		{ASYNC_FUNCTION_EXPRESSION}},
+	{PRIMARY_EXPRESSION,		{ASYNC_GENERATOR_EXPRESSION}},
+	{PRIMARY_EXPRESSION,		{REGEXP_LITERAL}},
+	{PRIMARY_EXPRESSION,		{TEMPLATE_LITERAL}},
+	{PRIMARY_EXPRESSION,		{PARENTHESIZED_EXPRESSION}},
+	{G_LITERAL,					{TOKEN_NULL}},
+	{G_LITERAL,					{TOKEN_TRUE}},
+	{G_LITERAL,					{TOKEN_FALSE}},
+	{G_LITERAL,					{NUMERIC_LITERAL}},
+	{G_LITERAL,					{STRING_LITERAL}},
+	{NUMERIC_LITERAL,			{TOKEN_NUMBER}},
+	{STRING_LITERAL,			{TOKEN_STRING}},
+	{ARRAY_LITERAL,				{TOKEN_LEFT_BRACKET}},
+	{OBJECT_LITERAL,			{TOKEN_LEFT_BRACE}},
+	{FUNCTION_EXPRESSION,		{TOKEN_FUNCTION}},
+	{CLASS_EXPRESSION,			{TOKEN_CLASS}},
+	{GENERATOR_EXPRESSION,		{TOKEN_FUNCTION}},
+	{ASYNC_FUNCTION_EXPRESSION,	{TOKEN_ASYNC}},
+	{ASYNC_GENERATOR_EXPRESSION,	{TOKEN_ASYNC}},
+	{REGEXP_LITERAL,			{TOKEN_REG_EXP}},
+	{TEMPLATE_LITERAL,			{TOKEN_TEMPLATE}},
+	{TEMPLATE_LITERAL,			{TOKEN_TEMPLATE_HEAD}},
+	{PARENTHESIZED_EXPRESSION,	{TOKEN_LEFT_PAREN}},
+	{IDENTIFIER_REFERENCE,		{G_IDENTIFIER}},
+
+	/* The contextual words, and those reserved only in strict mode code. */
+	{G_IDENTIFIER,				{TOKEN_IDENTIFIER}},
+	{G_IDENTIFIER,				{TOKEN_AS}},
+	{G_IDENTIFIER,				{TOKEN_ASYNC}},
+	{G_IDENTIFIER,				{TOKEN_AWAIT}},
+	{G_IDENTIFIER,				{TOKEN_FROM}},
+	{G_IDENTIFIER,				{TOKEN_GET}},
+	{G_IDENTIFIER,				{TOKEN_IMPLEMENTS}},
+	{G_IDENTIFIER,				{TOKEN_INTERFACE}},
+	{G_IDENTIFIER,				{TOKEN_LET}},
+	{G_IDENTIFIER,				{TOKEN_META}},
+	{G_IDENTIFIER,				{TOKEN_OF}},
+	{G_IDENTIFIER,				{TOKEN_PACKAGE}},
+	{G_IDENTIFIER,				{TOKEN_PRIVATE}},
+	{G_IDENTIFIER,				{TOKEN_PROTECTED}},
+	{G_IDENTIFIER,				{TOKEN_PUBLIC}},
+	{G_IDENTIFIER,				{TOKEN_SET}},
+	{G_IDENTIFIER,				{TOKEN_STATIC}},
+	{G_IDENTIFIER,				{TOKEN_TARGET}},
+	{G_IDENTIFIER,				{TOKEN_YIELD}},
+};
+
+/* lhs -> any token type in [first, last]. */
+struct token_range {
+	uint16_t	lhs;
+	uint16_t	first;
+	uint16_t	last;
+};
+
+static const
+struct token_range g_token_ranges[] = {
+	{IDENTIFIER_NAME,	TOKEN_IDENTIFIER,	TOKEN_YIELD},
+};
+
+/* The lookahead restrictions; the token never starts the lhs. */
+struct exclusion {
+	uint16_t	lhs;
+	uint16_t	token;
+};
+
+static const
+struct exclusion g_exclusions[] = {
+	{EXPRESSION_STATEMENT,	TOKEN_LEFT_BRACE},
+	{EXPRESSION_STATEMENT,	TOKEN_FUNCTION},
+	{EXPRESSION_STATEMENT,	TOKEN_CLASS},
+};
+
+/*
+ * A / and a } are read differently under different goals; a token queued
+ * under one goal may yet start a non-terminal under another. A set with one
+ * of a group has all of it.
+ */
+static const
+uint16_t g_goal_groups[][3] = {
+	{TOKEN_DIV,			TOKEN_DIV_EQUALS,		TOKEN_REG_EXP},
+	{TOKEN_RIGHT_BRACE,	TOKEN_TEMPLATE_MIDDLE,	TOKEN_TEMPLATE_TAIL},
+};
+#endif